@@ -42,6 +42,11 @@ void sha256_str(SHA256_DIGEST digest, char *str, size_t max_len)
 	digest_str(digest.data, sizeof(digest.data), str, max_len);
 }
 
+int sha256_from_str(SHA256_DIGEST *out, const char *str)
+{
+	return str_hex_decode(out->data, sizeof(out->data), str);
+}
+
 int sha256_comp(SHA256_DIGEST digest1, SHA256_DIGEST digest2)
 {
 	return mem_comp(digest1.data, digest2.data, sizeof(digest1.data));
@@ -60,6 +65,11 @@ void md5_str(MD5_DIGEST digest, char *str, size_t max_len)
 	digest_str(digest.data, sizeof(digest.data), str, max_len);
 }
 
+int md5_from_str(MD5_DIGEST *out, const char *str)
+{
+	return str_hex_decode(out->data, sizeof(out->data), str);
+}
+
 int md5_comp(MD5_DIGEST digest1, MD5_DIGEST digest2)
 {
 	return mem_comp(digest1.data, digest2.data, sizeof(digest1.data));
@@ -48,13 +48,22 @@ inline T bezier(const T p0, const T p1, const T p2, const T p3, TB amount)
 	return mix(c20, c21, amount); // c30
 }
 
-static std::random_device random_device;
-static std::mt19937 random_engine(random_device());
+// one engine for the whole program, so that random_seed makes every random_int reproducible
+inline std::mt19937 &random_engine()
+{
+	static std::mt19937 engine(std::random_device{}());
+	return engine;
+}
+
+inline void random_seed(unsigned seed)
+{
+	random_engine().seed(seed);
+}
 
 inline int random_int()
 {
 	std::uniform_int_distribution distribution(0, RAND_MAX);
-	return distribution(random_engine);
+	return distribution(random_engine());
 }
 
 // not include the 'max'
@@ -24,6 +24,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <dirent.h>
@@ -37,6 +38,7 @@
 #include <direct.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <io.h>
 #include <process.h>
 #include <share.h>
 #include <shellapi.h>
@@ -540,6 +542,47 @@ int io_error(IOHANDLE io)
 	return ferror((FILE *) io);
 }
 
+void *io_map(IOHANDLE io, unsigned *size)
+{
+	*size = 0;
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE) _get_osfhandle(_fileno((FILE *) io));
+	LARGE_INTEGER length;
+	if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart <= 0 || length.QuadPart > 0x7fffffff)
+		return 0;
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if(!mapping)
+		return 0;
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping); // the view keeps the mapping alive
+	if(!data)
+		return 0;
+	*size = (unsigned) length.QuadPart;
+	return data;
+#else
+	struct stat sb;
+	int fd = fileno((FILE *) io);
+	if(fstat(fd, &sb) == -1 || sb.st_size <= 0 || sb.st_size > 0x7fffffff)
+		return 0;
+	void *data = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		return 0;
+	*size = (unsigned) sb.st_size;
+	return data;
+#endif
+}
+
+void io_unmap(void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 #define ASYNC_BUFSIZE 8 * 1024
 #define ASYNC_LOCAL_BUFSIZE 64 * 1024
 
@@ -1672,6 +1715,143 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize)
 	return -1; /* error */
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+enum
+{
+	NET_UDP_MMSG_MAX = 64,
+};
+
+static int priv_net_udp_recvmmsg(int sock, NETADDR *addrs, unsigned char *data, int stride, int *sizes, int num)
+{
+	struct mmsghdr msgs[NET_UDP_MMSG_MAX];
+	struct iovec iovecs[NET_UDP_MMSG_MAX];
+	struct sockaddr_storage sockaddrs[NET_UDP_MMSG_MAX];
+	int received = 0;
+
+	while(received < num)
+	{
+		int batch = num - received < NET_UDP_MMSG_MAX ? num - received : NET_UDP_MMSG_MAX;
+		mem_zero(msgs, sizeof(msgs[0]) * batch);
+		for(int i = 0; i < batch; i++)
+		{
+			iovecs[i].iov_base = data + (received + i) * stride;
+			iovecs[i].iov_len = stride;
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &sockaddrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(sockaddrs[i]);
+		}
+
+		int r = recvmmsg(sock, msgs, batch, MSG_DONTWAIT, 0);
+		if(r <= 0)
+			break;
+		for(int i = 0; i < r; i++)
+		{
+			sockaddr_to_netaddr((struct sockaddr *) &sockaddrs[i], &addrs[received + i]);
+			sizes[received + i] = msgs[i].msg_len;
+			network_stats.recv_bytes += msgs[i].msg_len;
+			network_stats.recv_packets++;
+		}
+		received += r;
+		if(r < batch)
+			break;
+	}
+	return received;
+}
+
+static void priv_net_udp_sendmmsg(int sock, int type, const NETADDR *addrs, const unsigned char *data, int stride, const int *sizes, int num)
+{
+	struct mmsghdr msgs[NET_UDP_MMSG_MAX];
+	struct iovec iovecs[NET_UDP_MMSG_MAX];
+	struct sockaddr_storage sockaddrs[NET_UDP_MMSG_MAX];
+	int batch = 0;
+
+	for(int i = 0; i <= num; i++)
+	{
+		// flush when the batch is full or all packets are collected
+		if(batch == NET_UDP_MMSG_MAX || (i == num && batch > 0))
+		{
+			int sent = 0;
+			while(sent < batch)
+			{
+				int r = sendmmsg(sock, msgs + sent, batch - sent, 0);
+				if(r > 0)
+					sent += r;
+				else if(r == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+					break; // the socket buffer is full, the rest is dropped like with sendto
+				else if(errno != EINTR)
+					sent++; // only this message failed (unreachable or refused address), go on with the next one
+			}
+			batch = 0;
+		}
+		if(i == num)
+			break;
+
+		// broadcasts need a socket address that net_udp_send sets up
+		if(!(addrs[i].type & type) || (addrs[i].type & NETTYPE_LINK_BROADCAST))
+			continue;
+
+		mem_zero(&msgs[batch], sizeof(msgs[batch]));
+		iovecs[batch].iov_base = (void *) (data + i * stride);
+		iovecs[batch].iov_len = sizes[i];
+		msgs[batch].msg_hdr.msg_iov = &iovecs[batch];
+		msgs[batch].msg_hdr.msg_iovlen = 1;
+		msgs[batch].msg_hdr.msg_name = &sockaddrs[batch];
+		if(type == NETTYPE_IPV4)
+		{
+			netaddr_to_sockaddr_in(&addrs[i], (struct sockaddr_in *) &sockaddrs[batch]);
+			msgs[batch].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		}
+		else
+		{
+			netaddr_to_sockaddr_in6(&addrs[i], (struct sockaddr_in6 *) &sockaddrs[batch]);
+			msgs[batch].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+		}
+		network_stats.sent_bytes += sizes[i];
+		network_stats.sent_packets++;
+		batch++;
+	}
+}
+#endif
+
+int net_udp_recv_batch(NETSOCKET sock, NETADDR *addrs, unsigned char *data, int stride, int *sizes, int num)
+{
+	int received = 0;
+#if defined(CONF_PLATFORM_LINUX)
+	if(sock.ipv4sock >= 0)
+		received += priv_net_udp_recvmmsg(sock.ipv4sock, addrs, data, stride, sizes, num);
+	if(received < num && sock.ipv6sock >= 0)
+		received += priv_net_udp_recvmmsg(sock.ipv6sock, addrs + received, data + received * stride, stride, sizes + received, num - received);
+#else
+	while(received < num)
+	{
+		int bytes = net_udp_recv(sock, &addrs[received], data + received * stride, stride);
+		if(bytes <= 0)
+			break;
+		sizes[received++] = bytes;
+	}
+#endif
+	return received;
+}
+
+void net_udp_send_batch(NETSOCKET sock, const NETADDR *addrs, const unsigned char *data, int stride, const int *sizes, int num)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(sock.ipv4sock >= 0)
+		priv_net_udp_sendmmsg(sock.ipv4sock, NETTYPE_IPV4, addrs, data, stride, sizes, num);
+	if(sock.ipv6sock >= 0)
+		priv_net_udp_sendmmsg(sock.ipv6sock, NETTYPE_IPV6, addrs, data, stride, sizes, num);
+	for(int i = 0; i < num; i++)
+	{
+		if(addrs[i].type & NETTYPE_LINK_BROADCAST)
+			net_udp_send(sock, &addrs[i], data + i * stride, sizes[i]);
+	}
+#else
+	for(int i = 0; i < num; i++)
+		net_udp_send(sock, &addrs[i], data + i * stride, sizes[i]);
+#endif
+}
+
 int net_udp_close(NETSOCKET sock)
 {
 	return priv_net_close_all_sockets(sock);
@@ -2340,6 +2520,30 @@ int fs_file_time(const char *name, time_t *created, time_t *modified)
 	return 0;
 }
 
+int io_file_time(IOHANDLE io, time_t *created, time_t *modified)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE) _get_osfhandle(_fileno((FILE *) io));
+	FILETIME creation, lastwrite;
+	if(file == INVALID_HANDLE_VALUE || !GetFileTime(file, &creation, NULL, &lastwrite))
+		return 1;
+
+	*created = filetime_to_unixtime(&creation);
+	*modified = filetime_to_unixtime(&lastwrite);
+#elif defined(CONF_FAMILY_UNIX)
+	struct stat sb;
+	if(fstat(fileno((FILE *) io), &sb))
+		return 1;
+
+	*created = sb.st_ctime;
+	*modified = sb.st_mtime;
+#else
+#error not implemented
+#endif
+
+	return 0;
+}
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char *) data;
@@ -380,6 +380,35 @@ int io_flush(IOHANDLE io);
 */
 int io_error(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps the whole file into memory. The mapping is private:
+		writes to it are copy-on-write and never reach the file.
+
+	Parameters:
+		io - Handle to the file.
+		size - Receives the size of the mapping in bytes.
+
+	Returns:
+		Pointer to the mapped file, or 0 if the file is empty or
+		cannot be mapped. The handle may be closed while the mapping
+		is alive.
+
+	Remarks:
+		The file must not be truncated while it is mapped.
+*/
+void *io_map(IOHANDLE io, unsigned *size);
+
+/*
+	Function: io_unmap
+		Releases a mapping created by <io_map>.
+
+	Parameters:
+		data - Pointer returned by <io_map>.
+		size - Size returned by <io_map>.
+*/
+void io_unmap(void *data, unsigned size);
+
 /*
 	Function: io_stdin
 		Returns an <IOHANDLE> to the standard input.
@@ -856,6 +885,41 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 */
 int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize);
 
+/*
+	Function: net_udp_recv_batch
+		Receives as many packets as are waiting, up to num, over an
+		UDP socket. On Linux this takes one system call per socket
+		family, elsewhere it calls net_udp_recv for each packet.
+
+	Parameters:
+		sock - Socket to use.
+		addrs - Array of num NETADDRs that will receive the addresses.
+		data - Buffer for num packets, packet i is stored at data + i * stride.
+		stride - Maximum size of one packet.
+		sizes - Array of num ints that will receive the packet sizes.
+		num - Maximum number of packets to receive.
+
+	Returns:
+		The number of packets received, 0 if none were waiting.
+*/
+int net_udp_recv_batch(NETSOCKET sock, NETADDR *addrs, unsigned char *data, int stride, int *sizes, int num);
+
+/*
+	Function: net_udp_send_batch
+		Sends several packets over an UDP socket. On Linux this takes
+		one system call per socket family, elsewhere it calls
+		net_udp_send for each packet.
+
+	Parameters:
+		sock - Socket to use.
+		addrs - Where to send the packets.
+		data - Packet i is stored at data + i * stride.
+		stride - Distance between two packets in data.
+		sizes - Sizes of the packets.
+		num - Number of packets.
+*/
+void net_udp_send_batch(NETSOCKET sock, const NETADDR *addrs, const unsigned char *data, int stride, const int *sizes, int num);
+
 /*
 	Function: net_udp_close
 		Closes an UDP socket.
@@ -1685,6 +1749,23 @@ char *fs_read_str(const char *name);
 */
 int fs_file_time(const char *name, time_t *created, time_t *modified);
 
+/*
+	Function: io_file_time
+		Gets the creation and the last modification date of an open
+		file, like <fs_file_time>. Unlike a lookup by name, the result
+		belongs to the file the handle reads even if the name has been
+		replaced since the file was opened.
+
+	Parameters:
+		io - Handle to the file.
+		created - Pointer to time_t
+		modified - Pointer to time_t
+
+	Returns:
+		0 on success non-zero on failure
+*/
+int io_file_time(IOHANDLE io, time_t *created, time_t *modified);
+
 /*
 	Group: Undocumented
 */
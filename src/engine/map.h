@@ -23,11 +23,14 @@ class IEngineMap : public IMap
 {
 	MACRO_INTERFACE("enginemap", 0)
 public:
-	virtual bool Load(const char *pMapName, class IStorage *pStorage = 0) = 0;
+	virtual bool Load(const char *pMapName, class IStorage *pStorage = 0, class CDataFileHashCache *pHashCache = 0) = 0;
 	virtual bool IsLoaded() = 0;
 	virtual void Unload() = 0;
+	virtual void Swap(IEngineMap *pOther) = 0; // exchange the loaded maps
 	virtual SHA256_DIGEST Sha256() = 0;
 	virtual unsigned Crc() = 0;
+	virtual const unsigned char *FileData() = 0;
+	virtual unsigned FileSize() = 0;
 };
 
 extern IEngineMap *CreateEngineMap();
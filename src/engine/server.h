@@ -65,11 +65,16 @@ public:
 	virtual bool IsBanned(int ClientID) = 0;
 	virtual void Kick(int ClientID, const char *pReason) = 0;
 	virtual void ChangeMap(const char *pMap) = 0;
+	virtual void PreloadMap(const char *pMap) = 0;
+	virtual void CancelPreload() = 0;
+	virtual const char *GetCurrentMap() const = 0; // name of the loaded map, with its path below maps/
 
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 	virtual bool DemoRecorder_IsRecording() = 0;
 
 	virtual void ExpireServerInfo() = 0;
+
+	virtual class CProfiler *Profiler() = 0;
 };
 
 class IGameServer : public IInterface
@@ -105,6 +110,10 @@ public:
 	virtual const char *NetVersionHashUsed() const = 0;
 	virtual const char *NetVersionHashReal() const = 0;
 
+	// headless benchmark, the input only depends on seed, client and tick
+	virtual void OnBenchmarkJoin(int ClientID, bool Human) = 0;
+	virtual void OnBenchmarkInput(int ClientID, int Tick, unsigned Seed, void *pInput) = 0;
+
 	virtual bool TimeScore() const { return false; }
 	/**
 	 * Used to report custom player info to master servers.
@@ -11,7 +11,6 @@
 #include <engine/server.h>
 #include <engine/storage.h>
 
-#include <engine/shared/compression.h>
 #include <engine/shared/config.h>
 #include <engine/shared/datafile.h>
 #include <engine/shared/demo.h>
@@ -30,6 +29,8 @@
 
 #include <signal.h>
 
+static const char *const MAP_HASH_CACHE_FILE = "map_hashes.txt";
+
 volatile sig_atomic_t InterruptSignaled = 0;
 
 CSnapIDPool::CSnapIDPool()
@@ -226,13 +227,41 @@ void CServerBan::ConBanExt(IConsole::IResult *pResult, void *pUser)
 		ConBan(pResult, pUser);
 }
 
+CServer::CClient::CInput *CServer::CClient::QueueInput(int GameTick, int CurrentTick)
+{
+	// the tick that ran already, apply it on the next one
+	const bool Late = GameTick <= CurrentTick;
+	if(Late)
+	{
+		m_InputStats.m_NumLate++;
+		GameTick = CurrentTick + 1;
+	}
+	if(GameTick - CurrentTick > INPUT_RING_SIZE)
+	{
+		m_InputStats.m_NumDropped++;
+		return 0;
+	}
+
+	CInput *pInput = &m_aInputs[GameTick % INPUT_RING_SIZE];
+	if(pInput->m_GameTick == GameTick && !Late)
+		m_InputStats.m_NumDuplicate++;
+	pInput->m_GameTick = GameTick;
+	return pInput;
+}
+
+CServer::CClient::CInput *CServer::CClient::GetInput(int GameTick)
+{
+	CInput *pInput = &m_aInputs[GameTick % INPUT_RING_SIZE];
+	return pInput->m_GameTick == GameTick ? pInput : 0;
+}
+
 void CServer::CClient::Reset()
 {
 	// reset input
-	for(int i = 0; i < 200; i++)
+	for(int i = 0; i < INPUT_RING_SIZE; i++)
 		m_aInputs[i].m_GameTick = -1;
-	m_CurrentInput = 0;
 	mem_zero(&m_LatestInput, sizeof(m_LatestInput));
+	mem_zero(&m_InputStats, sizeof(m_InputStats));
 
 	m_Snapshots.PurgeAll();
 	m_LastAckedSnapshot = -1;
@@ -258,6 +287,7 @@ CServer::CServer() :
 	m_CurrentMapSize = 0;
 
 	m_MapReload = false;
+	m_MapSwitchPending = false;
 
 	m_RconClientID = IServer::RCON_CID_SERV;
 	m_RconAuthLevel = AUTHED_ADMIN;
@@ -266,7 +296,24 @@ CServer::CServer() :
 	m_GeneratedRconPassword = 0;
 
 	m_ServerInfoNeedsUpdate = false;
+	m_ServerInfoCacheValid = false;
+	m_ServerInfoCacheTime = 0;
+	mem_zero(m_aInfoRequestSources, sizeof(m_aInfoRequestSources));
+	m_NumInfoResponses = 0;
+	m_NumInfoRequestsDropped = 0;
 	m_pRegister = nullptr;
+	m_NumSnapThreads = 0;
+
+	m_Benchmark = false;
+	m_BenchmarkSnapBytes = 0;
+	m_BenchmarkNumSnaps = 0;
+	m_BenchmarkMsgBytes = 0;
+
+	m_ProfileInput = m_Profiler.RegisterSection("input");
+	m_ProfileTick = m_Profiler.RegisterSection("tick");
+	m_ProfileSnap = m_Profiler.RegisterSection("snap");
+	m_ProfileRegister = m_Profiler.RegisterSection("register");
+	m_ProfileNetwork = m_Profiler.RegisterSection("network");
 
 	Init();
 }
@@ -277,6 +324,7 @@ void CServer::SetClientName(int ClientID, const char *pName)
 		return;
 
 	const char *pDefaultName = "(1)";
+	m_ServerInfoCacheValid = false;
 	pName = str_utf8_skip_whitespaces(pName);
 	str_utf8_copy_num(m_aClients[ClientID].m_aName, *pName ? pName : pDefaultName, sizeof(m_aClients[ClientID].m_aName), MAX_NAME_LENGTH);
 }
@@ -286,6 +334,7 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 	if(ClientID < 0 || ClientID >= MAX_PLAYERS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pClan)
 		return;
 
+	m_ServerInfoCacheValid = false;
 	str_utf8_copy_num(m_aClients[ClientID].m_aClan, pClan, sizeof(m_aClients[ClientID].m_aClan), MAX_CLAN_LENGTH);
 }
 
@@ -294,6 +343,7 @@ void CServer::SetClientCountry(int ClientID, int Country)
 	if(ClientID < 0 || ClientID >= MAX_PLAYERS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
 
+	m_ServerInfoCacheValid = false;
 	m_aClients[ClientID].m_Country = Country;
 }
 
@@ -324,7 +374,10 @@ void CServer::Kick(int ClientID, const char *pReason)
 		return;
 	}
 
-	m_NetServer.Drop(ClientID, pReason);
+	if(m_Benchmark)
+		DelClientCallback(ClientID, pReason, this);
+	else
+		m_NetServer.Drop(ClientID, pReason);
 }
 
 int64_t CServer::TickStartTime(int Tick)
@@ -489,15 +542,23 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 				if(m_aClients[i].m_State == CClient::STATE_INGAME && !m_aClients[i].m_Quitting)
 				{
 					Packet.m_ClientID = i;
-					m_NetServer.Send(&Packet);
+					SendChunk(&Packet);
 				}
 		}
 		else
-			m_NetServer.Send(&Packet);
+			SendChunk(&Packet);
 	}
 	return 0;
 }
 
+void CServer::SendChunk(CNetChunk *pChunk)
+{
+	if(m_Benchmark)
+		m_BenchmarkMsgBytes += pChunk->m_DataSize;
+	else
+		m_NetServer.Send(pChunk);
+}
+
 void CServer::DoSnapshot()
 {
 	GameServer()->OnPreSnap();
@@ -518,8 +579,14 @@ void CServer::DoSnapshot()
 	}
 
 	// create snapshots for all clients
+	// the snapshots are built here, delta and compression run on the snap job pool if there is one
+	static CSnapshot EmptySnap;
+	EmptySnap.Clear();
+	int NumJobs = 0;
 	for(int i = 0; i < MAX_PLAYERS; i++)
 	{
+		m_aClients[i].m_SnapPending = false;
+
 		// client must be ingame to receive snapshots
 		if(m_aClients[i].m_State != CClient::STATE_INGAME)
 			continue;
@@ -535,15 +602,9 @@ void CServer::DoSnapshot()
 		{
 			char aData[CSnapshot::MAX_SIZE];
 			CSnapshot *pData = (CSnapshot *) aData; // Fix compiler warning for strict-aliasing
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			char aCompData[CSnapshot::MAX_SIZE];
-			int SnapshotSize;
-			int Crc;
-			static CSnapshot EmptySnap;
 			CSnapshot *pDeltashot = &EmptySnap;
-			int DeltashotSize;
-			int DeltaTick = -1;
-			int DeltaSize;
+			CClient::CSnapPack *pPack = &m_aClients[i].m_SnapPack;
+			int SnapshotSize;
 
 			m_SnapshotBuilder.Init();
 
@@ -551,7 +612,6 @@ void CServer::DoSnapshot()
 
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
-			Crc = pData->Crc();
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -561,82 +621,161 @@ void CServer::DoSnapshot()
 			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0);
 
 			// find snapshot that we can perform delta against
-			EmptySnap.Clear();
-
+			pPack->m_DeltaTick = -1;
+			if(m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0) >= 0)
+				pPack->m_DeltaTick = m_aClients[i].m_LastAckedSnapshot;
+			else
 			{
-				DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
+				// no acked package found, force client to recover rate
+				if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
+					m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
 			}
 
-			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			// both stay in the snapshot storage until the next snap
+			pPack->m_pFrom = pDeltashot;
+			m_aClients[i].m_Snapshots.Get(m_CurrentGameTick, 0, &pPack->m_pTo, 0);
+			m_aClients[i].m_SnapPending = true;
 
-			if(DeltaSize > 0)
+			if(m_NumSnapThreads > 0)
 			{
-				// compress it
-				int SnapshotSize;
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
-				int NumPackets;
+				m_SnapJobPool.Add(std::make_shared<CSnapJob>(pPack, &m_SnapshotDelta, &m_SnapJobsDone));
+				NumJobs++;
+			}
+			else
+				pPack->Process(&m_SnapshotDelta);
+		}
+	}
 
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+	// wait for the snap jobs
+	for(int i = 0; i < NumJobs; i++)
+		sphore_wait(&m_SnapJobsDone);
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+	// send the snapshots in client order
+	for(int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if(!m_aClients[i].m_SnapPending)
+			continue;
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
-			}
-			else
+		const CClient::CSnapPack *pPack = &m_aClients[i].m_SnapPack;
+		if(m_Benchmark)
+		{
+			// scripted players ack every snapshot right away
+			m_BenchmarkSnapBytes += maximum(0, pPack->m_CompSize);
+			m_BenchmarkNumSnaps++;
+			m_aClients[i].m_LastAckedSnapshot = m_CurrentGameTick;
+			m_aClients[i].m_SnapRate = CClient::SNAPRATE_FULL;
+			continue;
+		}
+
+		if(pPack->m_CompSize > 0)
+		{
+			const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+			int NumPackets = (pPack->m_CompSize + MaxSize - 1) / MaxSize;
+
+			for(int n = 0, Left = pPack->m_CompSize; Left > 0; n++)
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
-				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick - DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				int Chunk = Left < MaxSize ? Left : MaxSize;
+				Left -= Chunk;
 
-				if(DeltaSize < 0)
+				if(NumPackets == 1)
+				{
+					CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+					Msg.AddInt(m_CurrentGameTick);
+					Msg.AddInt(m_CurrentGameTick - pPack->m_DeltaTick);
+					Msg.AddInt(pPack->m_Crc);
+					Msg.AddInt(Chunk);
+					Msg.AddRaw(&pPack->m_aCompData[n * MaxSize], Chunk);
+					SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				}
+				else
 				{
-					char aBuf[64];
-					str_format(aBuf, sizeof(aBuf), "delta pack failed! (%d)", DeltaSize);
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+					CMsgPacker Msg(NETMSG_SNAP, true);
+					Msg.AddInt(m_CurrentGameTick);
+					Msg.AddInt(m_CurrentGameTick - pPack->m_DeltaTick);
+					Msg.AddInt(NumPackets);
+					Msg.AddInt(n);
+					Msg.AddInt(pPack->m_Crc);
+					Msg.AddInt(Chunk);
+					Msg.AddRaw(&pPack->m_aCompData[n * MaxSize], Chunk);
+					SendMsg(&Msg, MSGFLAG_FLUSH, i);
 				}
 			}
 		}
+		else
+		{
+			CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+			Msg.AddInt(m_CurrentGameTick);
+			Msg.AddInt(m_CurrentGameTick - pPack->m_DeltaTick);
+			SendMsg(&Msg, MSGFLAG_FLUSH, i);
+
+			if(pPack->m_CompSize < 0)
+			{
+				char aBuf[64];
+				str_format(aBuf, sizeof(aBuf), "delta pack failed! (%d)", pPack->m_CompSize);
+				m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+			}
+		}
 	}
 
 	GameServer()->OnPostSnap();
 }
 
+void CServer::CClient::CSnapPack::Process(const CSnapshotDelta *pSnapshotDelta)
+{
+	m_Crc = m_pTo->Crc();
+	m_CompSize = pSnapshotDelta->CreateDeltaPacked(m_pFrom, m_pTo, m_aCompData, sizeof(m_aCompData));
+}
+
+void CServer::CSnapJob::Run()
+{
+	m_pPack->Process(m_pSnapshotDelta);
+	sphore_signal(m_pDone);
+}
+
+CServer::CMapLoadJob::CMapLoadJob(IStorage *pStorage, CDataFileHashCache *pHashCache, const char *pName) :
+	m_pStorage(pStorage), m_pHashCache(pHashCache), m_Loaded(false)
+{
+	m_pMap = CreateEngineMap();
+	str_copy(m_aName, pName, sizeof(m_aName));
+	Abortable(true);
+}
+
+CServer::CMapLoadJob::~CMapLoadJob()
+{
+	delete m_pMap;
+}
+
+void CServer::CMapLoadJob::Run()
+{
+	char aBuf[IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "maps/%s.map", m_aName);
+	m_Loaded = m_pMap->Load(aBuf, m_pStorage, m_pHashCache);
+}
+
+void CServer::CMapWarmJob::Run()
+{
+	int NumMaps = 0;
+	int64_t Size = 0;
+	for(int i = 0; i < m_lMaps.size() && State() != STATE_ABORTED; i++)
+	{
+		char aBuf[IO_MAX_PATH_LENGTH];
+		str_format(aBuf, sizeof(aBuf), "maps/%s.map", m_lMaps[i].m_aName);
+		CDataFileReader DataFile;
+		if(DataFile.Open(m_pStorage, aBuf, IStorage::TYPE_ALL, m_pHashCache))
+		{
+			// cached hashes skip reading the file, so touch every page
+			const unsigned char *pData = DataFile.FileData();
+			volatile unsigned char Sum = 0;
+			for(unsigned Offset = 0; Offset < DataFile.FileSize() && State() != STATE_ABORTED; Offset += 4096)
+				Sum += pData[Offset];
+			NumMaps++;
+			Size += DataFile.FileSize();
+		}
+	}
+	m_pHashCache->Save(m_pStorage, MAP_HASH_CACHE_FILE);
+	dbg_msg("server", "warmed %d/%d maps, %d KiB", NumMaps, m_lMaps.size(), (int) (Size / 1024));
+}
+
 int CServer::NewClientCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *) pUser;
@@ -659,6 +798,7 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_Quitting = false;
 	pThis->m_aClients[ClientID].m_Latency = 0;
 	pThis->m_aClients[ClientID].Reset();
+	pThis->m_ServerInfoCacheValid = false;
 
 	return 0;
 }
@@ -694,6 +834,7 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	pThis->m_aClients[ClientID].m_NoRconNote = false;
 	pThis->m_aClients[ClientID].m_Quitting = false;
 	pThis->m_aClients[ClientID].m_Snapshots.PurgeAll();
+	pThis->m_ServerInfoCacheValid = false;
 	return 0;
 }
 
@@ -906,7 +1047,6 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		}
 		else if(Unpacker.Type() == NETMSG_INPUT)
 		{
-			CClient::CInput *pInput;
 			int64_t TagTime;
 			int64_t Now = time_get();
 
@@ -921,12 +1061,22 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			if(m_aClients[ClientID].m_LastAckedSnapshot > 0)
 				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
 
+			int TimeLeft = ((TickStartTime(IntendedTick) - Now) * 1000) / time_freq();
+			CClient::CInputStats *pStats = &m_aClients[ClientID].m_InputStats;
+			if(pStats->m_NumReceived == 0)
+				pStats->m_MinTimeLeft = pStats->m_MaxTimeLeft = TimeLeft;
+			else
+			{
+				pStats->m_MinTimeLeft = minimum(pStats->m_MinTimeLeft, TimeLeft);
+				pStats->m_MaxTimeLeft = maximum(pStats->m_MaxTimeLeft, TimeLeft);
+			}
+			pStats->m_TimeLeftSum += TimeLeft;
+			pStats->m_NumReceived++;
+
 			// add message to report the input timing
 			// skip packets that are old
 			if(IntendedTick > m_aClients[ClientID].m_LastInputTick)
 			{
-				int TimeLeft = ((TickStartTime(IntendedTick) - Now) * 1000) / time_freq();
-
 				CMsgPacker Msg(NETMSG_INPUTTIMING, true);
 				Msg.AddInt(IntendedTick);
 				Msg.AddInt(TimeLeft);
@@ -935,15 +1085,12 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			m_aClients[ClientID].m_LastInputTick = IntendedTick;
 
-			pInput = &m_aClients[ClientID].m_aInputs[m_aClients[ClientID].m_CurrentInput];
-
-			if(IntendedTick <= Tick())
-				IntendedTick = Tick() + 1;
-
-			pInput->m_GameTick = IntendedTick;
-
 			for(int i = 0; i < Size / 4; i++)
-				pInput->m_aData[i] = Unpacker.GetInt();
+				m_aClients[ClientID].m_LatestInput.m_aData[i] = Unpacker.GetInt();
+
+			CClient::CInput *pInput = m_aClients[ClientID].QueueInput(IntendedTick, Tick());
+			if(pInput)
+				mem_copy(pInput->m_aData, m_aClients[ClientID].m_LatestInput.m_aData, MAX_INPUT_SIZE * sizeof(int));
 
 			int PingCorrection = clamp(Unpacker.GetInt(), 0, 50);
 			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
@@ -952,11 +1099,6 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				m_aClients[ClientID].m_Latency = maximum(0, m_aClients[ClientID].m_Latency - PingCorrection);
 			}
 
-			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pInput->m_aData, MAX_INPUT_SIZE * sizeof(int));
-
-			m_aClients[ClientID].m_CurrentInput++;
-			m_aClients[ClientID].m_CurrentInput %= 200;
-
 			// call the mod with the fresh input data
 			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
 				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
@@ -1071,7 +1213,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	}
 }
 
-void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
+void CServer::AddServerInfo(CPacker *pPacker, bool Clients)
 {
 	// count the players
 	int PlayerCount = 0, ClientCount = 0;
@@ -1086,13 +1228,6 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 		}
 	}
 
-	if(Token != -1)
-	{
-		pPacker->Reset();
-		pPacker->AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
-		pPacker->AddInt(Token);
-	}
-
 	pPacker->AddString(GameServer()->Version(), 32);
 	pPacker->AddString(Config()->m_SvName, 64);
 	pPacker->AddString(Config()->m_SvHostname, 128);
@@ -1115,7 +1250,7 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 	pPacker->AddInt(ClientCount); // num clients
 	pPacker->AddInt(maximum(ClientCount, Config()->m_SvMaxClients)); // max clients
 
-	if(Token != -1)
+	if(Clients)
 	{
 		for(int i = 0; i < MAX_PLAYERS; i++)
 		{
@@ -1131,6 +1266,58 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 	}
 }
 
+void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
+{
+	if(Token == -1)
+	{
+		AddServerInfo(pPacker, false);
+		return;
+	}
+
+	// browser requests only differ in the token, so the rest is built once.
+	// it is rebuilt at least every second in case a change did not expire it
+	int64_t Now = time_get();
+	if(!m_ServerInfoCacheValid || Now - m_ServerInfoCacheTime > time_freq())
+	{
+		m_ServerInfoCache.Reset();
+		AddServerInfo(&m_ServerInfoCache, true);
+		m_ServerInfoCacheValid = true;
+		m_ServerInfoCacheTime = Now;
+	}
+
+	pPacker->Reset();
+	pPacker->AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
+	pPacker->AddInt(Token);
+	pPacker->AddRaw(m_ServerInfoCache.Data(), m_ServerInfoCache.Size());
+}
+
+bool CServer::AllowInfoRequest(const NETADDR *pAddr)
+{
+	if(Config()->m_SvInfoRequestRate == 0)
+		return true;
+
+	// addresses whose hashes collide share the limit, so alternating between them gains nothing
+	unsigned Hash = pAddr->type;
+	for(unsigned char Byte : pAddr->ip)
+		Hash = Hash * 31 + Byte;
+	CInfoRequestSource *pSource = &m_aInfoRequestSources[Hash % NUM_INFO_REQUEST_SOURCES];
+
+	int64_t Now = time_get();
+	if(Now - pSource->m_WindowStart > time_freq())
+	{
+		pSource->m_WindowStart = Now;
+		pSource->m_NumRequests = 0;
+	}
+
+	if(pSource->m_NumRequests >= Config()->m_SvInfoRequestRate)
+	{
+		m_NumInfoRequestsDropped++;
+		return false;
+	}
+	pSource->m_NumRequests++;
+	return true;
+}
+
 void CServer::SendServerInfo(int ClientID)
 {
 	CMsgPacker Msg(NETMSG_SERVERINFO, true);
@@ -1150,6 +1337,7 @@ void CServer::SendServerInfo(int ClientID)
 void CServer::ExpireServerInfo()
 {
 	m_ServerInfoNeedsUpdate = true;
+	m_ServerInfoCacheValid = false;
 }
 
 void CServer::UpdateRegisterServerInfo()
@@ -1254,6 +1442,7 @@ void CServer::UpdateServerInfo(bool Resend)
 		return;
 
 	UpdateRegisterServerInfo();
+	m_ServerInfoCacheValid = false;
 
 	if(Resend)
 	{
@@ -1289,8 +1478,9 @@ void CServer::PumpNetwork()
 				CUnpacker Unpacker;
 				Unpacker.Reset((unsigned char *) Packet.m_pData + sizeof(SERVERBROWSE_GETINFO), Packet.m_DataSize - sizeof(SERVERBROWSE_GETINFO));
 				int SrvBrwsToken = Unpacker.GetInt();
-				if(Unpacker.Error())
+				if(Unpacker.Error() || !AllowInfoRequest(&Packet.m_Address))
 					continue;
+				m_NumInfoResponses++;
 
 				CPacker Packer;
 				CNetChunk Response;
@@ -1331,14 +1521,77 @@ void CServer::ChangeMap(const char *pMap)
 	m_MapReload = str_comp(Config()->m_SvMap, m_aCurrentMap) != 0;
 }
 
+void CServer::PreloadMap(const char *pMap)
+{
+	// a pending switch keeps the job it is waiting for
+	if(Config()->m_SvMapPreload && !m_MapSwitchPending)
+		StartMapLoad(pMap);
+}
+
+void CServer::CancelPreload()
+{
+	if(!m_pMapLoadJob || m_MapSwitchPending)
+		return;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "dropped preloaded map '%s'", m_pMapLoadJob->Name());
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+
+	// a job that is still queued doesn't load the map at all, a finished one frees it with the last reference
+	m_pMapLoadJob->Abort();
+	m_pMapLoadJob = nullptr;
+}
+
 int CServer::LoadMap(const char *pMapName)
 {
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
 
-	if(!m_pMap->Load(aBuf))
+	if(!m_pMap->Load(aBuf, 0, &m_MapHashCache))
 		return 0;
 
+	OnMapLoaded(pMapName);
+	return 1;
+}
+
+void CServer::StartMapLoad(const char *pMapName)
+{
+	// the map job pool has one worker, a map change must not wait for the warming behind it
+	if(m_pMapWarmJob)
+	{
+		if(!m_pMapWarmJob->Done() && m_pMapWarmJob->Abort())
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "stopped warming maps for the map change");
+		m_pMapWarmJob = nullptr;
+	}
+
+	if(m_pMapLoadJob && str_comp(m_pMapLoadJob->Name(), pMapName) == 0)
+		return;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "loading map '%s' in the background", pMapName);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+	m_pMapLoadJob = std::make_shared<CMapLoadJob>(Storage(), &m_MapHashCache, pMapName);
+	m_MapJobPool.Add(m_pMapLoadJob);
+}
+
+bool CServer::SwitchToLoadedMap(const char *pMapName)
+{
+	std::shared_ptr<CMapLoadJob> pJob = std::move(m_pMapLoadJob);
+	m_pMapLoadJob = nullptr;
+	if(!pJob->Loaded() || str_comp(pJob->Name(), pMapName) != 0)
+		return false;
+
+	// the old map moves into the job and is freed with it
+	m_pMap->Swap(pJob->Map());
+	OnMapLoaded(pMapName);
+	return true;
+}
+
+void CServer::OnMapLoaded(const char *pMapName)
+{
+	char aBuf[IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
+
 	// stop recording when we change map
 	if(m_DemoRecorder.IsRecording())
 		m_DemoRecorder.Stop();
@@ -1359,17 +1612,46 @@ int CServer::LoadMap(const char *pMapName)
 
 	str_copy(m_aCurrentMap, pMapName, sizeof(m_aCurrentMap));
 
-	// load complete map into memory for download
+	// serve downloads straight from the loaded map file
+	m_pCurrentMapData = m_pMap->FileData();
+	m_CurrentMapSize = m_pMap->FileSize();
+
+	m_MapHashCache.Save(Storage(), MAP_HASH_CACHE_FILE);
+}
+
+void CServer::FinishMapChange(bool Loaded)
+{
+	if(!Loaded)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "failed to load map. mapname='%s'", Config()->m_SvMap);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		str_copy(Config()->m_SvMap, m_aCurrentMap, sizeof(Config()->m_SvMap));
+		return;
+	}
+
+	// new map loaded
+	bool aSpecs[MAX_PLAYERS];
+	for(int c = 0; c < MAX_PLAYERS; c++)
+		aSpecs[c] = GameServer()->IsClientSpectator(c);
+
+	GameServer()->OnShutdown();
+
+	for(int c = 0; c < MAX_PLAYERS; c++)
 	{
-		IOHANDLE File = Storage()->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
-		m_CurrentMapSize = (int) io_length(File);
-		if(m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *) mem_alloc(m_CurrentMapSize);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
-		io_close(File);
+		if(m_aClients[c].m_State <= CClient::STATE_AUTH)
+			continue;
+
+		SendMap(c);
+		m_aClients[c].Reset();
+		m_aClients[c].m_State = aSpecs[c] ? CClient::STATE_CONNECTING_AS_SPEC : CClient::STATE_CONNECTING;
 	}
-	return 1;
+
+	m_GameStartTime = time_get();
+	m_CurrentGameTick = 0;
+	Kernel()->ReregisterInterface(GameServer());
+	GameServer()->OnInit();
+	UpdateServerInfo(true);
 }
 
 void CServer::InitInterfaces(IKernel *pKernel)
@@ -1388,6 +1670,7 @@ int CServer::Run()
 	m_PrintCBIndex = Console()->RegisterPrintCallback(Config()->m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
 	InitMapList();
+	m_MapHashCache.Load(Storage(), MAP_HASH_CACHE_FILE);
 
 	// load map
 	if(!LoadMap(Config()->m_SvMap))
@@ -1455,6 +1738,18 @@ int CServer::Run()
 		dbg_msg("server", "+-------------------------+");
 	}
 
+	// start the snapshot workers
+	m_NumSnapThreads = Config()->m_SvSnapThreads;
+	if(m_NumSnapThreads > 0)
+	{
+		sphore_init(&m_SnapJobsDone);
+		m_SnapJobPool.Init(m_NumSnapThreads);
+		str_format(aBuf, sizeof(aBuf), "using %d snapshot threads", m_NumSnapThreads);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+
+	m_MapJobPool.Init(1);
+
 	// start game
 	{
 		m_GameStartTime = time_get();
@@ -1468,37 +1763,19 @@ int CServer::Run()
 				m_MapReload = false;
 
 				// load map
-				if(LoadMap(Config()->m_SvMap))
+				if(Config()->m_SvMapPreload)
 				{
-					// new map loaded
-					bool aSpecs[MAX_PLAYERS];
-					for(int c = 0; c < MAX_PLAYERS; c++)
-						aSpecs[c] = GameServer()->IsClientSpectator(c);
-
-					GameServer()->OnShutdown();
-
-					for(int c = 0; c < MAX_PLAYERS; c++)
-					{
-						if(m_aClients[c].m_State <= CClient::STATE_AUTH)
-							continue;
-
-						SendMap(c);
-						m_aClients[c].Reset();
-						m_aClients[c].m_State = aSpecs[c] ? CClient::STATE_CONNECTING_AS_SPEC : CClient::STATE_CONNECTING;
-					}
-
-					m_GameStartTime = time_get();
-					m_CurrentGameTick = 0;
-					Kernel()->ReregisterInterface(GameServer());
-					GameServer()->OnInit();
-					UpdateServerInfo(true);
+					// keep ticking the current map until the worker is done
+					StartMapLoad(Config()->m_SvMap);
+					m_MapSwitchPending = true;
 				}
 				else
-				{
-					str_format(aBuf, sizeof(aBuf), "failed to load map. mapname='%s'", Config()->m_SvMap);
-					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
-					str_copy(Config()->m_SvMap, m_aCurrentMap, sizeof(Config()->m_SvMap));
-				}
+					FinishMapChange(LoadMap(Config()->m_SvMap));
+			}
+			if(m_MapSwitchPending && m_pMapLoadJob->Done())
+			{
+				m_MapSwitchPending = false;
+				FinishMapChange(SwitchToLoadedMap(Config()->m_SvMap));
 			}
 
 			int64_t Now = time_get();
@@ -1512,41 +1789,56 @@ int CServer::Run()
 					ShouldSnap = true;
 
 				// apply new input
-				for(int c = 0; c < MAX_PLAYERS; c++)
 				{
-					if(m_aClients[c].m_State == CClient::STATE_EMPTY)
-						continue;
-					for(int i = 0; i < 200; i++)
+					CProfileScope Scope(&m_Profiler, m_ProfileInput);
+					for(int c = 0; c < MAX_PLAYERS; c++)
 					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
-						{
-							if(m_aClients[c].m_State == CClient::STATE_INGAME)
-								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
-						}
+						if(m_aClients[c].m_State != CClient::STATE_INGAME)
+							continue;
+						CClient::CInput *pInput = m_aClients[c].GetInput(Tick());
+						if(pInput)
+							GameServer()->OnClientPredictedInput(c, pInput->m_aData);
+						else
+							m_aClients[c].m_InputStats.m_NumMissed++;
 					}
 				}
 
-				GameServer()->OnTick();
+				{
+					CProfileScope Scope(&m_Profiler, m_ProfileTick);
+					GameServer()->OnTick();
+				}
 			}
 
 			// snap game
 			if(NewTicks)
 			{
 				if(Config()->m_SvHighBandwidth || ShouldSnap)
+				{
+					CProfileScope Scope(&m_Profiler, m_ProfileSnap);
 					DoSnapshot();
+				}
 
 				UpdateClientRconCommands();
 				UpdateClientMapListEntries();
 
 				// master server stuff
-				m_pRegister->Update();
+				{
+					CProfileScope Scope(&m_Profiler, m_ProfileRegister);
+					m_pRegister->Update();
+				}
 
 				if(m_ServerInfoNeedsUpdate)
 					UpdateServerInfo();
 			}
 
-			PumpNetwork();
+			{
+				CProfileScope Scope(&m_Profiler, m_ProfileNetwork);
+				PumpNetwork();
+			}
+
+			// network time is only known once the packets are pumped, so the tick ends here
+			if(NewTicks)
+				m_Profiler.EndTick();
 
 			// wait for incoming data
 			m_NetServer.Wait(clamp(int((TickStartTime(m_CurrentGameTick + 1) - time_get()) * 1000 / time_freq()), 1, 1000 / SERVER_TICK_SPEED / 2));
@@ -1564,12 +1856,156 @@ int CServer::Run()
 	m_Econ.Shutdown();
 	m_Http.Shutdown();
 
+	if(m_NumSnapThreads > 0)
+	{
+		m_SnapJobPool.Shutdown();
+		sphore_destroy(&m_SnapJobsDone);
+	}
+	m_MapJobPool.Shutdown();
+	m_pMapLoadJob = nullptr;
+	m_pMapWarmJob = nullptr;
+	m_MapSwitchPending = false;
+
 	GameServer()->OnShutdown();
+
+	// write what is still queued for the demo
+	if(m_DemoRecorder.IsRecording())
+		m_DemoRecorder.Stop();
 	Free();
 
 	return 0;
 }
 
+int CServer::RunBenchmark()
+{
+	m_Benchmark = true;
+
+	// the game's own random numbers have to replay too
+	random_seed(Config()->m_BenchSeed);
+
+	// load map
+	if(!LoadMap(Config()->m_SvMap))
+	{
+		dbg_msg("bench", "failed to load map. mapname='%s'", Config()->m_SvMap);
+		Free();
+		return -1;
+	}
+
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+
+	m_NumSnapThreads = Config()->m_SvSnapThreads;
+	if(m_NumSnapThreads > 0)
+	{
+		sphore_init(&m_SnapJobsDone);
+		m_SnapJobPool.Init(m_NumSnapThreads);
+	}
+
+	int NumHumans = minimum(Config()->m_BenchHumans, (int) MAX_PLAYERS);
+	int NumClients = minimum(NumHumans + Config()->m_BenchGhosts, (int) MAX_PLAYERS);
+	for(int i = 0; i < NumClients; i++)
+		BenchmarkJoin(i, i < NumHumans);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "map=%s humans=%d ghosts=%d ticks=%d seed=%d snap_threads=%d", Config()->m_SvMap, NumHumans, NumClients - NumHumans, Config()->m_BenchTicks, Config()->m_BenchSeed, m_NumSnapThreads);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+
+	// run the ticks back to back, without sockets
+	m_Profiler.SetEnabled(true);
+	m_GameStartTime = time_get();
+	int64_t InputTime = 0;
+	int64_t TickTime = 0;
+	int64_t SnapTime = 0;
+	int NumTicks = 0;
+	for(; NumTicks < Config()->m_BenchTicks && m_RunServer && !InterruptSignaled; NumTicks++)
+	{
+		m_CurrentGameTick++;
+
+		int64_t Start = time_get();
+		{
+			CProfileScope Scope(&m_Profiler, m_ProfileInput);
+			for(int c = 0; c < MAX_PLAYERS; c++)
+			{
+				if(m_aClients[c].m_State != CClient::STATE_INGAME)
+					continue;
+				int *pData = m_aClients[c].m_LatestInput.m_aData;
+				GameServer()->OnBenchmarkInput(c, Tick(), Config()->m_BenchSeed, pData);
+				GameServer()->OnClientDirectInput(c, pData);
+				GameServer()->OnClientPredictedInput(c, pData);
+			}
+		}
+		int64_t End = time_get();
+		InputTime += End - Start;
+
+		Start = End;
+		{
+			CProfileScope Scope(&m_Profiler, m_ProfileTick);
+			GameServer()->OnTick();
+		}
+		End = time_get();
+		TickTime += End - Start;
+
+		if(Config()->m_SvHighBandwidth || (m_CurrentGameTick % 2) == 0)
+		{
+			Start = End;
+			{
+				CProfileScope Scope(&m_Profiler, m_ProfileSnap);
+				DoSnapshot();
+			}
+			SnapTime += time_get() - Start;
+		}
+
+		m_Profiler.EndTick();
+	}
+	int64_t TotalTime = time_get() - m_GameStartTime;
+
+	// report
+	double Seconds = TotalTime / (double) time_freq();
+	double TicksPerSecond = Seconds > 0.0 ? NumTicks / Seconds : 0.0;
+	str_format(aBuf, sizeof(aBuf), "ticks=%d time=%.3fs ticks/sec=%.1f realtime=%.1fx", NumTicks, Seconds, TicksPerSecond, TicksPerSecond / SERVER_TICK_SPEED);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+
+	int64_t Div = time_freq() / 1000000 * maximum(1, NumTicks);
+	str_format(aBuf, sizeof(aBuf), "avg per tick: input=%dus tick=%dus snap=%dus", (int) (InputTime / Div), (int) (TickTime / Div), (int) (SnapTime / Div));
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+
+	str_format(aBuf, sizeof(aBuf), "snapshots=%d snap_bytes=%lld avg=%d bytes/snap msg_bytes=%lld", m_BenchmarkNumSnaps, (long long) m_BenchmarkSnapBytes,
+		(int) (m_BenchmarkSnapBytes / maximum(1, m_BenchmarkNumSnaps)), (long long) m_BenchmarkMsgBytes);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+
+	// the last profiler window, per section
+	ConProfile(0, this);
+
+	if(m_NumSnapThreads > 0)
+	{
+		m_SnapJobPool.Shutdown();
+		sphore_destroy(&m_SnapJobsDone);
+	}
+
+	GameServer()->OnShutdown();
+	Free();
+
+	return 0;
+}
+
+void CServer::BenchmarkJoin(int ClientID, bool Human)
+{
+	// walk the client through the states a real connection takes
+	NewClientCallback(ClientID, this);
+	m_aClients[ClientID].m_Version = BENCHMARK_CLIENTVERSION;
+	m_aClients[ClientID].m_State = CClient::STATE_READY;
+	GameServer()->OnClientConnected(ClientID, false);
+
+	char aName[MAX_NAME_LENGTH];
+	str_format(aName, sizeof(aName), "%s %d", Human ? "human" : "ghost", ClientID);
+	SetClientName(ClientID, aName);
+	GameServer()->OnBenchmarkJoin(ClientID, Human);
+
+	m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+	m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
+	GameServer()->OnClientEnter(ClientID);
+}
+
 void CServer::Free()
 {
 	if(m_pMap)
@@ -1582,11 +2018,7 @@ void CServer::Free()
 		delete m_pRegister;
 	}
 
-	if(m_pCurrentMapData)
-	{
-		mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = 0;
-	}
+	m_pCurrentMapData = 0;
 }
 
 struct CSubdirCallbackUserdata
@@ -1681,14 +2113,46 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 				const char *pAuthStr = pThis->m_aClients[i].m_Authed == CServer::AUTHED_ADMIN ? "(Admin)" :
 						       pThis->m_aClients[i].m_Authed == CServer::AUTHED_MOD   ? "(Mod)" :
 														"";
-				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s client=%x name='%s' score=%d %s", i, aAddrStr,
-					pThis->m_aClients[i].m_Version, pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_Score, pAuthStr);
+				const CSnapshotStorage *pSnapshots = &pThis->m_aClients[i].m_Snapshots;
+				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s client=%x name='%s' score=%d snapshots=%d/%dKiB %s", i, aAddrStr,
+					pThis->m_aClients[i].m_Version, pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_Score,
+					pSnapshots->NumSnapshots(), pSnapshots->MemoryUsage() / 1024, pAuthStr);
 			}
 			else
 				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s connecting", i, aAddrStr);
 			pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 		}
 	}
+
+	str_format(aBuf, sizeof(aBuf), "server info requests: answered=%d dropped=%d", pThis->m_NumInfoResponses, pThis->m_NumInfoRequestsDropped);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+
+	if(pThis->m_DemoRecorder.IsRecording())
+	{
+		str_format(aBuf, sizeof(aBuf), "demo recorder: length=%ds backlog=%d max_backlog=%d dropped=%d", pThis->m_DemoRecorder.Length(),
+			pThis->m_DemoRecorder.Backlog(), pThis->m_DemoRecorder.MaxBacklog(), pThis->m_DemoRecorder.NumDroppedChunks());
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
+void CServer::ConInputStats(IConsole::IResult *pResult, void *pUser)
+{
+	char aBuf[384];
+	CServer *pThis = static_cast<CServer *>(pUser);
+	int ClientID = pResult->NumArguments() ? pResult->GetInteger(0) : -1;
+
+	for(int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if((ClientID != -1 && i != ClientID) || pThis->m_aClients[i].m_State != CClient::STATE_INGAME)
+			continue;
+
+		const CClient::CInputStats *pStats = &pThis->m_aClients[i].m_InputStats;
+		int AvgTimeLeft = pStats->m_NumReceived ? (int) (pStats->m_TimeLeftSum / pStats->m_NumReceived) : 0;
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' received=%d late=%d (moved to the next tick, replacing its input) duplicate=%d dropped=%d missed=%d time_left=%d/%d/%dms (min/avg/max)",
+			i, pThis->m_aClients[i].m_aName, pStats->m_NumReceived, pStats->m_NumLate, pStats->m_NumDuplicate, pStats->m_NumDropped,
+			pStats->m_NumMissed, pStats->m_MinTimeLeft, AvgTimeLeft, pStats->m_MaxTimeLeft);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
 }
 
 void CServer::ConShutdown(IConsole::IResult *pResult, void *pUser)
@@ -1747,11 +2211,79 @@ void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
 	((CServer *) pUser)->m_DemoRecorder.Stop();
 }
 
+void CServer::ConProfile(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *) pUser;
+	CProfiler *pProfiler = &pServer->m_Profiler;
+	if(!pProfiler->IsEnabled())
+	{
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", "profiler is disabled, enable it with sv_profiler 1");
+		return;
+	}
+
+	char aBuf[256];
+	for(int i = 0; i < pProfiler->NumSections(); i++)
+	{
+		CProfiler::CStats Stats;
+		pProfiler->GetStats(i, &Stats);
+		if(!Stats.m_NumSamples)
+			continue;
+		str_format(aBuf, sizeof(aBuf), "%-24s p50=%dus p99=%dus max=%dus samples=%d", pProfiler->SectionName(i), Stats.m_P50, Stats.m_P99, Stats.m_Max, Stats.m_NumSamples);
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+	}
+}
+
+void CServer::ConProfileDump(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *) pUser;
+	char aFilename[128];
+	if(pResult->NumArguments())
+		str_format(aFilename, sizeof(aFilename), "%s.json", pResult->GetString(0));
+	else
+	{
+		char aDate[20];
+		str_timestamp(aDate, sizeof(aDate));
+		str_format(aFilename, sizeof(aFilename), "profile_%s.json", aDate);
+	}
+
+	IOHANDLE File = pServer->Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	char aBuf[256];
+	if(!File)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to open '%s'", aFilename);
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+		return;
+	}
+
+	{
+		CJsonFileWriter Writer(File);
+		pServer->m_Profiler.WriteJson(&Writer);
+	}
+	str_format(aBuf, sizeof(aBuf), "profile written to '%s'", aFilename);
+	pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+}
+
 void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *) pUser)->m_MapReload = true;
 }
 
+void CServer::ConWarmMaps(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = (CServer *) pUser;
+	if(pThis->m_pMapWarmJob && !pThis->m_pMapWarmJob->Done())
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "maps are already being warmed");
+		return;
+	}
+
+	char aBuf[64];
+	str_format(aBuf, sizeof(aBuf), "warming %d maps in the background", pThis->m_lMaps.size());
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	pThis->m_pMapWarmJob = std::make_shared<CMapWarmJob>(pThis->Storage(), &pThis->m_MapHashCache, pThis->m_lMaps);
+	pThis->m_MapJobPool.Add(pThis->m_pMapWarmJob);
+}
+
 void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *) pUser;
@@ -1872,18 +2404,30 @@ void CServer::ConchainMapUpdate(IConsole::IResult *pResult, void *pUserData, ICo
 	}
 }
 
+void CServer::ConchainProfilerUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	CServer *pThis = static_cast<CServer *>(pUserData);
+	pThis->m_Profiler.SetEnabled(pThis->Config()->m_SvProfiler);
+}
+
 void CServer::RegisterCommands()
 {
 	// register console commands
 	Console()->Register("kick", "i[id] ?r[reason]", CFGFLAG_SERVER, ConKick, this, "Kick player with specified id for any reason");
 	Console()->Register("status", "", CFGFLAG_SERVER, ConStatus, this, "List players");
+	Console()->Register("input_stats", "?i[id]", CFGFLAG_SERVER, ConInputStats, this, "Show how the inputs of the players arrived");
 	Console()->Register("shutdown", "?r[reason]", CFGFLAG_SERVER, ConShutdown, this, "Shut down");
 	Console()->Register("logout", "", CFGFLAG_SERVER | CFGFLAG_BASICACCESS, ConLogout, this, "Logout of rcon");
 
 	Console()->Register("record", "?s[file]", CFGFLAG_SERVER | CFGFLAG_STORE, ConRecord, this, "Record to a file");
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
 
+	Console()->Register("profile", "", CFGFLAG_SERVER, ConProfile, this, "Show how long the phases of recent ticks took");
+	Console()->Register("profile_dump", "?s[file]", CFGFLAG_SERVER, ConProfileDump, this, "Write the tick profile to a json file");
+
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
+	Console()->Register("warm_maps", "", CFGFLAG_SERVER, ConWarmMaps, this, "Read all maps of the map list in the background so map changes find them cached");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
@@ -1896,6 +2440,7 @@ void CServer::RegisterCommands()
 	Console()->Chain("console_output_level", ConchainConsoleOutputLevelUpdate, this);
 	Console()->Chain("sv_rcon_password", ConchainRconPasswordSet, this);
 	Console()->Chain("sv_map", ConchainMapUpdate, this);
+	Console()->Chain("sv_profiler", ConchainProfilerUpdate, this);
 
 	// register console commands in sub parts
 	m_ServerBan.InitServerBan(Console(), Storage(), this);
@@ -1951,13 +2496,13 @@ int main(int argc, const char **argv)
 #endif
 
 	bool UseDefaultConfig = false;
+	bool Benchmark = false;
 	for(int i = 1; i < argc; i++)
 	{
 		if(str_comp("-d", argv[i]) == 0 || str_comp("--default", argv[i]) == 0)
-		{
 			UseDefaultConfig = true;
-			break;
-		}
+		else if(str_comp("--bench", argv[i]) == 0)
+			Benchmark = true;
 	}
 
 	if(secure_random_init() != 0)
@@ -2023,8 +2568,17 @@ int main(int argc, const char **argv)
 	pServer->InitRconPasswordIfUnset();
 
 	// run the server
-	dbg_msg("server", "starting...");
-	int Ret = pServer->Run();
+	int Ret;
+	if(Benchmark)
+	{
+		dbg_msg("server", "starting benchmark...");
+		Ret = pServer->RunBenchmark();
+	}
+	else
+	{
+		dbg_msg("server", "starting...");
+		Ret = pServer->Run();
+	}
 
 	// free
 	delete pServer;
@@ -6,8 +6,12 @@
 #include <base/tl/sorted_array.h>
 
 #include <engine/server.h>
+#include <engine/shared/datafile.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/profiler.h>
+#include <engine/shared/snapshot.h>
 
 class CSnapIDPool
 {
@@ -84,6 +88,7 @@ public:
 		MAX_MAPLISTENTRY_SEND = 32,
 		MIN_MAPLIST_CLIENTVERSION = 0x0703, // todo 0.8: remove me
 		MAX_RCONCMD_RATIO = 8,
+		BENCHMARK_CLIENTVERSION = 0x0705, // scripted players act as the newest 0.7 client
 	};
 
 	struct CMapListEntry;
@@ -102,7 +107,10 @@ public:
 
 			SNAPRATE_INIT = 0,
 			SNAPRATE_FULL,
-			SNAPRATE_RECOVER
+			SNAPRATE_RECOVER,
+
+			// inputs are queued at most this many ticks ahead
+			INPUT_RING_SIZE = 200,
 		};
 
 		class CInput
@@ -112,6 +120,34 @@ public:
 			int m_GameTick; // the tick that was chosen for the input
 		};
 
+		// how the inputs of a client arrived, to diagnose lag
+		class CInputStats
+		{
+		public:
+			int m_NumReceived;
+			int m_NumLate; // arrived after their tick ran, moved to the next tick and replaced its input
+			int m_NumDuplicate; // replaced an input that was already queued for the tick, late ones not counted
+			int m_NumDropped; // too far ahead to be queued
+			int m_NumMissed; // ticks that ran without an input
+			int m_MinTimeLeft; // in milliseconds between the arrival and the intended tick
+			int m_MaxTimeLeft;
+			int64_t m_TimeLeftSum;
+		};
+
+		// delta and compression of the current snapshot, may run on a snap job thread
+		class CSnapPack
+		{
+		public:
+			const CSnapshot *m_pFrom;
+			CSnapshot *m_pTo;
+			int m_DeltaTick;
+			int m_Crc;
+			int m_CompSize; // packed delta, 0 if nothing changed and negative on failure
+			char m_aCompData[CSnapshot::MAX_SIZE];
+
+			void Process(const CSnapshotDelta *pSnapshotDelta);
+		};
+
 		// connection state info
 		int m_State;
 		int m_Latency;
@@ -122,8 +158,11 @@ public:
 		CSnapshotStorage m_Snapshots;
 
 		CInput m_LatestInput;
-		CInput m_aInputs[200]; // TODO: handle input better
-		int m_CurrentInput;
+		CInput m_aInputs[INPUT_RING_SIZE]; // indexed by tick
+		CInputStats m_InputStats;
+
+		bool m_SnapPending;
+		CSnapPack m_SnapPack;
 
 		char m_aName[MAX_NAME_ARRAY_SIZE];
 		char m_aClan[MAX_CLAN_ARRAY_SIZE];
@@ -145,12 +184,64 @@ public:
 		}
 
 		void Reset();
+
+		// returns the slot to store the input for GameTick in, or 0 if it is too far ahead
+		CInput *QueueInput(int GameTick, int CurrentTick);
+		CInput *GetInput(int GameTick);
 	};
 
 	CClient m_aClients[MAX_PLAYERS];
 
+	class CSnapJob : public IJob
+	{
+		CClient::CSnapPack *m_pPack;
+		const CSnapshotDelta *m_pSnapshotDelta;
+		SEMAPHORE *m_pDone;
+
+		void Run() override;
+
+	public:
+		CSnapJob(CClient::CSnapPack *pPack, const CSnapshotDelta *pSnapshotDelta, SEMAPHORE *pDone) :
+			m_pPack(pPack), m_pSnapshotDelta(pSnapshotDelta), m_pDone(pDone) {}
+	};
+
+	class CMapLoadJob : public IJob
+	{
+		IStorage *m_pStorage;
+		CDataFileHashCache *m_pHashCache;
+		IEngineMap *m_pMap;
+		char m_aName[64];
+		bool m_Loaded;
+
+		void Run() override;
+
+	public:
+		CMapLoadJob(IStorage *pStorage, CDataFileHashCache *pHashCache, const char *pName);
+		~CMapLoadJob();
+
+		const char *Name() const { return m_aName; }
+		IEngineMap *Map() { return m_pMap; }
+		bool Loaded() const { return m_Loaded; }
+	};
+
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
+	CJobPool m_SnapJobPool;
+	SEMAPHORE m_SnapJobsDone;
+	int m_NumSnapThreads;
+	CProfiler m_Profiler;
+	int m_ProfileInput;
+	int m_ProfileTick;
+	int m_ProfileSnap;
+	int m_ProfileRegister;
+	int m_ProfileNetwork;
+
+	// headless benchmark, nothing is sent, only counted
+	bool m_Benchmark;
+	int64_t m_BenchmarkSnapBytes;
+	int m_BenchmarkNumSnaps;
+	int64_t m_BenchmarkMsgBytes;
+
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
@@ -175,7 +266,7 @@ public:
 	char m_aCurrentMap[64];
 	SHA256_DIGEST m_CurrentMapSha256;
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
+	const unsigned char *m_pCurrentMapData;
 	int m_CurrentMapSize;
 	int m_MapChunksPerRequest;
 
@@ -191,12 +282,53 @@ public:
 
 	sorted_array<CMapListEntry> m_lMaps;
 
+	// reads the maps once so later map changes find them in the file cache
+	class CMapWarmJob : public IJob
+	{
+		IStorage *m_pStorage;
+		CDataFileHashCache *m_pHashCache;
+		array<CMapListEntry> m_lMaps;
+
+		void Run() override;
+
+	public:
+		CMapWarmJob(IStorage *pStorage, CDataFileHashCache *pHashCache, const array<CMapListEntry> &lMaps) :
+			m_pStorage(pStorage), m_pHashCache(pHashCache), m_lMaps(lMaps) { Abortable(true); }
+	};
+
+	CDataFileHashCache m_MapHashCache;
+
+	CJobPool m_MapJobPool;
+	std::shared_ptr<CMapLoadJob> m_pMapLoadJob;
+	std::shared_ptr<CMapWarmJob> m_pMapWarmJob;
+	bool m_MapSwitchPending;
+
 	int m_RconPasswordSet;
 	int m_GeneratedRconPassword;
 
 	CDemoRecorder m_DemoRecorder;
 	bool m_ServerInfoNeedsUpdate;
 
+	// server info for browser requests without the token, rebuilt when it expires
+	CPacker m_ServerInfoCache;
+	bool m_ServerInfoCacheValid;
+	int64_t m_ServerInfoCacheTime;
+
+	// browser requests in the current second per hash of the source address
+	class CInfoRequestSource
+	{
+	public:
+		int64_t m_WindowStart;
+		int m_NumRequests;
+	};
+	enum
+	{
+		NUM_INFO_REQUEST_SOURCES = 256,
+	};
+	CInfoRequestSource m_aInfoRequestSources[NUM_INFO_REQUEST_SOURCES];
+	int m_NumInfoResponses;
+	int m_NumInfoRequestsDropped;
+
 	CServer();
 
 	void SetClientName(int ClientID, const char *pName) override;
@@ -230,6 +362,7 @@ public:
 	void GetClientAddr(int ClientID, char *pAddrStr, int Size) const override;
 
 	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) override;
+	void SendChunk(CNetChunk *pChunk);
 
 	void DoSnapshot();
 	void SendSnapshot();
@@ -252,20 +385,32 @@ public:
 	void ProcessClientPacket(CNetChunk *pPacket);
 
 	void ExpireServerInfo() override;
+	CProfiler *Profiler() override { return &m_Profiler; }
 	void UpdateRegisterServerInfo();
 	void UpdateServerInfo(bool Resend = false);
 
 	void SendServerInfo(int ClientID);
+	void AddServerInfo(CPacker *pPacker, bool Clients);
 	void GenerateServerInfo(CPacker *pPacker, int Token);
+	bool AllowInfoRequest(const NETADDR *pAddr);
 
 	void PumpNetwork();
 
 	void ChangeMap(const char *pMap) override;
+	void PreloadMap(const char *pMap) override;
+	void CancelPreload() override;
 	const char *GetMapName();
+	const char *GetCurrentMap() const override { return m_aCurrentMap; }
 	int LoadMap(const char *pMapName);
+	void StartMapLoad(const char *pMapName);
+	bool SwitchToLoadedMap(const char *pMapName);
+	void OnMapLoaded(const char *pMapName);
+	void FinishMapChange(bool Loaded);
 
 	void InitInterfaces(IKernel *pKernel);
 	int Run();
+	int RunBenchmark();
+	void BenchmarkJoin(int ClientID, bool Human);
 	void Free();
 
 	static int MapListEntryCallback(const char *pFilename, int IsDir, int DirType, void *pUser);
@@ -273,10 +418,14 @@ public:
 
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
 	static void ConStatus(IConsole::IResult *pResult, void *pUser);
+	static void ConInputStats(IConsole::IResult *pResult, void *pUser);
 	static void ConShutdown(IConsole::IResult *pResult, void *pUser);
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
+	static void ConProfile(IConsole::IResult *pResult, void *pUser);
+	static void ConProfileDump(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
+	static void ConWarmMaps(IConsole::IResult *pResult, void *pUser);
 	static void ConSaveConfig(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -287,6 +436,7 @@ public:
 	static void ConchainConsoleOutputLevelUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainRconPasswordSet(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMapUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainProfilerUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 
 	void RegisterCommands();
 
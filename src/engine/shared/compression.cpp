@@ -63,6 +63,49 @@ const unsigned char *CVariableInt::Unpack(const unsigned char *pSrc, int *pInOut
 	return pSrc;
 }
 
+unsigned char *CVariableInt::PackMany(unsigned char *pDst, const int *pSrc, int Num, int DstSize)
+{
+	const unsigned char *pDstEnd = pDst + DstSize;
+	const int *pSrcEnd = pSrc + Num;
+
+	// while the largest encoding fits, pack without checking each byte
+	while(pSrc != pSrcEnd && pDstEnd - pDst >= MAX_BYTES_PACKED * 4)
+	{
+		// four values in 0..63 take one byte each, snapshot deltas are mostly those
+		if(pSrcEnd - pSrc >= 4 && (unsigned) (pSrc[0] | pSrc[1] | pSrc[2] | pSrc[3]) < 0x40)
+		{
+			pDst[0] = pSrc[0];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[2];
+			pDst[3] = pSrc[3];
+			pDst += 4;
+			pSrc += 4;
+			continue;
+		}
+
+		const int Value = *pSrc++;
+		const int Mask = Value >> 31; // all bits set if negative
+		unsigned Rest = Value ^ Mask;
+		unsigned char Byte = (Mask & 0x40) | (Rest & 0x3F);
+		Rest >>= 6;
+		while(Rest)
+		{
+			*pDst++ = Byte | 0x80;
+			Byte = Rest & 0x7F;
+			Rest >>= 7;
+		}
+		*pDst++ = Byte;
+	}
+
+	for(; pSrc != pSrcEnd; pSrc++)
+	{
+		pDst = Pack(pDst, *pSrc, pDstEnd - pDst);
+		if(!pDst)
+			return 0;
+	}
+	return pDst;
+}
+
 long CVariableInt::Decompress(const void *pSrc_, int SrcSize, void *pDst_, int DstSize)
 {
 	dbg_assert(DstSize % sizeof(int) == 0, "invalid bounds");
@@ -71,6 +114,46 @@ long CVariableInt::Decompress(const void *pSrc_, int SrcSize, void *pDst_, int D
 	const unsigned char *pSrcEnd = pSrc + SrcSize;
 	int *pDst = (int *) pDst_;
 	const int *pDstEnd = pDst + DstSize / sizeof(int);
+
+	// while the largest encoding is in the input, unpack without checking each byte
+	while(pSrcEnd - pSrc >= MAX_BYTES_PACKED * 4 && pDstEnd - pDst >= 4)
+	{
+		// four bytes without extend bit are four values
+		if(!((pSrc[0] | pSrc[1] | pSrc[2] | pSrc[3]) & 0x80))
+		{
+			for(int i = 0; i < 4; i++)
+				pDst[i] = (pSrc[i] & 0x3F) ^ -((pSrc[i] >> 6) & 1);
+			pDst += 4;
+			pSrc += 4;
+			continue;
+		}
+
+		unsigned char Byte = *pSrc++;
+		const int Sign = (Byte >> 6) & 1;
+		int Value = Byte & 0x3F;
+		if(Byte & 0x80)
+		{
+			Byte = *pSrc++;
+			Value |= (Byte & 0x7F) << 6;
+			if(Byte & 0x80)
+			{
+				Byte = *pSrc++;
+				Value |= (Byte & 0x7F) << (6 + 7);
+				if(Byte & 0x80)
+				{
+					Byte = *pSrc++;
+					Value |= (Byte & 0x7F) << (6 + 7 + 7);
+					if(Byte & 0x80)
+					{
+						Byte = *pSrc++;
+						Value |= (Byte & 0x0F) << (6 + 7 + 7 + 7);
+					}
+				}
+			}
+		}
+		*pDst++ = Value ^ -Sign;
+	}
+
 	while(pSrc < pSrcEnd)
 	{
 		if(pDst >= pDstEnd)
@@ -87,17 +170,8 @@ long CVariableInt::Compress(const void *pSrc_, int SrcSize, void *pDst_, int Dst
 {
 	dbg_assert(SrcSize % sizeof(int) == 0, "invalid bounds");
 
-	const int *pSrc = (int *) pSrc_;
-	unsigned char *pDst = (unsigned char *) pDst_;
-	const unsigned char *pDstEnd = pDst + DstSize;
-	SrcSize /= sizeof(int);
-	while(SrcSize)
-	{
-		pDst = CVariableInt::Pack(pDst, *pSrc, pDstEnd - pDst);
-		if(!pDst)
-			return -1;
-		SrcSize--;
-		pSrc++;
-	}
+	unsigned char *pDst = PackMany((unsigned char *) pDst_, (const int *) pSrc_, SrcSize / sizeof(int), DstSize);
+	if(!pDst)
+		return -1;
 	return (long) (pDst - (unsigned char *) pDst_);
 }
@@ -14,6 +14,8 @@ public:
 
 	static unsigned char *Pack(unsigned char *pDst, int i, int DstSize);
 	static const unsigned char *Unpack(const unsigned char *pSrc, int *pInOut, int SrcSize);
+	// packs Num ints back to back, returns the end of the packed data or 0 if it doesn't fit
+	static unsigned char *PackMany(unsigned char *pDst, const int *pSrc, int Num, int DstSize);
 
 	static long Compress(const void *pSrc, int SrcSize, void *pDst, int DstSize);
 	static long Decompress(const void *pSrc, int SrcSize, void *pDst, int DstSize);
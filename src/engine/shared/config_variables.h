@@ -21,7 +21,15 @@ MACRO_CONFIG_INT(SvExternalPort, sv_external_port, 0, 0, 0, CFGFLAG_SAVE | CFGFL
 MACRO_CONFIG_STR(SvMap, sv_map, 128, "ghost_dm2", CFGFLAG_SAVE | CFGFLAG_SERVER, "Map to use on the server")
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 64, 1, MAX_PLAYERS, CFGFLAG_SAVE | CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_PLAYERS, CFGFLAG_SAVE | CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
+MACRO_CONFIG_INT(SvMapPreload, sv_map_preload, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Load the next map in the background and keep the current one running until it is ready")
 MACRO_CONFIG_INT(SvMapDownloadSpeed, sv_map_download_speed, 8, 1, 16, CFGFLAG_SAVE | CFGFLAG_SERVER, "Number of map data packages a client gets on each request")
+MACRO_CONFIG_INT(SvSnapThreads, sv_snap_threads, 0, 0, 16, CFGFLAG_SAVE | CFGFLAG_SERVER, "Number of threads used to delta and compress client snapshots, 0 does it on the main thread (takes effect on server start)")
+MACRO_CONFIG_INT(SvProfiler, sv_profiler, 0, 0, 1, CFGFLAG_SERVER, "Time the phases of each tick, see the profile and profile_dump commands")
+MACRO_CONFIG_INT(BenchTicks, bench_ticks, 3000, 1, 1000000, CFGFLAG_SERVER, "Number of ticks a --bench run simulates")
+MACRO_CONFIG_INT(BenchHumans, bench_humans, 4, 0, MAX_PLAYERS, CFGFLAG_SERVER, "Number of scripted humans in a --bench run")
+MACRO_CONFIG_INT(BenchGhosts, bench_ghosts, 12, 0, MAX_PLAYERS, CFGFLAG_SERVER, "Number of scripted ghosts in a --bench run")
+MACRO_CONFIG_INT(BenchSeed, bench_seed, 1, 0, 0, CFGFLAG_SERVER, "Seed of the scripted input and the game's random numbers of a --bench run, the same seed replays the same game")
+MACRO_CONFIG_INT(SvInfoRequestRate, sv_info_request_rate, 10, 0, 1000, CFGFLAG_SAVE | CFGFLAG_SERVER, "Server info requests answered per second for each address, 0 answers all")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
 MACRO_CONFIG_STR(SvRegister, sv_register, 16, "1", CFGFLAG_SERVER, "Register server with master server for public listing, can also accept a comma-separated list of protocols to register on, like 'ipv4,ipv6'")
 MACRO_CONFIG_STR(SvRegisterExtra, sv_register_extra, 256, "", CFGFLAG_SERVER, "Extra headers to send to the register endpoint, comma-separated 'Header: Value' pairs")
@@ -905,9 +905,10 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 			i++;
 		}
 		else if(!str_comp("-s", ppArguments[i]) || !str_comp("--silent", ppArguments[i]) ||
-			!str_comp("-d", ppArguments[i]) || !str_comp("--default", ppArguments[i]))
+			!str_comp("-d", ppArguments[i]) || !str_comp("--default", ppArguments[i]) ||
+			!str_comp("--bench", ppArguments[i]))
 		{
-			// skip silent, default param
+			// skip silent, default, bench param
 			continue;
 		}
 		else
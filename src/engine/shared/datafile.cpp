@@ -5,9 +5,12 @@
 #include <base/hash_ctxt.h>
 #include <base/math.h>
 #include <base/system.h>
+#include <engine/shared/linereader.h>
 #include <engine/storage.h>
 #include <zlib.h>
 
+#include <cstdio>
+
 static const int DEBUG = 0;
 
 struct CDatafileItemType
@@ -59,7 +62,10 @@ struct CDatafileInfo
 
 struct CDatafile
 {
-	IOHANDLE m_File;
+	unsigned char *m_pFileData; // the file exactly as on disk, served for map downloads
+	unsigned char *m_pMappedData; // private view of the same file that loaded data may point into, 0 if not mapped
+	unsigned m_FileSize;
+	bool m_FileMapped;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
@@ -70,50 +76,226 @@ struct CDatafile
 	char *m_pData;
 };
 
-bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
+static void FreeFileData(unsigned char *pFileData, unsigned char *pMappedData, unsigned FileSize, bool FileMapped)
 {
-	dbg_msg("datafile", "loading. filename='%s'", pFilename);
+	io_unmap(pMappedData, FileSize);
+	if(FileMapped)
+		io_unmap(pFileData, FileSize);
+	else
+		mem_free(pFileData);
+}
+
+struct CCrcJob
+{
+	const unsigned char *m_pData;
+	unsigned m_Size;
+	unsigned m_Crc;
+};
+
+static void CrcThread(void *pUser)
+{
+	CCrcJob *pJob = static_cast<CCrcJob *>(pUser);
+	pJob->m_Crc = crc32(crc32(0L, 0x0, 0), pJob->m_pData, pJob->m_Size);
+}
+
+static void HashFileData(const unsigned char *pData, unsigned Size, SHA256_DIGEST *pSha256, unsigned *pCrc)
+{
+	enum
+	{
+		PARALLEL_HASH_SIZE = 256 * 1024,
+	};
+
+	// take the crc on a second thread while this one does the sha256,
+	// small files are done before a thread would be up
+	CCrcJob CrcJob = {pData, Size, 0};
+	void *pCrcThread = Size >= PARALLEL_HASH_SIZE ? thread_init(CrcThread, &CrcJob) : 0;
+	if(!pCrcThread)
+		CrcThread(&CrcJob);
 
-	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	SHA256_CTX Sha256Ctx;
+	sha256_init(&Sha256Ctx);
+	sha256_update(&Sha256Ctx, pData, Size);
+	*pSha256 = sha256_finish(&Sha256Ctx);
+
+	if(pCrcThread)
+		thread_wait(pCrcThread);
+	*pCrc = CrcJob.m_Crc;
+}
+
+CDataFileHashCache::CDataFileHashCache()
+{
+	m_Changed = false;
+}
+
+CDataFileHashCache::CEntry *CDataFileHashCache::FindEntry(const char *pPath)
+{
+	for(auto &Entry : m_vEntries)
+		if(str_comp(Entry.m_aPath, pPath) == 0)
+			return &Entry;
+	return 0;
+}
+
+bool CDataFileHashCache::Load(IStorage *pStorage, const char *pFilename)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
 	if(!File)
+		return false;
+
+	const CLockScope LockScope(m_Lock);
+	m_vEntries.clear();
+	m_Changed = false;
+
+	// one entry per line: sha256 crc size modified path
+	CLineReader LineReader;
+	LineReader.Init(File);
+	const char *pLine;
+	while((pLine = LineReader.Get()))
 	{
-		dbg_msg("datafile", "could not open '%s'", pFilename);
+		char aSha256[SHA256_MAXSTRSIZE];
+		CEntry Entry;
+		long long Modified;
+		int PathOffset = -1;
+		if(sscanf(pLine, "%64s %x %u %lld %n", aSha256, &Entry.m_Crc, &Entry.m_Size, &Modified, &PathOffset) < 4 || PathOffset < 0 || !pLine[PathOffset] || sha256_from_str(&Entry.m_Sha256, aSha256))
+			continue;
+		Entry.m_Modified = Modified;
+		str_copy(Entry.m_aPath, pLine + PathOffset, sizeof(Entry.m_aPath));
+		m_vEntries.push_back(Entry);
+	}
+	io_close(File);
+	return true;
+}
+
+bool CDataFileHashCache::Save(IStorage *pStorage, const char *pFilename)
+{
+	const CLockScope LockScope(m_Lock);
+	if(!m_Changed)
+		return true;
+
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
 		return false;
+
+	for(const auto &Entry : m_vEntries)
+	{
+		char aSha256[SHA256_MAXSTRSIZE];
+		sha256_str(Entry.m_Sha256, aSha256, sizeof(aSha256));
+		char aBuf[IO_MAX_PATH_LENGTH + 128];
+		str_format(aBuf, sizeof(aBuf), "%s %08x %u %lld %s", aSha256, Entry.m_Crc, Entry.m_Size, (long long) Entry.m_Modified, Entry.m_aPath);
+		io_write(File, aBuf, str_length(aBuf));
+		io_write_newline(File);
 	}
+	io_close(File);
+	m_Changed = false;
+	return true;
+}
 
-	// take the hashes of the file and store them
-	SHA256_CTX Sha256Ctx;
-	sha256_init(&Sha256Ctx);
-	unsigned Crc = crc32(0L, 0x0, 0);
+bool CDataFileHashCache::Find(const char *pPath, unsigned Size, int64_t Modified, SHA256_DIGEST *pSha256, unsigned *pCrc)
+{
+	const CLockScope LockScope(m_Lock);
+	const CEntry *pEntry = FindEntry(pPath);
+	if(!pEntry || pEntry->m_Size != Size || pEntry->m_Modified != Modified)
+		return false;
+	*pSha256 = pEntry->m_Sha256;
+	*pCrc = pEntry->m_Crc;
+	return true;
+}
+
+void CDataFileHashCache::Add(const char *pPath, unsigned Size, int64_t Modified, const SHA256_DIGEST &Sha256, unsigned Crc)
+{
+	const CLockScope LockScope(m_Lock);
+	CEntry *pEntry = FindEntry(pPath);
+	if(!pEntry)
 	{
-		enum
-		{
-			BUFFER_SIZE = 64 * 1024
-		};
+		m_vEntries.emplace_back();
+		pEntry = &m_vEntries.back();
+		str_copy(pEntry->m_aPath, pPath, sizeof(pEntry->m_aPath));
+	}
+	pEntry->m_Size = Size;
+	pEntry->m_Modified = Modified;
+	pEntry->m_Sha256 = Sha256;
+	pEntry->m_Crc = Crc;
+	m_Changed = true;
+}
 
-		unsigned char aBuffer[BUFFER_SIZE];
+int CDataFileHashCache::Num()
+{
+	const CLockScope LockScope(m_Lock);
+	return m_vEntries.size();
+}
 
-		while(1)
+static bool IsMappedData(const CDatafile *pDataFile, const char *pData)
+{
+	const char *pMapped = (const char *) pDataFile->m_pMappedData;
+	return pMapped && pData >= pMapped && pData < pMapped + pDataFile->m_FileSize;
+}
+
+bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType, CDataFileHashCache *pHashCache)
+{
+	dbg_msg("datafile", "loading. filename='%s'", pFilename);
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aPath, sizeof(aPath));
+	if(!File)
+	{
+		dbg_msg("datafile", "could not open '%s'", pFilename);
+		return false;
+	}
+
+	// the hash cache is keyed by the time of the opened file, not of whatever has the name by now.
+	// take it before reading, a later change in place then only makes the cache miss
+	time_t Created, Modified;
+	const bool HasFileTime = pHashCache && io_file_time(File, &Created, &Modified) == 0;
+
+	// map the file twice: one view stays identical to the file for the hashes
+	// and map downloads, the other backs data that callers may modify in place.
+	// fall back to reading the file once if it cannot be mapped
+	unsigned FileSize = 0;
+	unsigned char *pFileData = (unsigned char *) io_map(File, &FileSize);
+	unsigned char *pMappedData = 0;
+	const bool FileMapped = pFileData != 0;
+	if(FileMapped)
+	{
+		unsigned MappedSize;
+		pMappedData = (unsigned char *) io_map(File, &MappedSize);
+		if(pMappedData && MappedSize != FileSize)
 		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes == 0)
-				break;
-			sha256_update(&Sha256Ctx, aBuffer, Bytes);
-			Crc = crc32(Crc, aBuffer, Bytes);
+			io_unmap(pMappedData, MappedSize);
+			pMappedData = 0;
 		}
+	}
+	else
+	{
+		void *pBuffer;
+		io_read_all(File, &pBuffer, &FileSize);
+		pFileData = (unsigned char *) pBuffer;
+	}
+	io_close(File);
 
-		io_seek(File, 0, IOSEEK_START);
+	// take the hashes of the file, unless the cache has them for this version of it
+	SHA256_DIGEST Sha256;
+	unsigned Crc;
+	if(!HasFileTime || !pHashCache->Find(aPath, FileSize, Modified, &Sha256, &Crc))
+	{
+		HashFileData(pFileData, FileSize, &Sha256, &Crc);
+		if(HasFileTime)
+			pHashCache->Add(aPath, FileSize, Modified, Sha256, Crc);
 	}
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	io_read(File, &Header, sizeof(Header));
+	if(FileSize < sizeof(Header))
+	{
+		dbg_msg("datafile", "file too short. size=%u", FileSize);
+		FreeFileData(pFileData, pMappedData, FileSize, FileMapped);
+		return false;
+	}
+	mem_copy(&Header, pFileData, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
-			io_close(File);
+			FreeFileData(pFileData, pMappedData, FileSize, FileMapped);
 			return 0;
 		}
 	}
@@ -124,11 +306,11 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
-		io_close(File);
+		FreeFileData(pFileData, pMappedData, FileSize, FileMapped);
 		return 0;
 	}
 
-	// read in the rest except the data
+	// size of the types, offsets, sizes and item data
 	int64_t Size = 0;
 	Size += Header.m_NumItemTypes * sizeof(CDatafileItemType);
 	Size += (Header.m_NumItems + Header.m_NumRawData) * sizeof(int);
@@ -136,42 +318,51 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		Size += Header.m_NumRawData * sizeof(int); // v4 has uncompressed data sizes aswell
 	Size += Header.m_ItemSize;
 
-	int64_t AllocSize = Size;
+	// without a private mapping the item data is copied behind the info structure
+	const bool CopyItems = pMappedData == 0;
+
+	int64_t AllocSize = 0;
 	AllocSize += sizeof(CDatafile); // add space for info structure
 	AllocSize += Header.m_NumRawData * sizeof(void *); // add space for data pointers
 	AllocSize += Header.m_NumRawData * sizeof(int); // add space for data sizes
-	if(Size > (int64_t(1) << 31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0)
+	if(CopyItems)
+		AllocSize += Size;
+	if(Size > (int64_t(1) << 31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0 || Header.m_DataSize < 0)
 	{
-		io_close(File);
+		FreeFileData(pFileData, pMappedData, FileSize, FileMapped);
 		dbg_msg("datafile", "unable to load file, invalid file information");
 		return false;
 	}
+	if(int64_t(sizeof(CDatafileHeader)) + Size + Header.m_DataSize > FileSize)
+	{
+		FreeFileData(pFileData, pMappedData, FileSize, FileMapped);
+		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%u", unsigned(sizeof(CDatafileHeader) + Size + Header.m_DataSize), FileSize);
+		return false;
+	}
 
 	CDatafile *pTmpDataFile = (CDatafile *) mem_alloc(AllocSize);
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
 	pTmpDataFile->m_ppDataPtrs = (char **) (pTmpDataFile + 1);
 	pTmpDataFile->m_pDataSizes = (int *) (pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
-	pTmpDataFile->m_pData = (char *) (pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
-	pTmpDataFile->m_File = File;
-	pTmpDataFile->m_Sha256 = sha256_finish(&Sha256Ctx);
+	if(CopyItems)
+	{
+		pTmpDataFile->m_pData = (char *) (pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
+		mem_copy(pTmpDataFile->m_pData, pFileData + sizeof(CDatafileHeader), Size);
+	}
+	else
+		pTmpDataFile->m_pData = (char *) pMappedData + sizeof(CDatafileHeader);
+	pTmpDataFile->m_pFileData = pFileData;
+	pTmpDataFile->m_pMappedData = pMappedData;
+	pTmpDataFile->m_FileSize = FileSize;
+	pTmpDataFile->m_FileMapped = FileMapped;
+	pTmpDataFile->m_Sha256 = Sha256;
 	pTmpDataFile->m_Crc = Crc;
 
 	// clear the data pointers and sizes
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData * sizeof(void *));
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
 
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
-	{
-		io_close(pTmpDataFile->m_File);
-		mem_free(pTmpDataFile);
-		pTmpDataFile = 0;
-		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", unsigned(Size), ReadSize);
-		return false;
-	}
-
 	Close();
 	m_pDataFile = pTmpDataFile;
 
@@ -182,7 +373,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	// if(DEBUG)
 	{
 		dbg_msg("datafile", "allocsize=%d", unsigned(AllocSize));
-		dbg_msg("datafile", "readsize=%d", ReadSize);
+		dbg_msg("datafile", "filesize=%u mapped=%d", FileSize, FileMapped);
 		dbg_msg("datafile", "swaplen=%d", Header.m_Swaplen);
 		dbg_msg("datafile", "item_size=%d", m_pDataFile->m_Header.m_ItemSize);
 	}
@@ -296,34 +487,47 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	{
 		// fetch the data size
 		int DataSize = GetFileDataSize(Index);
+		int Offset = m_pDataFile->m_Info.m_pDataOffsets[Index];
+		if(DataSize < 0 || Offset < 0 || Offset > m_pDataFile->m_Header.m_DataSize - DataSize)
+		{
+			dbg_msg("datafile", "invalid data index=%d offset=%d size=%d", Index, Offset, DataSize);
+			return 0;
+		}
+		const int FileOffset = m_pDataFile->m_DataStartOffset + Offset;
 #if defined(CONF_ARCH_ENDIAN_BIG)
 		int SwapSize = DataSize;
 #endif
 
 		if(m_pDataFile->m_Header.m_Version == 4)
 		{
-			// v4 has compressed data
-			void *pTemp = (char *) mem_alloc(DataSize);
+			// v4 has compressed data, inflate it straight from the file data
+			if(m_pDataFile->m_Info.m_pDataSizes[Index] < 0)
+			{
+				dbg_msg("datafile", "invalid data index=%d uncompressed=%d", Index, m_pDataFile->m_Info.m_pDataSizes[Index]);
+				return 0;
+			}
 			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
+			unsigned long s = UncompressedSize;
 
 			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%lu", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *) mem_alloc(UncompressedSize);
+			char *pData = (char *) mem_alloc(UncompressedSize);
+			if(uncompress((Bytef *) pData, &s, (const Bytef *) m_pDataFile->m_pFileData + FileOffset, DataSize) != Z_OK)
+			{
+				dbg_msg("datafile", "failed to decompress data index=%d", Index);
+				mem_free(pData);
+				return 0;
+			}
+			m_pDataFile->m_ppDataPtrs[Index] = pData;
 			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
-
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
-
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef *) m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef *) pTemp, DataSize);
 #if defined(CONF_ARCH_ENDIAN_BIG)
 			SwapSize = s;
 #endif
-
-			// clean up the temporary buffers
-			mem_free(pTemp);
+		}
+		else if(m_pDataFile->m_pMappedData && DataSize > 0)
+		{
+			// point into the private mapping, pages are only copied if they get written
+			m_pDataFile->m_ppDataPtrs[Index] = (char *) m_pDataFile->m_pMappedData + FileOffset;
+			m_pDataFile->m_pDataSizes[Index] = DataSize;
 		}
 		else
 		{
@@ -331,8 +535,7 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
 			m_pDataFile->m_ppDataPtrs[Index] = (char *) mem_alloc(DataSize);
 			m_pDataFile->m_pDataSizes[Index] = DataSize;
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			mem_copy(m_pDataFile->m_ppDataPtrs[Index], m_pDataFile->m_pFileData + FileOffset, DataSize);
 		}
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
@@ -372,7 +575,8 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
-	mem_free(m_pDataFile->m_ppDataPtrs[Index]);
+	if(!IsMappedData(m_pDataFile, m_pDataFile->m_ppDataPtrs[Index]))
+		mem_free(m_pDataFile->m_ppDataPtrs[Index]);
 	m_pDataFile->m_ppDataPtrs[Index] = 0x0;
 	m_pDataFile->m_pDataSizes[Index] = 0;
 }
@@ -470,16 +674,24 @@ bool CDataFileReader::Close()
 	int i;
 	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 	{
-		mem_free(m_pDataFile->m_ppDataPtrs[i]);
+		if(!IsMappedData(m_pDataFile, m_pDataFile->m_ppDataPtrs[i]))
+			mem_free(m_pDataFile->m_ppDataPtrs[i]);
 		m_pDataFile->m_pDataSizes[i] = 0;
 	}
 
-	io_close(m_pDataFile->m_File);
+	FreeFileData(m_pDataFile->m_pFileData, m_pDataFile->m_pMappedData, m_pDataFile->m_FileSize, m_pDataFile->m_FileMapped);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
 	return true;
 }
 
+void CDataFileReader::Swap(CDataFileReader &Other)
+{
+	CDatafile *pDataFile = m_pDataFile;
+	m_pDataFile = Other.m_pDataFile;
+	Other.m_pDataFile = pDataFile;
+}
+
 SHA256_DIGEST CDataFileReader::Sha256() const
 {
 	if(!m_pDataFile)
@@ -494,6 +706,20 @@ unsigned CDataFileReader::Crc() const
 	return m_pDataFile->m_Crc;
 }
 
+const unsigned char *CDataFileReader::FileData() const
+{
+	if(!m_pDataFile)
+		return 0;
+	return m_pDataFile->m_pFileData;
+}
+
+unsigned CDataFileReader::FileSize() const
+{
+	if(!m_pDataFile)
+		return 0;
+	return m_pDataFile->m_FileSize;
+}
+
 bool CDataFileReader::CheckSha256(IOHANDLE Handle, const void *pSha256)
 {
 	// read the hash of the file
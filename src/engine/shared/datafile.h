@@ -4,8 +4,39 @@
 #define ENGINE_SHARED_DATAFILE_H
 
 #include <base/hash.h>
+#include <base/lock.h>
 #include <base/system.h>
 
+#include <vector>
+
+// remembers the hashes of datafiles by path, size and modification time
+class CDataFileHashCache
+{
+	struct CEntry
+	{
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		unsigned m_Size;
+		int64_t m_Modified;
+		SHA256_DIGEST m_Sha256;
+		unsigned m_Crc;
+	};
+
+	CLock m_Lock;
+	std::vector<CEntry> m_vEntries GUARDED_BY(m_Lock);
+	bool m_Changed GUARDED_BY(m_Lock);
+
+	CEntry *FindEntry(const char *pPath) REQUIRES(m_Lock);
+
+public:
+	CDataFileHashCache();
+
+	bool Load(class IStorage *pStorage, const char *pFilename) REQUIRES(!m_Lock);
+	bool Save(class IStorage *pStorage, const char *pFilename) REQUIRES(!m_Lock); // only writes if something changed
+	bool Find(const char *pPath, unsigned Size, int64_t Modified, SHA256_DIGEST *pSha256, unsigned *pCrc) REQUIRES(!m_Lock);
+	void Add(const char *pPath, unsigned Size, int64_t Modified, const SHA256_DIGEST &Sha256, unsigned Crc) REQUIRES(!m_Lock);
+	int Num() REQUIRES(!m_Lock);
+};
+
 // raw datafile access
 class CDataFileReader
 {
@@ -21,8 +52,9 @@ public:
 
 	bool IsOpen() const { return m_pDataFile != 0; }
 
-	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
+	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType, CDataFileHashCache *pHashCache = 0);
 	bool Close();
+	void Swap(CDataFileReader &Other);
 
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
@@ -40,6 +72,10 @@ public:
 	SHA256_DIGEST Sha256() const;
 	unsigned Crc() const;
 
+	// the whole file as stored on disk, valid until the reader is closed
+	const unsigned char *FileData() const;
+	unsigned FileSize() const;
+
 	static bool CheckSha256(IOHANDLE Handle, const void *pSha256);
 };
 
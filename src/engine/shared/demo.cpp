@@ -24,7 +24,17 @@ CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 {
 	m_File = 0;
 	m_LastTickMarker = -1;
+	m_FirstRecordedTick = -1;
+	m_LastRecordedTick = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
+	m_pQueue = 0;
+	m_QueueRead = 0;
+	m_QueueWrite = 0;
+	m_StopWriter = false;
+	m_pWriterThread = 0;
+	m_MapFile = 0;
+	m_NumDroppedChunks = 0;
+	m_MaxBacklog = 0;
 	m_Huffman.Init();
 }
 
@@ -34,6 +44,36 @@ void CDemoRecorder::Init(class IConsole *pConsole, class IStorage *pStorage)
 	m_pStorage = pStorage;
 }
 
+/*
+	Tickmarker
+		7	= Always set
+		6	= Keyframe flag
+		0-5	= Delta tick
+
+	Normal
+		7 = Not set
+		5-6	= Type
+		0-4	= Size
+*/
+
+enum
+{
+	CHUNKTYPEFLAG_TICKMARKER = 0x80,
+	CHUNKTICKFLAG_KEYFRAME = 0x40, // only when tickmarker is set
+	CHUNKTICKFLAG_TICK_COMPRESSED = 0x20, // when we store the tick value in the first chunk
+
+	CHUNKMASK_TICK = 0x1f,
+	CHUNKMASK_TICK_LEGACY = 0x3f,
+	CHUNKMASK_TYPE = 0x60,
+	CHUNKMASK_SIZE = 0x1f,
+
+	CHUNKTYPE_SNAPSHOT = 1,
+	CHUNKTYPE_MESSAGE = 2,
+	CHUNKTYPE_DELTA = 3,
+
+	CHUNKFLAG_BIGSIZE = 0x10
+};
+
 // Record
 int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const char *pMap, SHA256_DIGEST Sha256, unsigned Crc, const char *pType)
 {
@@ -106,59 +146,93 @@ int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const c
 	// Header.m_aTimelineMarkers - add this on stop
 	io_write(DemoFile, &Header, sizeof(Header));
 
-	// write map data
-	unsigned char aChunk[1024 * 64];
-	while(1)
-	{
-		int Bytes = io_read(MapFile, &aChunk, sizeof(aChunk));
-		if(Bytes <= 0)
-			break;
-		io_write(DemoFile, &aChunk, Bytes);
-	}
-	io_close(MapFile);
-
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
+	m_FirstRecordedTick = -1;
+	m_LastRecordedTick = -1;
 	m_NumTimelineMarkers = 0;
 
+	// the map data is copied by the writer before the first chunk
+	m_pQueue = (CQueuedChunk *) mem_alloc(sizeof(CQueuedChunk) * QUEUE_SIZE);
+	m_QueueRead = 0;
+	m_QueueWrite = 0;
+	m_StopWriter = false;
+	m_NumDroppedChunks = 0;
+	m_MaxBacklog = 0;
+	m_MapFile = MapFile;
+	m_File = DemoFile;
+	sphore_init(&m_QueueSignal);
+	m_pWriterThread = thread_init(WriterThread, this);
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
-	m_File = DemoFile;
 
 	return 0;
 }
 
-/*
-	Tickmarker
-		7	= Always set
-		6	= Keyframe flag
-		0-5	= Delta tick
+void CDemoRecorder::WriterThread(void *pUser)
+{
+	CDemoRecorder *pSelf = (CDemoRecorder *) pUser;
 
-	Normal
-		7 = Not set
-		5-6	= Type
-		0-4	= Size
-*/
+	// write map data
+	unsigned char aChunk[1024 * 64];
+	while(1)
+	{
+		int Bytes = io_read(pSelf->m_MapFile, &aChunk, sizeof(aChunk));
+		if(Bytes <= 0)
+			break;
+		io_write(pSelf->m_File, &aChunk, Bytes);
+	}
+	io_close(pSelf->m_MapFile);
+	pSelf->m_MapFile = 0;
 
-enum
-{
-	CHUNKTYPEFLAG_TICKMARKER = 0x80,
-	CHUNKTICKFLAG_KEYFRAME = 0x40, // only when tickmarker is set
-	CHUNKTICKFLAG_TICK_COMPRESSED = 0x20, // when we store the tick value in the first chunk
+	while(true)
+	{
+		sphore_wait(&pSelf->m_QueueSignal);
 
-	CHUNKMASK_TICK = 0x1f,
-	CHUNKMASK_TICK_LEGACY = 0x3f,
-	CHUNKMASK_TYPE = 0x60,
-	CHUNKMASK_SIZE = 0x1f,
+		unsigned Read = pSelf->m_QueueRead.load(std::memory_order_relaxed);
+		while(Read != pSelf->m_QueueWrite.load(std::memory_order_acquire))
+		{
+			const CQueuedChunk *pChunk = &pSelf->m_pQueue[Read & (QUEUE_SIZE - 1)];
+			if(pChunk->m_Type == CHUNKTYPE_SNAPSHOT)
+				pSelf->WriteSnapshot(pChunk->m_Tick, pChunk->m_aData, pChunk->m_Size);
+			else
+				pSelf->Write(pChunk->m_Type, pChunk->m_aData, pChunk->m_Size);
+			pSelf->m_QueueRead.store(++Read, std::memory_order_release);
+		}
 
-	CHUNKTYPE_SNAPSHOT = 1,
-	CHUNKTYPE_MESSAGE = 2,
-	CHUNKTYPE_DELTA = 3,
+		// everything before the stop has been written
+		if(pSelf->m_StopWriter.load(std::memory_order_acquire) && Read == pSelf->m_QueueWrite.load(std::memory_order_acquire))
+			break;
+	}
+}
 
-	CHUNKFLAG_BIGSIZE = 0x10
-};
+bool CDemoRecorder::Enqueue(int Type, int Tick, const void *pData, int Size)
+{
+	if(!m_File)
+		return false;
+
+	const unsigned Write = m_QueueWrite.load(std::memory_order_relaxed);
+	const int Backlog = Write - m_QueueRead.load(std::memory_order_acquire);
+	if(Backlog >= QUEUE_SIZE || Size > (int) sizeof(m_pQueue->m_aData))
+	{
+		// the writer can't keep up, better lose a chunk than the tick
+		m_NumDroppedChunks++;
+		return false;
+	}
+	m_MaxBacklog = maximum(m_MaxBacklog, Backlog + 1);
+
+	CQueuedChunk *pChunk = &m_pQueue[Write & (QUEUE_SIZE - 1)];
+	pChunk->m_Type = Type;
+	pChunk->m_Tick = Tick;
+	pChunk->m_Size = Size;
+	mem_copy(pChunk->m_aData, pData, Size);
+	m_QueueWrite.store(Write + 1, std::memory_order_release);
+	sphore_signal(&m_QueueSignal);
+	return true;
+}
 
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
@@ -187,9 +261,6 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
 {
-	if(!m_File)
-		return;
-
 	char aBuffer[64 * 1024];
 	char aBuffer2[64 * 1024];
 
@@ -201,13 +272,13 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	Size = CVariableInt::Compress(aBuffer2, Size, aBuffer, sizeof(aBuffer)); // buffer2 -> buffer
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during intpack compression");
+		dbg_msg("demo_recorder", "error during intpack compression");
 		return;
 	}
 	Size = m_Huffman.Compress(aBuffer, Size, aBuffer2, sizeof(aBuffer2)); // buffer -> buffer2
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during network compression");
+		dbg_msg("demo_recorder", "error during network compression");
 		return;
 	}
 
@@ -239,6 +310,16 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 }
 
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!Enqueue(CHUNKTYPE_SNAPSHOT, Tick, pData, Size))
+		return;
+
+	m_LastRecordedTick = Tick;
+	if(m_FirstRecordedTick < 0)
+		m_FirstRecordedTick = Tick;
+}
+
+void CDemoRecorder::WriteSnapshot(int Tick, const void *pData, int Size)
 {
 	char aTmpData[CSnapshot::MAX_SIZE];
 
@@ -272,7 +353,7 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	Enqueue(CHUNKTYPE_MESSAGE, -1, pData, Size);
 }
 
 int CDemoRecorder::Stop()
@@ -283,10 +364,19 @@ int CDemoRecorder::Stop()
 		return -1;
 	}
 
+	// let the writer finish the queued chunks
+	m_StopWriter.store(true, std::memory_order_release);
+	sphore_signal(&m_QueueSignal);
+	thread_wait(m_pWriterThread);
+	m_pWriterThread = 0;
+	sphore_destroy(&m_QueueSignal);
+	mem_free(m_pQueue);
+	m_pQueue = 0;
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	unsigned char aLength[4];
-	int_to_bytes_be(aLength, Length());
+	int_to_bytes_be(aLength, (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED);
 	io_write(m_File, aLength, sizeof(aLength));
 
 	// add the timeline markers to the header
@@ -306,15 +396,23 @@ int CDemoRecorder::Stop()
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
+	m_FirstRecordedTick = -1;
+	m_LastRecordedTick = -1;
 	m_NumTimelineMarkers = 0;
-	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording");
+
+	char aBuf[128];
+	if(m_NumDroppedChunks)
+		str_format(aBuf, sizeof(aBuf), "Stopped recording, %d chunks dropped (max backlog %d)", m_NumDroppedChunks, m_MaxBacklog);
+	else
+		str_copy(aBuf, "Stopped recording", sizeof(aBuf));
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
 
 	return 0;
 }
 
 void CDemoRecorder::AddDemoMarker()
 {
-	if(m_LastTickMarker < 0)
+	if(m_LastRecordedTick < 0)
 	{
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Cannot add timeline marker: demo recording not active");
 		return;
@@ -328,7 +426,7 @@ void CDemoRecorder::AddDemoMarker()
 	// not more than 1 marker in a second
 	if(m_NumTimelineMarkers > 0)
 	{
-		int Diff = m_LastTickMarker - m_aTimelineMarkers[m_NumTimelineMarkers - 1];
+		int Diff = m_LastRecordedTick - m_aTimelineMarkers[m_NumTimelineMarkers - 1];
 		if(Diff < SERVER_TICK_SPEED * 1.0f)
 		{
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Cannot add timeline marker: marker is too close to previous marker");
@@ -336,7 +434,7 @@ void CDemoRecorder::AddDemoMarker()
 		}
 	}
 
-	m_aTimelineMarkers[m_NumTimelineMarkers++] = m_LastTickMarker;
+	m_aTimelineMarkers[m_NumTimelineMarkers++] = m_LastRecordedTick;
 
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Added timeline marker");
 }
@@ -3,26 +3,66 @@
 #ifndef ENGINE_SHARED_DEMO_H
 #define ENGINE_SHARED_DEMO_H
 
+#include <base/system.h>
+
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
+#include <atomic>
+
 #include "huffman.h"
 #include "snapshot.h"
 
+// records on the calling thread only queue the data, a writer thread
+// does the delta, the compression and the file writes
 class CDemoRecorder : public IDemoRecorder
 {
+	enum
+	{
+		QUEUE_SIZE = 32, // power of two
+	};
+
+	struct CQueuedChunk
+	{
+		int m_Type;
+		int m_Tick;
+		int m_Size;
+		unsigned char m_aData[CSnapshot::MAX_SIZE];
+	};
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
-	CHuffman m_Huffman;
 	IOHANDLE m_File;
+	class CSnapshotDelta *m_pSnapshotDelta;
+	int m_NumTimelineMarkers;
+	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+
+	// ticks as recorded, the writer can be behind
+	int m_FirstRecordedTick;
+	int m_LastRecordedTick;
+
+	// single producer, single consumer queue
+	CQueuedChunk *m_pQueue;
+	std::atomic<unsigned> m_QueueRead;
+	std::atomic<unsigned> m_QueueWrite;
+	std::atomic<bool> m_StopWriter;
+	SEMAPHORE m_QueueSignal;
+	void *m_pWriterThread;
+	IOHANDLE m_MapFile;
+
+	int m_NumDroppedChunks;
+	int m_MaxBacklog;
+
+	// only used by the writer thread
+	CHuffman m_Huffman;
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
 	int m_FirstTick;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
-	class CSnapshotDelta *m_pSnapshotDelta;
-	int m_NumTimelineMarkers;
-	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
 
+	static void WriterThread(void *pUser);
+	bool Enqueue(int Type, int Tick, const void *pData, int Size);
+	void WriteSnapshot(int Tick, const void *pData, int Size);
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
 
@@ -39,7 +79,12 @@ public:
 
 	bool IsRecording() const { return m_File != 0; }
 
-	int Length() const { return (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED; }
+	int Length() const { return (m_LastRecordedTick - m_FirstRecordedTick) / SERVER_TICK_SPEED; }
+
+	// chunks waiting for the writer, the most there were and the ones that didn't fit into the queue
+	int Backlog() const { return m_File ? (int) (m_QueueWrite.load() - m_QueueRead.load()) : 0; }
+	int MaxBacklog() const { return m_MaxBacklog; }
+	int NumDroppedChunks() const { return m_NumDroppedChunks; }
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -125,73 +125,106 @@ void CHuffman::Init(const unsigned *pFrequencies)
 		if(k == HUFFMAN_LUTBITS)
 			m_apDecodeLut[i] = pNode;
 	}
+
+	// build the multi symbol decode LUT
+	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
+	{
+		CDecodeEntry *pEntry = &m_aDecodeMultiLut[i];
+		mem_zero(pEntry, sizeof(*pEntry));
+
+		unsigned Used = 0;
+		while(Used < HUFFMAN_LUTBITS)
+		{
+			// walk down the tree until we hit a symbol or run out of index bits
+			unsigned Bits = i >> Used;
+			unsigned k = Used;
+			const CNode *pNode = m_pStartNode;
+			while(k < HUFFMAN_LUTBITS && !pNode->m_NumBits)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+				Bits >>= 1;
+				k++;
+			}
+			if(!pNode->m_NumBits)
+				break;
+
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
+			{
+				pEntry->m_Eof = 1;
+				Used = k;
+				break;
+			}
+			if(pEntry->m_NumSymbols == HUFFMAN_LUTSYMBOLS)
+				break;
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
+			Used = k;
+		}
+		pEntry->m_NumBits = Used;
+	}
 }
 
 //***************************************************************
 int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-	Bitcount += m_aNodes[Sym].m_NumBits;
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	while(Bitcount >= 8) \
-	{ \
-		*pDst++ = (unsigned char) (Bits & 0xff); \
-		if(pDst == pDstEnd) \
-			return -1; \
-		Bits >>= 8; \
-		Bitcount -= 8; \
-	}
-
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *) pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *) pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// we always write at least one byte
+	if(OutputSize <= 0)
+		return -1;
+
+	// symbol variables, codes are never longer than 32 bits so flushing
+	// whenever we have 32 bits or more keeps everything in one word
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	while(pSrc != pSrcEnd)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		const CNode *pNode = &m_aNodes[*pSrc++];
+		Bits |= (uint64_t) pNode->m_Bits << Bitcount;
+		Bitcount += pNode->m_NumBits;
 
-		while(pSrc != pSrcEnd)
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE()
+			// flush all complete bytes, the last byte of the buffer is reserved for the tail
+			unsigned NumBytes = Bitcount >> 3;
+			if(pDstEnd - pDst <= (int) NumBytes)
+				return -1;
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+			if(pDstEnd - pDst >= (int) sizeof(Bits))
+				mem_copy(pDst, &Bits, sizeof(Bits));
+			else
+#endif
+			{
+				for(unsigned i = 0; i < NumBytes; i++)
+					pDst[i] = (unsigned char) (Bits >> (i * 8));
+			}
+			pDst += NumBytes;
+			Bits >>= NumBytes * 8;
+			Bitcount &= 7;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-		HUFFMAN_MACRO_WRITE()
 	}
 
 	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
-	HUFFMAN_MACRO_WRITE()
+	Bits |= (uint64_t) m_aNodes[HUFFMAN_EOF_SYMBOL].m_Bits << Bitcount;
+	Bitcount += m_aNodes[HUFFMAN_EOF_SYMBOL].m_NumBits;
+	while(Bitcount >= 8)
+	{
+		*pDst++ = (unsigned char) (Bits & 0xff);
+		if(pDst == pDstEnd)
+			return -1;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
 
 	// write out the last bits
-	*pDst++ = Bits;
+	*pDst++ = (unsigned char) Bits;
 
 	// return the size of the output
 	return (int) (pDst - (const unsigned char *) pOutput);
-
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
 }
 
 //***************************************************************
@@ -199,46 +232,76 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *) pOutput;
-	unsigned char *pSrc = (unsigned char *) pInput;
+	const unsigned char *pSrc = (const unsigned char *) pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
+	// bits above Bitcount may already hold the following input
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
 	const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
-	const CNode *pNode = 0;
 
 	while(true)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		pNode = 0;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		// {A} fill with new bits, a whole word at once if there is enough input left
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+		if(pSrcEnd - pSrc >= (int) sizeof(Bits))
+		{
+			uint64_t Word;
+			mem_copy(&Word, pSrc, sizeof(Word));
+			Bits |= Word << Bitcount;
+			pSrc += (63 - Bitcount) >> 3;
+			Bitcount |= 56;
+		}
+		else
+#endif
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
+			while(Bitcount <= 56 && pSrc != pSrcEnd)
+			{
+				Bits |= (uint64_t) (*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
 		}
 
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
+		// {B} output all symbols the multi symbol LUT has for these bits
+		const CDecodeEntry *pEntry = &m_aDecodeMultiLut[Bits & HUFFMAN_LUTMASK];
+		if(pEntry->m_NumBits && pEntry->m_NumBits <= Bitcount)
+		{
+			if(pDstEnd - pDst < pEntry->m_NumSymbols)
+				return -1;
+			for(int i = 0; i < pEntry->m_NumSymbols; i++)
+				pDst[i] = pEntry->m_aSymbols[i];
+			pDst += pEntry->m_NumSymbols;
+
+			Bits >>= pEntry->m_NumBits;
+			Bitcount -= pEntry->m_NumBits;
 
+			if(pEntry->m_Eof)
+				break;
+			continue;
+		}
+
+		// {C} long code or end of the input, decode a single symbol
+		const CNode *pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
 		if(!pNode)
 			return -1;
 
-		// {D} check if we hit a symbol already
 		if(pNode->m_NumBits)
 		{
+			// not enough bits left for this symbol, decoding error
+			if(pNode->m_NumBits > Bitcount)
+				return -1;
+
 			// remove the bits for that symbol
 			Bits >>= pNode->m_NumBits;
 			Bitcount -= pNode->m_NumBits;
 		}
 		else
 		{
+			if(Bitcount < HUFFMAN_LUTBITS)
+				return -1;
+
 			// remove the bits that the lut checked up for us
 			Bits >>= HUFFMAN_LUTBITS;
 			Bitcount -= HUFFMAN_LUTBITS;
@@ -246,6 +309,10 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 			// walk the tree bit by bit
 			while(true)
 			{
+				// no more bits, decoding error
+				if(Bitcount == 0)
+					return -1;
+
 				// traverse tree
 				pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
 
@@ -256,10 +323,6 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 				// check if we hit a symbol
 				if(pNode->m_NumBits)
 					break;
-
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
 			}
 		}
 
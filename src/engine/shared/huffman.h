@@ -12,9 +12,12 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS = HUFFMAN_EOF_SYMBOL + 1,
 		HUFFMAN_MAX_NODES = HUFFMAN_MAX_SYMBOLS * 2 - 1,
 
-		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTBITS = 11,
 		HUFFMAN_LUTSIZE = (1 << HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1),
+
+		// symbols that one lookup in the multi symbol table can decode
+		HUFFMAN_LUTSYMBOLS = 5,
 	};
 
 	struct CNode
@@ -30,10 +33,20 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	// the symbols whose codes fit completely into the bits of a table index
+	struct CDecodeEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_LUTSYMBOLS];
+		unsigned char m_NumSymbols;
+		unsigned char m_NumBits; // 0 if the first code is longer than the index
+		unsigned char m_Eof; // the codes end with the eof symbol, which is not in m_aSymbols
+	};
+
 	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
 
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
 	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CDecodeEntry m_aDecodeMultiLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
 
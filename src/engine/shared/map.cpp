@@ -26,13 +26,18 @@ public:
 		m_DataFile.Close();
 	}
 
-	bool Load(const char *pMapName, IStorage *pStorage) override
+	void Swap(IEngineMap *pOther) override
+	{
+		m_DataFile.Swap(static_cast<CMap *>(pOther)->m_DataFile);
+	}
+
+	bool Load(const char *pMapName, IStorage *pStorage, CDataFileHashCache *pHashCache) override
 	{
 		if(!pStorage)
 			pStorage = Kernel()->RequestInterface<IStorage>();
 		if(!pStorage)
 			return false;
-		if(!m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL))
+		if(!m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL, pHashCache))
 			return false;
 		// check version
 		CMapItemVersion *pItem = (CMapItemVersion *) m_DataFile.FindItem(MAPITEMTYPE_VERSION, 0);
@@ -105,6 +110,16 @@ public:
 	{
 		return m_DataFile.Crc();
 	}
+
+	const unsigned char *FileData() override
+	{
+		return m_DataFile.FileData();
+	}
+
+	unsigned FileSize() override
+	{
+		return m_DataFile.FileSize();
+	}
 };
 
 extern IEngineMap *CreateEngineMap() { return new CMap; }
@@ -111,6 +111,10 @@ CNetBase::CNetBase()
 	m_pEngine = 0;
 	m_DataLogSent = 0;
 	m_DataLogRecv = 0;
+	m_RecvBatchNum = 0;
+	m_RecvBatchIndex = 0;
+	m_SendBatching = false;
+	m_SendBatchNum = 0;
 }
 
 CNetBase::~CNetBase()
@@ -126,21 +130,58 @@ void CNetBase::Init(NETSOCKET Socket, CConfig *pConfig, IConsole *pConsole, IEng
 	m_pEngine = pEngine;
 	m_Huffman.Init();
 	mem_zero(m_aRequestTokenBuf, sizeof(m_aRequestTokenBuf));
+	m_RecvBatchNum = 0;
+	m_RecvBatchIndex = 0;
+	m_SendBatching = false;
+	m_SendBatchNum = 0;
 	if(pEngine)
 		pConsole->Chain("dbg_lognetwork", ConchainDbgLognetwork, this);
 }
 
 void CNetBase::Shutdown()
 {
+	FlushSendBatch();
 	net_udp_close(m_Socket);
 	net_invalidate_socket(&m_Socket);
 }
 
 void CNetBase::Wait(int Time)
 {
+	FlushSendBatch();
 	net_socket_read_wait(m_Socket, Time);
 }
 
+void CNetBase::SetSendBatching(bool Batching)
+{
+	if(!Batching)
+		FlushSendBatch();
+	m_SendBatching = Batching;
+}
+
+void CNetBase::FlushSendBatch()
+{
+	if(!m_SendBatchNum)
+		return;
+	net_udp_send_batch(m_Socket, m_aSendBatchAddr, m_aaSendBatch[0], NET_MAX_PACKETSIZE, m_aSendBatchSize, m_SendBatchNum);
+	m_SendBatchNum = 0;
+}
+
+void CNetBase::SendDatagram(const NETADDR *pAddr, const unsigned char *pData, int Size)
+{
+	if(!m_SendBatching)
+	{
+		net_udp_send(m_Socket, pAddr, pData, Size);
+		return;
+	}
+
+	if(m_SendBatchNum == NET_BATCH_SIZE)
+		FlushSendBatch();
+	mem_copy(m_aaSendBatch[m_SendBatchNum], pData, Size);
+	m_aSendBatchAddr[m_SendBatchNum] = *pAddr;
+	m_aSendBatchSize[m_SendBatchNum] = Size;
+	m_SendBatchNum++;
+}
+
 // packs the data tight and sends it
 void CNetBase::SendPacketConnless(const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize)
 {
@@ -164,7 +205,7 @@ void CNetBase::SendPacketConnless(const NETADDR *pAddr, TOKEN Token, TOKEN Respo
 	dbg_assert(i == NET_PACKETHEADERSIZE_CONNLESS, "inconsistency");
 
 	mem_copy(&aBuffer[i], pData, DataSize);
-	net_udp_send(m_Socket, pAddr, aBuffer, i + DataSize);
+	SendDatagram(pAddr, aBuffer, i + DataSize);
 }
 
 void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
@@ -219,7 +260,7 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 
 		dbg_assert(i == NET_PACKETHEADERSIZE, "inconsistency");
 
-		net_udp_send(m_Socket, pAddr, aBuffer, FinalSize);
+		SendDatagram(pAddr, aBuffer, FinalSize);
 
 		// log raw socket data
 		if(m_DataLogSent)
@@ -234,13 +275,23 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 }
 
 // TODO: rename this function
-int CNetBase::UnpackPacket(NETADDR *pAddr, unsigned char *pBuffer, CNetPacketConstruct *pPacket)
+int CNetBase::UnpackPacket(NETADDR *pAddr, CNetPacketConstruct *pPacket)
 {
-	int Size = net_udp_recv(m_Socket, pAddr, pBuffer, NET_MAX_PACKETSIZE);
+	// fetch the waiting datagrams
+	if(m_RecvBatchIndex == m_RecvBatchNum)
+	{
+		m_RecvBatchNum = net_udp_recv_batch(m_Socket, m_aRecvBatchAddr, m_aaRecvBatch[0], NET_MAX_PACKETSIZE, m_aRecvBatchSize, NET_BATCH_SIZE);
+		m_RecvBatchIndex = 0;
+	}
 	// no more packets for now
-	if(Size <= 0)
+	if(m_RecvBatchIndex == m_RecvBatchNum)
 		return 1;
 
+	const unsigned char *pBuffer = m_aaRecvBatch[m_RecvBatchIndex];
+	int Size = m_aRecvBatchSize[m_RecvBatchIndex];
+	*pAddr = m_aRecvBatchAddr[m_RecvBatchIndex];
+	m_RecvBatchIndex++;
+
 	// log the data
 	if(m_DataLogRecv)
 	{
@@ -84,6 +84,9 @@ enum
 
 	NET_MAX_PACKET_CHUNKS = 256,
 
+	// datagrams received or sent with one system call
+	NET_BATCH_SIZE = 64,
+
 	// token
 	NET_SEEDTIME = 16,
 
@@ -204,6 +207,22 @@ class CNetBase
 	CHuffman m_Huffman;
 	unsigned char m_aRequestTokenBuf[NET_TOKENREQUEST_DATASIZE];
 
+	// datagrams received together, UnpackPacket hands them out one by one
+	unsigned char m_aaRecvBatch[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+	NETADDR m_aRecvBatchAddr[NET_BATCH_SIZE];
+	int m_aRecvBatchSize[NET_BATCH_SIZE];
+	int m_RecvBatchNum;
+	int m_RecvBatchIndex;
+
+	// datagrams waiting to be sent together, see SetSendBatching
+	bool m_SendBatching;
+	unsigned char m_aaSendBatch[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+	NETADDR m_aSendBatchAddr[NET_BATCH_SIZE];
+	int m_aSendBatchSize[NET_BATCH_SIZE];
+	int m_SendBatchNum;
+
+	void SendDatagram(const NETADDR *pAddr, const unsigned char *pData, int Size);
+
 public:
 	CNetBase();
 	~CNetBase();
@@ -214,13 +233,18 @@ public:
 	void Init(NETSOCKET Socket, class CConfig *pConfig, class IConsole *pConsole, class IEngine *pEngine);
 	void Shutdown();
 	void UpdateLogHandles();
+	// flushes the held datagrams before waiting
 	void Wait(int Time);
 
+	// when batching, datagrams are held until FlushSendBatch, Wait or Shutdown
+	void SetSendBatching(bool Batching);
+	void FlushSendBatch();
+
 	void SendControlMsg(const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize);
 	void SendControlMsgWithToken(const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended);
 	void SendPacketConnless(const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize);
 	void SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket);
-	int UnpackPacket(NETADDR *pAddr, unsigned char *pBuffer, CNetPacketConstruct *pPacket);
+	int UnpackPacket(NETADDR *pAddr, CNetPacketConstruct *pPacket);
 };
 
 class CNetTokenManager
@@ -433,7 +457,6 @@ public:
 	int m_CurrentChunk;
 	int m_ClientID;
 	CNetPacketConstruct m_Data;
-	unsigned char m_aBuffer[NET_MAX_PACKETSIZE];
 
 	CNetRecvUnpacker() { Clear(); }
 	bool IsActive() { return m_Valid; }
@@ -442,6 +465,36 @@ public:
 	int FetchChunk(CNetChunk *pChunk);
 };
 
+// maps addresses to numbers with open addressing, holds at most NET_MAX_CLIENTS entries
+class CNetAddrMap
+{
+	enum
+	{
+		MAP_SIZE = 64, // power of two, at least twice NET_MAX_CLIENTS
+	};
+
+	struct CEntry
+	{
+		NETADDR m_Addr;
+		int m_Value;
+		bool m_Used;
+	};
+
+	CEntry m_aEntries[MAP_SIZE];
+	int m_NumEntries;
+
+	static unsigned Hash(const NETADDR *pAddr);
+	int FindEntry(const NETADDR *pAddr) const;
+
+public:
+	CNetAddrMap() { Clear(); }
+	void Clear();
+	// returns -1 if the address is not in the map
+	int Find(const NETADDR *pAddr) const;
+	void Set(const NETADDR *pAddr, int Value);
+	void Remove(const NETADDR *pAddr);
+};
+
 // server side
 class CNetServer : public CNetBase
 {
@@ -449,6 +502,9 @@ class CNetServer : public CNetBase
 	{
 	public:
 		CNetConnection m_Connection;
+		// the address the slot is indexed under, the connection forgets its peer when it goes offline
+		NETADDR m_Addr;
+		bool m_Registered;
 	};
 
 	class CNetBan *m_pNetBan;
@@ -457,6 +513,15 @@ class CNetServer : public CNetBase
 	int m_MaxClients;
 	int m_MaxClientsPerIP;
 
+	// slot of each connected address, and number of slots of each ip (port set to 0)
+	CNetAddrMap m_AddrSlots;
+	CNetAddrMap m_IPClients;
+
+	int FindSlot(const NETADDR *pAddr) const;
+	void AddSlotAddr(int ClientID, const NETADDR *pAddr);
+	void RemoveSlotAddr(int ClientID);
+	void ReleaseOfflineSlot(int ClientID);
+
 	NETFUNC_NEWCLIENT m_pfnNewClient;
 	NETFUNC_DELCLIENT m_pfnDelClient;
 	void *m_UserPtr;
@@ -8,6 +8,79 @@
 #include "netban.h"
 #include "network.h"
 
+unsigned CNetAddrMap::Hash(const NETADDR *pAddr)
+{
+	// fnv-1a over the parts that net_addr_comp looks at
+	unsigned Hash = 2166136261u;
+	Hash = (Hash ^ pAddr->type) * 16777619u;
+	for(unsigned char Byte : pAddr->ip)
+		Hash = (Hash ^ Byte) * 16777619u;
+	Hash = (Hash ^ (pAddr->port & 0xff)) * 16777619u;
+	Hash = (Hash ^ (pAddr->port >> 8)) * 16777619u;
+	return Hash;
+}
+
+void CNetAddrMap::Clear()
+{
+	for(auto &Entry : m_aEntries)
+		Entry.m_Used = false;
+	m_NumEntries = 0;
+}
+
+int CNetAddrMap::FindEntry(const NETADDR *pAddr) const
+{
+	for(unsigned i = Hash(pAddr) & (MAP_SIZE - 1);; i = (i + 1) & (MAP_SIZE - 1))
+	{
+		if(!m_aEntries[i].m_Used)
+			return -1;
+		if(net_addr_comp(&m_aEntries[i].m_Addr, pAddr, true) == 0)
+			return i;
+	}
+}
+
+int CNetAddrMap::Find(const NETADDR *pAddr) const
+{
+	int Entry = FindEntry(pAddr);
+	return Entry < 0 ? -1 : m_aEntries[Entry].m_Value;
+}
+
+void CNetAddrMap::Set(const NETADDR *pAddr, int Value)
+{
+	unsigned i = Hash(pAddr) & (MAP_SIZE - 1);
+	while(m_aEntries[i].m_Used && net_addr_comp(&m_aEntries[i].m_Addr, pAddr, true) != 0)
+		i = (i + 1) & (MAP_SIZE - 1);
+
+	if(!m_aEntries[i].m_Used)
+	{
+		dbg_assert(m_NumEntries < NET_MAX_CLIENTS, "address map full");
+		m_aEntries[i].m_Addr = *pAddr;
+		m_aEntries[i].m_Used = true;
+		m_NumEntries++;
+	}
+	m_aEntries[i].m_Value = Value;
+}
+
+void CNetAddrMap::Remove(const NETADDR *pAddr)
+{
+	int Hole = FindEntry(pAddr);
+	if(Hole < 0)
+		return;
+	m_aEntries[Hole].m_Used = false;
+	m_NumEntries--;
+
+	// move following entries of the probe sequence back so lookups don't stop at the hole
+	for(int i = (Hole + 1) & (MAP_SIZE - 1); m_aEntries[i].m_Used; i = (i + 1) & (MAP_SIZE - 1))
+	{
+		int Home = Hash(&m_aEntries[i].m_Addr) & (MAP_SIZE - 1);
+		bool Reachable = Hole <= i ? (Home > Hole && Home <= i) : (Home > Hole || Home <= i);
+		if(Reachable)
+			continue;
+		m_aEntries[Hole] = m_aEntries[i];
+		m_aEntries[i].m_Used = false;
+		Hole = i;
+	}
+}
+
 bool CNetServer::Open(NETADDR BindAddr, CConfig *pConfig, IConsole *pConsole, IEngine *pEngine, CNetBan *pNetBan,
 	int MaxClients, int MaxClientsPerIP, NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser)
 {
@@ -25,6 +98,7 @@ bool CNetServer::Open(NETADDR BindAddr, CConfig *pConfig, IConsole *pConsole, IE
 
 	m_TokenManager.Init(this);
 	m_TokenCache.Init(this, &m_TokenManager);
+	SetSendBatching(true);
 
 	m_NumClients = 0;
 	SetMaxClients(MaxClients);
@@ -48,14 +122,66 @@ void CNetServer::Close(const char *pReason)
 	Shutdown();
 }
 
+int CNetServer::FindSlot(const NETADDR *pAddr) const
+{
+	int ClientID = m_AddrSlots.Find(pAddr);
+	if(ClientID < 0 || m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+		return -1;
+	return ClientID;
+}
+
+void CNetServer::AddSlotAddr(int ClientID, const NETADDR *pAddr)
+{
+	NETADDR IP = *pAddr;
+	IP.port = 0;
+	m_AddrSlots.Set(pAddr, ClientID);
+	m_IPClients.Set(&IP, maximum(m_IPClients.Find(&IP), 0) + 1);
+	m_aSlots[ClientID].m_Addr = *pAddr;
+	m_aSlots[ClientID].m_Registered = true;
+}
+
+void CNetServer::RemoveSlotAddr(int ClientID)
+{
+	if(!m_aSlots[ClientID].m_Registered)
+		return;
+
+	const NETADDR *pAddr = &m_aSlots[ClientID].m_Addr;
+	NETADDR IP = *pAddr;
+	IP.port = 0;
+	m_AddrSlots.Remove(pAddr);
+	int NumClients = m_IPClients.Find(&IP);
+	if(NumClients > 1)
+		m_IPClients.Set(&IP, NumClients - 1);
+	else
+		m_IPClients.Remove(&IP);
+	m_aSlots[ClientID].m_Registered = false;
+}
+
+void CNetServer::ReleaseOfflineSlot(int ClientID)
+{
+	// the connection went offline without Drop, e.g. when its resend buffer ran full
+	if(m_pfnDelClient)
+		m_pfnDelClient(ClientID, m_aSlots[ClientID].m_Connection.ErrorString(), m_UserPtr);
+
+	RemoveSlotAddr(ClientID);
+	m_NumClients--;
+}
+
 void CNetServer::Drop(int ClientID, const char *pReason)
 {
-	if(ClientID < 0 || ClientID >= NET_MAX_CLIENTS || m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+	if(ClientID < 0 || ClientID >= NET_MAX_CLIENTS)
 		return;
+	if(m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+	{
+		if(m_aSlots[ClientID].m_Registered)
+			ReleaseOfflineSlot(ClientID);
+		return;
+	}
 
 	if(m_pfnDelClient)
 		m_pfnDelClient(ClientID, pReason, m_UserPtr);
 
+	RemoveSlotAddr(ClientID);
 	m_aSlots[ClientID].m_Connection.Disconnect(pReason);
 	m_NumClients--;
 }
@@ -66,7 +192,11 @@ int CNetServer::Update()
 	for(int i = 0; i < NET_MAX_CLIENTS; i++)
 	{
 		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+		{
+			if(m_aSlots[i].m_Registered)
+				ReleaseOfflineSlot(i);
 			continue;
+		}
 
 		m_aSlots[i].m_Connection.Update();
 		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR)
@@ -105,7 +235,7 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 
 		// TODO: empty the recvinfo
 		NETADDR Addr;
-		int Result = UnpackPacket(&Addr, m_RecvUnpacker.m_aBuffer, &m_RecvUnpacker.m_Data);
+		int Result = UnpackPacket(&Addr, &m_RecvUnpacker.m_Data);
 		// no more packets for now
 		if(Result > 0)
 			break;
@@ -126,40 +256,31 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 				continue;
 			}
 
-			bool Found = false;
 			// try to find matching slot
-			for(int i = 0; i < NET_MAX_CLIENTS; i++)
+			int ClientID = FindSlot(&Addr);
+			if(ClientID != -1)
 			{
-				if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-					continue;
-
-				if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr, true) == 0)
+				if(m_aSlots[ClientID].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
 				{
-					if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
+					if(m_RecvUnpacker.m_Data.m_DataSize)
 					{
-						if(m_RecvUnpacker.m_Data.m_DataSize)
+						if(!(m_RecvUnpacker.m_Data.m_Flags & NET_PACKETFLAG_CONNLESS))
+							m_RecvUnpacker.Start(&Addr, &m_aSlots[ClientID].m_Connection, ClientID);
+						else
 						{
-							if(!(m_RecvUnpacker.m_Data.m_Flags & NET_PACKETFLAG_CONNLESS))
-								m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
-							else
-							{
-								pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-								pChunk->m_Address = *m_aSlots[i].m_Connection.PeerAddress();
-								pChunk->m_ClientID = i;
-								pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-								pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-								if(pResponseToken)
-									*pResponseToken = NET_TOKEN_NONE;
-								return 1;
-							}
+							pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+							pChunk->m_Address = *m_aSlots[ClientID].m_Connection.PeerAddress();
+							pChunk->m_ClientID = ClientID;
+							pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+							pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+							if(pResponseToken)
+								*pResponseToken = NET_TOKEN_NONE;
+							return 1;
 						}
 					}
-					Found = true;
 				}
-			}
-
-			if(Found)
 				continue;
+			}
 
 			int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
 			if(Accept <= 0)
@@ -178,37 +299,26 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 					}
 
 					// only allow a specific number of players with the same ip
-					int FoundAddr = 1;
-
-					bool Continue = false;
-					for(int i = 0; i < NET_MAX_CLIENTS; i++)
+					NETADDR IP = Addr;
+					IP.port = 0;
+					if(m_IPClients.Find(&IP) >= m_MaxClientsPerIP)
 					{
-						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-							continue;
-
-						if(!net_addr_comp(&Addr, m_aSlots[i].m_Connection.PeerAddress(), false))
-						{
-							if(FoundAddr++ >= m_MaxClientsPerIP)
-							{
-								char aBuf[128];
-								str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
-								SendControlMsg(&Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
-								Continue = true;
-								break;
-							}
-						}
-					}
-
-					if(Continue)
+						char aBuf[128];
+						str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
+						SendControlMsg(&Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
 						continue;
+					}
 
 					for(int i = 0; i < NET_MAX_CLIENTS; i++)
 					{
 						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
 						{
+							if(m_aSlots[i].m_Registered)
+								ReleaseOfflineSlot(i);
 							m_NumClients++;
 							m_aSlots[i].m_Connection.SetToken(m_RecvUnpacker.m_Data.m_Token);
 							m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
+							AddSlotAddr(i, &Addr);
 							if(m_pfnNewClient)
 								m_pfnNewClient(i, m_UserPtr);
 							break;
@@ -244,21 +354,9 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 			return -1;
 		}
 
+		// upgrade the packet, if we know its recipent
 		if(pChunk->m_ClientID == -1)
-		{
-			for(int i = 0; i < NET_MAX_CLIENTS; i++)
-			{
-				if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-					continue;
-
-				if(net_addr_comp(&pChunk->m_Address, m_aSlots[i].m_Connection.PeerAddress(), true) == 0)
-				{
-					// upgrade the packet, now that we know its recipent
-					pChunk->m_ClientID = i;
-					break;
-				}
-			}
-		}
+			pChunk->m_ClientID = FindSlot(&pChunk->m_Address);
 
 		if(Token != NET_TOKEN_NONE)
 		{
@@ -0,0 +1,109 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "profiler.h"
+#include "jsonwriter.h"
+
+#include <algorithm>
+
+CProfiler::CProfiler()
+{
+	m_NumSections = 0;
+	m_Enabled = false;
+	Clear();
+}
+
+void CProfiler::SetEnabled(bool Enabled)
+{
+	if(m_Enabled != Enabled)
+		Clear();
+	m_Enabled = Enabled;
+}
+
+void CProfiler::Clear()
+{
+	for(auto &Section : m_aSections)
+	{
+		Section.m_Current = 0;
+		Section.m_Ran = false;
+		Section.m_NumSamples = 0;
+		Section.m_NextSample = 0;
+	}
+}
+
+int CProfiler::RegisterSection(const char *pName)
+{
+	for(int i = 0; i < m_NumSections; i++)
+		if(str_comp(m_aSections[i].m_aName, pName) == 0)
+			return i;
+
+	if(m_NumSections == MAX_SECTIONS)
+		return -1;
+	str_copy(m_aSections[m_NumSections].m_aName, pName, sizeof(m_aSections[m_NumSections].m_aName));
+	return m_NumSections++;
+}
+
+void CProfiler::EndTick()
+{
+	if(!m_Enabled)
+		return;
+
+	const int64_t Freq = time_freq();
+	for(int i = 0; i < m_NumSections; i++)
+	{
+		CSection *pSection = &m_aSections[i];
+		if(!pSection->m_Ran)
+			continue;
+
+		pSection->m_aSamples[pSection->m_NextSample] = (int) (pSection->m_Current * 1000000 / Freq);
+		pSection->m_NextSample = (pSection->m_NextSample + 1) % WINDOW_TICKS;
+		if(pSection->m_NumSamples < WINDOW_TICKS)
+			pSection->m_NumSamples++;
+		pSection->m_Current = 0;
+		pSection->m_Ran = false;
+	}
+}
+
+void CProfiler::GetStats(int Section, CStats *pStats) const
+{
+	const CSection *pSection = &m_aSections[Section];
+	pStats->m_NumSamples = pSection->m_NumSamples;
+	pStats->m_P50 = pStats->m_P99 = pStats->m_Max = 0;
+	if(!pSection->m_NumSamples)
+		return;
+
+	int aSorted[WINDOW_TICKS];
+	const int Num = pSection->m_NumSamples;
+	mem_copy(aSorted, pSection->m_aSamples, Num * sizeof(int));
+	std::sort(aSorted, aSorted + Num);
+	pStats->m_P50 = aSorted[(Num - 1) * 50 / 100];
+	pStats->m_P99 = aSorted[(Num - 1) * 99 / 100];
+	pStats->m_Max = aSorted[Num - 1];
+}
+
+void CProfiler::WriteJson(CJsonWriter *pWriter) const
+{
+	pWriter->BeginObject();
+	pWriter->WriteAttribute("window_ticks");
+	pWriter->WriteIntValue(WINDOW_TICKS);
+	pWriter->WriteAttribute("sections");
+	pWriter->BeginArray();
+	for(int i = 0; i < m_NumSections; i++)
+	{
+		CStats Stats;
+		GetStats(i, &Stats);
+		pWriter->BeginObject();
+		pWriter->WriteAttribute("name");
+		pWriter->WriteStrValue(m_aSections[i].m_aName);
+		pWriter->WriteAttribute("samples");
+		pWriter->WriteIntValue(Stats.m_NumSamples);
+		pWriter->WriteAttribute("p50_us");
+		pWriter->WriteIntValue(Stats.m_P50);
+		pWriter->WriteAttribute("p99_us");
+		pWriter->WriteIntValue(Stats.m_P99);
+		pWriter->WriteAttribute("max_us");
+		pWriter->WriteIntValue(Stats.m_Max);
+		pWriter->EndObject();
+	}
+	pWriter->EndArray();
+	pWriter->EndObject();
+}
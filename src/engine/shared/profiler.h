@@ -0,0 +1,97 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+/**
+ * Collects how long named sections of a tick take, over a rolling window of ticks.
+ *
+ * Time is added to a section with CProfileScope, any number of times per tick.
+ * EndTick() stores the total of each section that ran in the tick as one sample.
+ * When the profiler is disabled, a scope costs one branch.
+ */
+class CProfiler
+{
+public:
+	enum
+	{
+		MAX_SECTIONS = 32,
+		MAX_NAME_LENGTH = 32,
+		WINDOW_TICKS = 500,
+	};
+
+	class CStats
+	{
+	public:
+		int m_NumSamples;
+		int m_P50; // in microseconds
+		int m_P99;
+		int m_Max;
+	};
+
+private:
+	class CSection
+	{
+	public:
+		char m_aName[MAX_NAME_LENGTH];
+		int64_t m_Current;
+		bool m_Ran;
+		int m_aSamples[WINDOW_TICKS]; // in microseconds
+		int m_NumSamples;
+		int m_NextSample;
+	};
+
+	CSection m_aSections[MAX_SECTIONS];
+	int m_NumSections;
+	bool m_Enabled;
+
+public:
+	CProfiler();
+
+	bool IsEnabled() const { return m_Enabled; }
+	// enabling or disabling the profiler clears all samples
+	void SetEnabled(bool Enabled);
+	void Clear();
+
+	// returns the section with that name, registering it if needed, or -1 if there are too many
+	int RegisterSection(const char *pName);
+	int NumSections() const { return m_NumSections; }
+	const char *SectionName(int Section) const { return m_aSections[Section].m_aName; }
+
+	void Add(int Section, int64_t Time)
+	{
+		if(!m_Enabled || Section < 0)
+			return;
+		m_aSections[Section].m_Current += Time;
+		m_aSections[Section].m_Ran = true;
+	}
+	void EndTick();
+
+	void GetStats(int Section, CStats *pStats) const;
+	void WriteJson(class CJsonWriter *pWriter) const;
+};
+
+/**
+ * Adds the time from its construction to its destruction to a profiler section.
+ */
+class CProfileScope
+{
+	CProfiler *m_pProfiler;
+	int m_Section;
+	int64_t m_Start;
+
+public:
+	CProfileScope(CProfiler *pProfiler, int Section) :
+		m_pProfiler(pProfiler), m_Section(Section), m_Start(pProfiler->IsEnabled() ? time_get() : 0)
+	{
+	}
+	~CProfileScope()
+	{
+		if(m_Start)
+			m_pProfiler->Add(m_Section, time_get() - m_Start);
+	}
+};
+
+#endif
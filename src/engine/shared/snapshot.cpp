@@ -3,8 +3,17 @@
 #include <algorithm>
 #include <limits.h>
 
+#include <base/math.h>
 #include <base/tl/algorithm.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SNAPSHOT_DIFF_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SNAPSHOT_DIFF_NEON
+#endif
+
 #include "compression.h"
 #include "snapshot.h"
 
@@ -83,93 +92,91 @@ void CSnapshot::DebugDump() const
 
 // CSnapshotDelta
 
-enum
+// open addressing table from item keys to item indices, used to match the items of two snapshots
+class CItemHash
 {
-	HASHLIST_SIZE = 256,
-	HASHLIST_BUCKET_SIZE = 64,
-};
+	enum
+	{
+		MAX_ITEMS = 1024,
+		TABLE_SIZE = MAX_ITEMS * 2, // keep the load factor at or below 0.5
+		EMPTY_KEY = -1, // keys are never negative
+	};
 
-struct CItemList
-{
-	int m_Num;
-	int m_aKeys[HASHLIST_BUCKET_SIZE];
-	int m_aIndex[HASHLIST_BUCKET_SIZE];
-};
+	int m_aKeys[TABLE_SIZE];
+	short m_aIndices[TABLE_SIZE];
 
-inline unsigned CalcHashID(int Key)
-{
-	// djb2 (http://www.cse.yorku.ca/~oz/hash.html)
-	unsigned Hash = 5381;
-	for(unsigned Shift = 0; Shift < sizeof(int); Shift++)
-		Hash = ((Hash << 5) + Hash) + ((Key >> (Shift * 8)) & 0xFF);
-	return Hash % HASHLIST_SIZE;
-}
+	static unsigned Slot(int Key)
+	{
+		// fibonacci hashing, types and ids are both in the low bits
+		return ((unsigned) Key * 2654435769u) >> (32 - 11);
+	}
 
-static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
-{
-	for(int i = 0; i < HASHLIST_SIZE; i++)
-		pHashlist[i].m_Num = 0;
+public:
+	static bool Fits(const CSnapshot *pSnapshot) { return pSnapshot->NumItems() <= MAX_ITEMS; }
 
-	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	void Generate(const CSnapshot *pSnapshot)
 	{
-		int Key = pSnapshot->GetItem(i)->Key();
-		unsigned HashID = CalcHashID(Key);
-		if(pHashlist[HashID].m_Num < HASHLIST_BUCKET_SIZE)
+		std::fill(m_aKeys, m_aKeys + TABLE_SIZE, (int) EMPTY_KEY);
+
+		for(int i = 0; i < pSnapshot->NumItems(); i++)
 		{
-			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
-			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
-			pHashlist[HashID].m_Num++;
+			const int Key = pSnapshot->GetItem(i)->Key();
+			unsigned HashID = Slot(Key);
+			while(m_aKeys[HashID] != EMPTY_KEY)
+				HashID = (HashID + 1) & (TABLE_SIZE - 1);
+			m_aKeys[HashID] = Key;
+			m_aIndices[HashID] = i;
 		}
 	}
-}
 
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
-{
-	unsigned HashID = CalcHashID(Key);
-	for(int i = 0; i < pHashlist[HashID].m_Num; i++)
+	int Find(int Key) const
 	{
-		if(pHashlist[HashID].m_aKeys[i] == Key)
-			return pHashlist[HashID].m_aIndex[i];
-	}
-
-	return -1;
-}
-
-static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
-{
-	int Needed = 0;
-	while(Size)
-	{
-		*pOut = *pCurrent - *pPast;
-		Needed |= *pOut;
-		pOut++;
-		pPast++;
-		pCurrent++;
-		Size--;
+		for(unsigned HashID = Slot(Key); m_aKeys[HashID] != EMPTY_KEY; HashID = (HashID + 1) & (TABLE_SIZE - 1))
+		{
+			if(m_aKeys[HashID] == Key)
+				return m_aIndices[HashID];
+		}
+		return -1;
 	}
+};
 
-	return Needed;
+static void DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
+{
+	int i = 0;
+#if defined(SNAPSHOT_DIFF_SSE2)
+	for(; i + 4 <= Size; i += 4)
+		_mm_storeu_si128((__m128i *) (pOut + i), _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (pCurrent + i)), _mm_loadu_si128((const __m128i *) (pPast + i))));
+#elif defined(SNAPSHOT_DIFF_NEON)
+	for(; i + 4 <= Size; i += 4)
+		vst1q_u32((uint32_t *) (pOut + i), vsubq_u32(vld1q_u32((const uint32_t *) (pCurrent + i)), vld1q_u32((const uint32_t *) (pPast + i))));
+#endif
+	for(; i < Size; i++)
+		pOut[i] = pCurrent[i] - pPast[i];
 }
 
 static void UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, int *pDataRate)
 {
-	while(Size)
+	int i = 0;
+#if defined(SNAPSHOT_DIFF_SSE2)
+	for(; i + 4 <= Size; i += 4)
+		_mm_storeu_si128((__m128i *) (pOut + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (pPast + i)), _mm_loadu_si128((const __m128i *) (pDiff + i))));
+#elif defined(SNAPSHOT_DIFF_NEON)
+	for(; i + 4 <= Size; i += 4)
+		vst1q_u32((uint32_t *) (pOut + i), vaddq_u32(vld1q_u32((const uint32_t *) (pPast + i)), vld1q_u32((const uint32_t *) (pDiff + i))));
+#endif
+	for(; i < Size; i++)
+		pOut[i] = pPast[i] + pDiff[i];
+
+	for(i = 0; i < Size; i++)
 	{
-		*pOut = *pPast + *pDiff;
-
-		if(*pDiff == 0)
+		if(pDiff[i] == 0)
 			*pDataRate += 1;
 		else
 		{
 			unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
-			unsigned char *pEnd = CVariableInt::Pack(aBuf, *pDiff, sizeof(aBuf));
+			unsigned char *pEnd = CVariableInt::Pack(aBuf, pDiff[i], sizeof(aBuf));
 			*pDataRate += (int) (pEnd - (unsigned char *) aBuf) * 8;
 		}
-
-		pOut++;
-		pPast++;
-		pDiff++;
-		Size--;
 	}
 }
 
@@ -193,37 +200,145 @@ const CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta() const
 	return &m_Empty;
 }
 
-// TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+// writes the delta data as plain ints
+class CDeltaIntWriter
+{
+	int *m_pData;
+
+public:
+	CDeltaIntWriter(int *pData) :
+		m_pData(pData) {}
+
+	int *Data() const { return m_pData; }
+
+	bool Add(int Value)
+	{
+		*m_pData++ = Value;
+		return true;
+	}
+
+	bool AddData(const int *pData, int Num)
+	{
+		mem_copy(m_pData, pData, Num * sizeof(int));
+		m_pData += Num;
+		return true;
+	}
+
+	bool AddDiff(const int *pPast, const int *pCurrent, int Num)
+	{
+		DiffItem(pPast, pCurrent, m_pData, Num);
+		m_pData += Num;
+		return true;
+	}
+};
+
+// packs the delta data as it is written, through a small buffer that stays in the cache
+class CDeltaPackWriter
+{
+	enum
+	{
+		BUFFER_SIZE = 256,
+	};
+
+	int m_aBuffer[BUFFER_SIZE];
+	int m_NumBuffered;
+	unsigned char *m_pData;
+	unsigned char *m_pEnd;
+
+	// returns the number of ints that can be added to the buffer, 0 on failure
+	int Reserve()
+	{
+		if(m_NumBuffered == BUFFER_SIZE && !Flush())
+			return 0;
+		return BUFFER_SIZE - m_NumBuffered;
+	}
+
+public:
+	CDeltaPackWriter(unsigned char *pData, int Size) :
+		m_NumBuffered(0), m_pData(pData), m_pEnd(pData + Size) {}
+
+	// only valid after Flush
+	unsigned char *Data() const { return m_pData; }
+
+	bool Flush()
+	{
+		m_pData = CVariableInt::PackMany(m_pData, m_aBuffer, m_NumBuffered, m_pEnd - m_pData);
+		m_NumBuffered = 0;
+		return m_pData != 0;
+	}
+
+	bool Add(int Value)
+	{
+		if(!Reserve())
+			return false;
+		m_aBuffer[m_NumBuffered++] = Value;
+		return true;
+	}
+
+	bool AddData(const int *pData, int Num)
+	{
+		while(Num)
+		{
+			const int Chunk = minimum(Num, Reserve());
+			if(!Chunk)
+				return false;
+			mem_copy(m_aBuffer + m_NumBuffered, pData, Chunk * sizeof(int));
+			m_NumBuffered += Chunk;
+			pData += Chunk;
+			Num -= Chunk;
+		}
+		return true;
+	}
+
+	bool AddDiff(const int *pPast, const int *pCurrent, int Num)
+	{
+		while(Num)
+		{
+			const int Chunk = minimum(Num, Reserve());
+			if(!Chunk)
+				return false;
+			DiffItem(pPast, pCurrent, m_aBuffer + m_NumBuffered, Chunk);
+			m_NumBuffered += Chunk;
+			pPast += Chunk;
+			pCurrent += Chunk;
+			Num -= Chunk;
+		}
+		return true;
+	}
+};
+
+template<typename TWriter>
+bool CSnapshotDelta::GenerateDelta(const CSnapshot *pFrom, const CSnapshot *pTo, TWriter *pWriter, CData *pHeader) const
 {
-	CData *pDelta = (CData *) pDstData;
-	int *pData = (int *) pDelta->m_aData;
 	int i, ItemSize, PastIndex;
 	const CSnapshotItem *pFromItem;
 	const CSnapshotItem *pCurItem;
-	const CSnapshotItem *pPastItem;
+	const CSnapshotItem *pPastItem = 0;
 
-	pDelta->m_NumDeletedItems = 0;
-	pDelta->m_NumUpdateItems = 0;
-	pDelta->m_NumTempItems = 0;
+	pHeader->m_NumDeletedItems = 0;
+	pHeader->m_NumUpdateItems = 0;
+	pHeader->m_NumTempItems = 0;
 
-	CItemList Hashlist[HASHLIST_SIZE];
-	GenerateHash(Hashlist, pTo);
+	if(!CItemHash::Fits(pFrom) || !CItemHash::Fits(pTo))
+		return false;
+
+	CItemHash Hash;
+	Hash.Generate(pTo);
 
 	// pack deleted stuff
 	for(i = 0; i < pFrom->NumItems(); i++)
 	{
 		pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), Hashlist) == -1)
+		if(Hash.Find(pFromItem->Key()) == -1)
 		{
 			// deleted
-			pDelta->m_NumDeletedItems++;
-			*pData = pFromItem->Key();
-			pData++;
+			pHeader->m_NumDeletedItems++;
+			if(!pWriter->Add(pFromItem->Key()))
+				return false;
 		}
 	}
 
-	GenerateHash(Hashlist, pFrom);
+	Hash.Generate(pFrom);
 	int aPastIndecies[1024];
 
 	// fetch previous indices
@@ -231,55 +346,86 @@ int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pD
 	const int NumItems = pTo->NumItems();
 	for(i = 0; i < NumItems; i++)
 	{
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndecies[i] = GetItemIndexHashed(pCurItem->Key(), Hashlist); // O(n) .. O(n^n)
+		pCurItem = pTo->GetItem(i);
+		aPastIndecies[i] = Hash.Find(pCurItem->Key());
 	}
 
 	for(i = 0; i < NumItems; i++)
 	{
 		// do delta
-		ItemSize = pTo->GetItemSize(i); // O(1) .. O(n)
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
+		ItemSize = pTo->GetItemSize(i);
+		pCurItem = pTo->GetItem(i);
 		PastIndex = aPastIndecies[i];
 
 		bool IncludeSize = pCurItem->Type() >= MAX_NETOBJSIZES || !m_aItemSizes[pCurItem->Type()];
 
 		if(PastIndex != -1)
 		{
-			int *pItemDataDst = pData + 3;
-
 			pPastItem = pFrom->GetItem(PastIndex);
 
-			if(!IncludeSize)
-				pItemDataDst = pData + 2;
+			// most items don't change between snapshots, skip them before writing anything.
+			// only whole ints are sent, so a difference here always gives a non-zero diff
+			if(mem_comp(pPastItem->Data(), pCurItem->Data(), ItemSize / 4 * sizeof(int)) == 0)
+				continue;
+		}
 
-			if(DiffItem(pPastItem->Data(), (int *) pCurItem->Data(), pItemDataDst, ItemSize / 4))
-			{
-				*pData++ = pCurItem->Type();
-				*pData++ = pCurItem->ID();
-				if(IncludeSize)
-					*pData++ = ItemSize / 4;
-				pData += ItemSize / 4;
-				pDelta->m_NumUpdateItems++;
-			}
+		if(!pWriter->Add(pCurItem->Type()) || !pWriter->Add(pCurItem->ID()))
+			return false;
+		if(IncludeSize && !pWriter->Add(ItemSize / 4))
+			return false;
+
+		if(PastIndex != -1)
+		{
+			if(!pWriter->AddDiff(pPastItem->Data(), pCurItem->Data(), ItemSize / 4))
+				return false;
 		}
 		else
 		{
-			*pData++ = pCurItem->Type();
-			*pData++ = pCurItem->ID();
-			if(IncludeSize)
-				*pData++ = ItemSize / 4;
-
-			mem_copy(pData, pCurItem->Data(), ItemSize);
-			pData += ItemSize / 4;
-			pDelta->m_NumUpdateItems++;
+			if(!pWriter->AddData(pCurItem->Data(), ItemSize / 4))
+				return false;
 		}
+		pHeader->m_NumUpdateItems++;
 	}
 
+	return true;
+}
+
+int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData) const
+{
+	CData *pDelta = (CData *) pDstData;
+	CDeltaIntWriter Writer(pDelta->m_aData);
+	if(!GenerateDelta(pFrom, pTo, &Writer, pDelta))
+		return -1;
+
 	if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems && !pDelta->m_NumTempItems)
 		return 0;
 
-	return (int) ((char *) pData - (char *) pDstData);
+	return (int) ((char *) Writer.Data() - (char *) pDstData);
+}
+
+int CSnapshotDelta::CreateDeltaPacked(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData, int DstSize) const
+{
+	// the packed size of the header is only known at the end, so leave room for the largest
+	const int MaxHeaderSize = 3 * CVariableInt::MAX_BYTES_PACKED;
+	if(DstSize < MaxHeaderSize)
+		return -1;
+
+	unsigned char *pDst = (unsigned char *) pDstData;
+	CDeltaPackWriter Writer(pDst + MaxHeaderSize, DstSize - MaxHeaderSize);
+	CData Header;
+	if(!GenerateDelta(pFrom, pTo, &Writer, &Header) || !Writer.Flush())
+		return -1;
+
+	if(!Header.m_NumDeletedItems && !Header.m_NumUpdateItems && !Header.m_NumTempItems)
+		return 0;
+
+	const int aHeader[3] = {Header.m_NumDeletedItems, Header.m_NumUpdateItems, Header.m_NumTempItems};
+	unsigned char aPackedHeader[MaxHeaderSize];
+	const int HeaderSize = CVariableInt::PackMany(aPackedHeader, aHeader, 3, sizeof(aPackedHeader)) - aPackedHeader;
+	const int DataSize = Writer.Data() - (pDst + MaxHeaderSize);
+	mem_move(pDst + HeaderSize, pDst + MaxHeaderSize, DataSize);
+	mem_copy(pDst, aPackedHeader, HeaderSize);
+	return HeaderSize + DataSize;
 }
 
 static int RangeCheck(const void *pEnd, const void *pPtr, int Size)
@@ -398,115 +544,155 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 
 // CSnapshotStorage
 
+CSnapshotStorage::CSnapshotStorage()
+{
+	m_pData = 0;
+	m_DataCapacity = 0;
+	Init();
+}
+
 CSnapshotStorage::~CSnapshotStorage()
 {
-	PurgeAll();
+	mem_free(m_pData);
 }
 
 void CSnapshotStorage::Init()
 {
-	m_pFirst = 0;
-	m_pLast = 0;
+	PurgeAll();
 }
 
 void CSnapshotStorage::PurgeAll()
 {
-	CHolder *pHolder = m_pFirst;
-
-	while(pHolder)
-	{
-		CHolder *pNext = pHolder->m_pNext;
-		mem_free(pHolder);
-		pHolder = pNext;
-	}
+	// the data memory is kept for the next snapshots
+	for(auto &Holder : m_aHolders)
+		Holder.m_Tick = -1;
+	m_FirstOrder = 0;
+	m_NumHolders = 0;
+}
 
-	// no more snapshots in storage
-	m_pFirst = 0;
-	m_pLast = 0;
+void CSnapshotStorage::RemoveOldest()
+{
+	m_aHolders[m_aOrder[m_FirstOrder]].m_Tick = -1;
+	m_FirstOrder = (m_FirstOrder + 1) & (MAX_HOLDERS - 1);
+	m_NumHolders--;
 }
 
 void CSnapshotStorage::PurgeUntil(int Tick)
 {
-	CHolder *pHolder = m_pFirst;
+	while(m_NumHolders && Oldest()->m_Tick < Tick)
+		RemoveOldest();
+}
+
+void CSnapshotStorage::GrowData(int Size)
+{
+	int Used = Size;
+	for(int i = 0; i < m_NumHolders; i++)
+		Used += m_aHolders[m_aOrder[(m_FirstOrder + i) & (MAX_HOLDERS - 1)]].m_DataSize;
+
+	// keep at least half of the memory free so a new snapshot always finds a large enough gap
+	int Capacity = maximum(m_DataCapacity * 2, 64 * 1024);
+	while(Capacity < Used * 2)
+		Capacity *= 2;
+	Capacity = minimum(Capacity, (int) MAX_DATA_SIZE);
 
-	while(pHolder)
+	// move the stored snapshots to the start of the new memory, oldest first
+	char *pData = (char *) mem_alloc(Capacity);
+	int Offset = 0;
+	for(int i = 0; i < m_NumHolders; i++)
 	{
-		CHolder *pNext = pHolder->m_pNext;
-		if(pHolder->m_Tick >= Tick)
-			return; // no more to remove
-		mem_free(pHolder);
+		CHolder *pHolder = &m_aHolders[m_aOrder[(m_FirstOrder + i) & (MAX_HOLDERS - 1)]];
+		mem_copy(pData + Offset, m_pData + pHolder->m_DataOffset, pHolder->m_DataSize);
+		pHolder->m_DataOffset = Offset;
+		Offset += pHolder->m_DataSize;
+	}
 
-		// did we come to the end of the list?
-		if(!pNext)
-			break;
+	mem_free(m_pData);
+	m_pData = pData;
+	m_DataCapacity = Capacity;
+}
 
-		m_pFirst = pNext;
-		pNext->m_pPrev = 0x0;
+int CSnapshotStorage::AllocData(int Size)
+{
+	while(true)
+	{
+		if(!m_NumHolders)
+		{
+			if(Size <= m_DataCapacity)
+				return 0;
+		}
+		else
+		{
+			// the data of the snapshots is in the same order as the snapshots, a block never wraps
+			const int Start = Oldest()->m_DataOffset;
+			const int End = Newest()->m_DataOffset + Newest()->m_DataSize;
+			if(Start < End)
+			{
+				if(m_DataCapacity - End >= Size)
+					return End;
+				if(Start >= Size)
+					return 0;
+			}
+			else if(Start - End >= Size)
+				return End;
+		}
 
-		pHolder = pNext;
+		// the window doesn't fit, make room for it or drop the oldest snapshot if we may not grow further
+		if(m_DataCapacity < MAX_DATA_SIZE)
+			GrowData(Size);
+		else if(m_NumHolders)
+			RemoveOldest();
+		else
+			return -1;
 	}
-
-	// no more snapshots in storage
-	m_pFirst = 0;
-	m_pLast = 0;
 }
 
 void CSnapshotStorage::Add(int Tick, int64_t Tagtime, int DataSize, const void *pData, bool CreateAlt)
 {
-	// allocate memory for holder + snapshot_data
-	int TotalSize = sizeof(CHolder) + DataSize;
+	// ticks going back means the game restarted, nothing we have is valid anymore
+	if(m_NumHolders && Tick <= Newest()->m_Tick)
+		PurgeAll();
 
-	if(CreateAlt)
-		TotalSize += DataSize;
+	// free the holder of the tick, it belongs to a tick too old to keep
+	while(m_NumHolders && Tick - Oldest()->m_Tick >= MAX_HOLDERS)
+		RemoveOldest();
 
-	CHolder *pHolder = (CHolder *) mem_alloc(TotalSize);
+	// keep the snapshots aligned for int access
+	const int Size = ((CreateAlt ? DataSize * 2 : DataSize) + 7) & ~7;
+	const int Offset = AllocData(Size);
+	if(Offset < 0)
+		return;
 
-	// set data
+	CHolder *pHolder = &m_aHolders[Tick & (MAX_HOLDERS - 1)];
 	pHolder->m_Tick = Tick;
 	pHolder->m_Tagtime = Tagtime;
 	pHolder->m_SnapSize = DataSize;
-	pHolder->m_pSnap = (CSnapshot *) (pHolder + 1);
-	mem_copy(pHolder->m_pSnap, pData, DataSize);
-
+	pHolder->m_DataOffset = Offset;
+	pHolder->m_DataSize = Size;
+	pHolder->m_HasAlt = CreateAlt;
+	mem_copy(m_pData + Offset, pData, DataSize);
 	if(CreateAlt) // create alternative if wanted
-	{
-		pHolder->m_pAltSnap = (CSnapshot *) (((char *) pHolder->m_pSnap) + DataSize);
-		mem_copy(pHolder->m_pAltSnap, pData, DataSize);
-	}
-	else
-		pHolder->m_pAltSnap = 0;
+		mem_copy(m_pData + Offset + DataSize, pData, DataSize);
 
-	// link
-	pHolder->m_pNext = 0;
-	pHolder->m_pPrev = m_pLast;
-	if(m_pLast)
-		m_pLast->m_pNext = pHolder;
-	else
-		m_pFirst = pHolder;
-	m_pLast = pHolder;
+	m_aOrder[(m_FirstOrder + m_NumHolders) & (MAX_HOLDERS - 1)] = Tick & (MAX_HOLDERS - 1);
+	m_NumHolders++;
 }
 
 int CSnapshotStorage::Get(int Tick, int64_t *pTagtime, CSnapshot **ppData, CSnapshot **ppAltData) const
 {
-	CHolder *pHolder = m_pFirst;
-
-	while(pHolder)
-	{
-		if(pHolder->m_Tick == Tick)
-		{
-			if(pTagtime)
-				*pTagtime = pHolder->m_Tagtime;
-			if(ppData)
-				*ppData = pHolder->m_pSnap;
-			if(ppAltData)
-				*ppAltData = pHolder->m_pAltSnap;
-			return pHolder->m_SnapSize;
-		}
+	if(Tick < 0)
+		return -1;
 
-		pHolder = pHolder->m_pNext;
-	}
+	const CHolder *pHolder = &m_aHolders[Tick & (MAX_HOLDERS - 1)];
+	if(pHolder->m_Tick != Tick)
+		return -1;
 
-	return -1;
+	if(pTagtime)
+		*pTagtime = pHolder->m_Tagtime;
+	if(ppData)
+		*ppData = (CSnapshot *) (m_pData + pHolder->m_DataOffset);
+	if(ppAltData)
+		*ppAltData = pHolder->m_HasAlt ? (CSnapshot *) (m_pData + pHolder->m_DataOffset + pHolder->m_SnapSize) : 0;
+	return pHolder->m_SnapSize;
 }
 
 // CSnapshotBuilder
@@ -534,6 +720,7 @@ void CSnapshotBuilder::Init(const CSnapshot *pSnapshot)
 	m_NumItems = pSnapshot->m_NumItems;
 	mem_copy(m_aOffsets, pSnapshot->Offsets(), sizeof(int) * m_NumItems);
 	mem_copy(m_aData, pSnapshot->DataStart(), m_DataSize);
+	BuildSortedIndex();
 }
 
 bool CSnapshotBuilder::UnserializeSnap(const char *pSrcData, int SrcSize)
@@ -567,6 +754,7 @@ bool CSnapshotBuilder::UnserializeSnap(const char *pSrcData, int SrcSize)
 	m_NumItems = NumItems;
 	mem_copy(m_aOffsets, pOffsets, sizeof(int) * m_NumItems);
 	mem_copy(m_aData, pOffsets + m_NumItems, m_DataSize);
+	BuildSortedIndex();
 	return true;
 }
 
@@ -577,12 +765,42 @@ CSnapshotItem *CSnapshotBuilder::GetItem(int Index) const
 
 int *CSnapshotBuilder::GetItemData(int Key) const
 {
-	for(int i = 0; i < m_NumItems; i++)
+	int Pos = FindSortedPos(Key);
+	if(Pos < m_NumItems && m_aSortedKeys[Pos] == Key)
+		return GetItem(m_aSortedIndices[Pos])->Data();
+	return 0;
+}
+
+int CSnapshotBuilder::FindSortedPos(int Key) const
+{
+	// first position whose key is not less than the given one
+	return std::lower_bound(m_aSortedKeys, m_aSortedKeys + m_NumItems, Key) - m_aSortedKeys;
+}
+
+void CSnapshotBuilder::InsertSorted(int Index)
+{
+	// m_NumItems does not include the new item yet
+	const int Key = GetItem(Index)->Key();
+	int Pos = m_NumItems;
+
+	// items are mostly added in key order, only search if that is not the case
+	if(m_NumItems > 0 && m_aSortedKeys[m_NumItems - 1] > Key)
 	{
-		if(GetItem(i)->Key() == Key)
-			return GetItem(i)->Data();
+		// insert after items with the same key to keep the order stable
+		Pos = std::upper_bound(m_aSortedKeys, m_aSortedKeys + m_NumItems, Key) - m_aSortedKeys;
+		mem_move(&m_aSortedKeys[Pos + 1], &m_aSortedKeys[Pos], sizeof(int) * (m_NumItems - Pos));
+		mem_move(&m_aSortedIndices[Pos + 1], &m_aSortedIndices[Pos], sizeof(int) * (m_NumItems - Pos));
 	}
-	return 0;
+
+	m_aSortedKeys[Pos] = Key;
+	m_aSortedIndices[Pos] = Index;
+}
+
+void CSnapshotBuilder::BuildSortedIndex()
+{
+	const int NumItems = m_NumItems;
+	for(m_NumItems = 0; m_NumItems < NumItems; m_NumItems++)
+		InsertSorted(m_NumItems);
 }
 
 int CSnapshotBuilder::Finish(void *pSnapdata)
@@ -594,52 +812,18 @@ int CSnapshotBuilder::Finish(void *pSnapdata)
 	pSnap->m_DataSize = m_DataSize;
 	pSnap->m_NumItems = m_NumItems;
 
+	// keys are already sorted, copy the items in key order
 	const int NumItems = m_NumItems;
-	for(int i = 0; i < NumItems; i++)
-	{
-		pSnap->SortedKeys()[i] = GetItem(i)->Key();
-	}
-
-	// get full item sizes
-	int aItemSizes[CSnapshotBuilder::MAX_ITEMS];
-
-	for(int i = 0; i < NumItems; i++)
-	{
-		if(i < NumItems - 1)
-		{
-			aItemSizes[i] = m_aOffsets[i + 1] - m_aOffsets[i];
-		}
-		else
-		{
-			aItemSizes[i] = m_DataSize - m_aOffsets[i];
-		}
-	}
-
-	// bubble sort by keys
-	bool Sorting = true;
-	while(Sorting)
-	{
-		Sorting = false;
-
-		for(int i = 1; i < NumItems; i++)
-		{
-			if(pSnap->SortedKeys()[i - 1] > pSnap->SortedKeys()[i])
-			{
-				Sorting = true;
-				std::swap(pSnap->SortedKeys()[i], pSnap->SortedKeys()[i - 1]);
-				std::swap(m_aOffsets[i], m_aOffsets[i - 1]);
-				std::swap(aItemSizes[i], aItemSizes[i - 1]);
-			}
-		}
-	}
+	mem_copy(pSnap->SortedKeys(), m_aSortedKeys, KeySize);
 
-	// copy sorted items
 	int OffsetCur = 0;
 	for(int i = 0; i < NumItems; i++)
 	{
+		const int Index = m_aSortedIndices[i];
+		const int ItemSize = (Index < NumItems - 1 ? m_aOffsets[Index + 1] : m_DataSize) - m_aOffsets[Index];
 		pSnap->Offsets()[i] = OffsetCur;
-		mem_copy(pSnap->DataStart() + OffsetCur, m_aData + m_aOffsets[i], aItemSizes[i]);
-		OffsetCur += aItemSizes[i];
+		mem_copy(pSnap->DataStart() + OffsetCur, m_aData + m_aOffsets[Index], ItemSize);
+		OffsetCur += ItemSize;
 	}
 
 	return sizeof(CSnapshot) + KeySize + OffsetSize + m_DataSize;
@@ -661,6 +845,7 @@ void *CSnapshotBuilder::NewItem(int Type, int ID, int Size)
 	mem_zero(pObj, sizeof(CSnapshotItem) + Size);
 	pObj->SetKey(Type, ID);
 	m_aOffsets[m_NumItems] = m_DataSize;
+	InsertSorted(m_NumItems);
 	m_DataSize += sizeof(CSnapshotItem) + Size;
 	m_NumItems++;
 
@@ -83,44 +83,72 @@ private:
 	int m_aSnapshotDataUpdates[CSnapshot::MAX_TYPE + 1];
 	CData m_Empty;
 
+	template<typename TWriter>
+	bool GenerateDelta(const class CSnapshot *pFrom, const class CSnapshot *pTo, TWriter *pWriter, CData *pHeader) const;
+
 public:
 	CSnapshotDelta();
 	int GetDataRate(int Index) const { return m_aSnapshotDataRate[Index]; }
 	int GetDataUpdates(int Index) const { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
 	const CData *EmptyDelta() const;
-	int CreateDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData);
+	int CreateDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData) const;
+	// same as CVariableInt::Compress on the output of CreateDelta, without the delta in between
+	int CreateDeltaPacked(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData, int DstSize) const;
 	int UnpackDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, const void *pSrcData, int DataSize);
 };
 
 // CSnapshotStorage
 
+// keeps the snapshots of the last ticks in a ring, reusing its memory once it has grown
+// large enough for the window. ticks have to be added in increasing order
 class CSnapshotStorage
 {
 public:
+	enum
+	{
+		MAX_HOLDERS = 256, // power of two, more than the ticks between two purges
+		MAX_DATA_SIZE = CSnapshot::MAX_SIZE * 128,
+	};
+
 	class CHolder
 	{
 	public:
-		CHolder *m_pPrev;
-		CHolder *m_pNext;
-
 		int64_t m_Tagtime;
-		int m_Tick;
+		int m_Tick; // -1 if the holder is free
 
 		int m_SnapSize;
-		CSnapshot *m_pSnap;
-		CSnapshot *m_pAltSnap;
+		int m_DataOffset;
+		int m_DataSize; // both snapshots and alignment
+		bool m_HasAlt;
 	};
 
-	CHolder *m_pFirst;
-	CHolder *m_pLast;
+private:
+	CHolder m_aHolders[MAX_HOLDERS]; // indexed by tick
+	int m_aOrder[MAX_HOLDERS]; // holder indices, oldest first
+	int m_FirstOrder;
+	int m_NumHolders;
 
+	char *m_pData;
+	int m_DataCapacity;
+
+	const CHolder *Oldest() const { return &m_aHolders[m_aOrder[m_FirstOrder]]; }
+	const CHolder *Newest() const { return &m_aHolders[m_aOrder[(m_FirstOrder + m_NumHolders - 1) & (MAX_HOLDERS - 1)]]; }
+	void RemoveOldest();
+	int AllocData(int Size);
+	void GrowData(int Size);
+
+public:
+	CSnapshotStorage();
 	~CSnapshotStorage();
 	void Init();
 	void PurgeAll();
 	void PurgeUntil(int Tick);
 	void Add(int Tick, int64_t Tagtime, int DataSize, const void *pData, bool CreateAlt);
 	int Get(int Tick, int64_t *pTagtime, CSnapshot **ppData, CSnapshot **ppAltData) const;
+
+	int NumSnapshots() const { return m_NumHolders; }
+	int MemoryUsage() const { return sizeof(*this) + m_DataCapacity; }
 };
 
 class CSnapshotBuilder
@@ -136,6 +164,14 @@ class CSnapshotBuilder
 	int m_aOffsets[MAX_ITEMS];
 	int m_NumItems;
 
+	// keys of all items and their insertion index, kept sorted by key as items are added
+	int m_aSortedKeys[MAX_ITEMS];
+	int m_aSortedIndices[MAX_ITEMS];
+
+	int FindSortedPos(int Key) const;
+	void InsertSorted(int Index);
+	void BuildSortedIndex();
+
 public:
 	void Init();
 	void Init(const CSnapshot *pSnapshot);
@@ -18,16 +18,26 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pTiles = nullptr;
-	m_pPhysicalQuads = nullptr;
+	m_QuadBinsX = 0;
+	m_VisibilityRegionsX = 0;
+	m_VisibilityRegionsY = 0;
 }
 
 void CCollision::Init(class CLayers *pLayers)
 {
 	m_pLayers = pLayers;
-	m_Width = m_pLayers->GameLayer()->m_Width;
-	m_Height = m_pLayers->GameLayer()->m_Height;
-	m_pTiles = static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data));
-	m_pPhysicalQuads = static_cast<CQuad *>(m_pLayers->Map()->GetDataSwapped(m_pLayers->PhysicalLayer()->m_Data));
+	CMapItemLayerQuads *pPhysicalLayer = m_pLayers->PhysicalLayer();
+	CQuad *pPhysicalQuads = pPhysicalLayer ? static_cast<CQuad *>(m_pLayers->Map()->GetDataSwapped(pPhysicalLayer->m_Data)) : nullptr;
+	Init(static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data)), m_pLayers->GameLayer()->m_Width, m_pLayers->GameLayer()->m_Height,
+		pPhysicalQuads, pPhysicalQuads ? pPhysicalLayer->m_NumQuads : 0);
+}
+
+void CCollision::Init(CTile *pTiles, int Width, int Height, CQuad *pPhysicalQuads, int NumPhysicalQuads)
+{
+	m_Width = Width;
+	m_Height = Height;
+	m_pTiles = pTiles;
+	m_vVisibility.clear();
 
 	for(int i = 0; i < m_Width * m_Height; i++)
 	{
@@ -56,28 +66,92 @@ void CCollision::Init(class CLayers *pLayers)
 	}
 
 	// check physical quads
-	if(m_pPhysicalQuads)
+	for(int q = 0; q < NumPhysicalQuads; q++)
 	{
-		for(int q = 0; q < m_pLayers->PhysicalLayer()->m_NumQuads; q++)
+		int Index = pPhysicalQuads[q].m_ColorEnvOffset;
+
+		if(Index > 128)
+			continue;
+
+		switch(Index)
 		{
-			int Index = m_pPhysicalQuads[q].m_ColorEnvOffset;
+		case TILE_DEATH:
+			pPhysicalQuads[q].m_ColorEnvOffset = COLFLAG_DEATH;
+			break;
+		case TILE_EXPORT:
+			pPhysicalQuads[q].m_ColorEnvOffset = COLFLAG_EXPORT;
+			break;
+		case TILE_SOLID: // bad collision prediction
+		case TILE_NOHOOK: // bad collision prediction
+		default:
+			pPhysicalQuads[q].m_ColorEnvOffset = 0;
+		}
+	}
 
-			if(Index > 128)
-				continue;
+	InitPhysicalQuads(pPhysicalQuads, NumPhysicalQuads);
+}
 
-			switch(Index)
-			{
-			case TILE_DEATH:
-				m_pPhysicalQuads[q].m_ColorEnvOffset = COLFLAG_DEATH;
-				break;
-			case TILE_EXPORT:
-				m_pPhysicalQuads[q].m_ColorEnvOffset = COLFLAG_EXPORT;
-				break;
-			case TILE_SOLID: // bad collision prediction
-			case TILE_NOHOOK: // bad collision prediction
-			default:
-				m_pPhysicalQuads[q].m_ColorEnvOffset = 0;
-			}
+void CCollision::InitPhysicalQuads(CQuad *pQuads, int NumQuads)
+{
+	m_vPhysicalQuads.clear();
+	m_vQuadBinStart.clear();
+	m_vQuadBinQuads.clear();
+	m_QuadBinsX = 0;
+
+	// quads without flags can't change a tile, leave them out
+	for(int q = 0; q < NumQuads; q++)
+	{
+		if(pQuads[q].m_ColorEnvOffset == 0)
+			continue;
+
+		CPhysicalQuad Quad;
+		for(int c = 0; c < 4; c++)
+			Quad.m_aCorners[c] = vec2(fx2f(pQuads[q].m_aPoints[c].x), fx2f(pQuads[q].m_aPoints[c].y));
+		Quad.m_Min = Quad.m_Max = Quad.m_aCorners[0];
+		for(int c = 1; c < 4; c++)
+		{
+			Quad.m_Min = vec2(minimum(Quad.m_Min.x, Quad.m_aCorners[c].x), minimum(Quad.m_Min.y, Quad.m_aCorners[c].y));
+			Quad.m_Max = vec2(maximum(Quad.m_Max.x, Quad.m_aCorners[c].x), maximum(Quad.m_Max.y, Quad.m_aCorners[c].y));
+		}
+		// grow by a unit so rounding in the inside test never reaches past the box
+		Quad.m_Min -= vec2(1.0f, 1.0f);
+		Quad.m_Max += vec2(1.0f, 1.0f);
+		Quad.m_Flags = pQuads[q].m_ColorEnvOffset;
+		m_vPhysicalQuads.push_back(Quad);
+	}
+
+	if(m_vPhysicalQuads.empty())
+		return;
+
+	// bin the quads by the clamped tiles their bounding box covers, the same way GetTile looks them up
+	m_QuadBinsX = (m_Width + QUAD_BIN_TILES - 1) / QUAD_BIN_TILES;
+	const int QuadBinsY = (m_Height + QUAD_BIN_TILES - 1) / QUAD_BIN_TILES;
+	m_vQuadBinStart.assign(m_QuadBinsX * QuadBinsY + 1, 0);
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		for(int q = 0; q < (int) m_vPhysicalQuads.size(); q++)
+		{
+			const CPhysicalQuad &Quad = m_vPhysicalQuads[q];
+			const int BinX0 = clamp((int) floorf(Quad.m_Min.x) / 32, 0, m_Width - 1) / QUAD_BIN_TILES;
+			const int BinY0 = clamp((int) floorf(Quad.m_Min.y) / 32, 0, m_Height - 1) / QUAD_BIN_TILES;
+			const int BinX1 = clamp((int) ceilf(Quad.m_Max.x) / 32, 0, m_Width - 1) / QUAD_BIN_TILES;
+			const int BinY1 = clamp((int) ceilf(Quad.m_Max.y) / 32, 0, m_Height - 1) / QUAD_BIN_TILES;
+			for(int y = BinY0; y <= BinY1; y++)
+				for(int x = BinX0; x <= BinX1; x++)
+				{
+					// first pass counts, second pass fills each bin from its end down to its start
+					if(Pass == 0)
+						m_vQuadBinStart[y * m_QuadBinsX + x]++;
+					else
+						m_vQuadBinQuads[--m_vQuadBinStart[y * m_QuadBinsX + x]] = q;
+				}
+		}
+
+		if(Pass == 0)
+		{
+			for(int i = 1; i < (int) m_vQuadBinStart.size(); i++)
+				m_vQuadBinStart[i] += m_vQuadBinStart[i - 1];
+			m_vQuadBinQuads.resize(m_vQuadBinStart.back());
 		}
 	}
 }
@@ -136,19 +210,22 @@ int CCollision::GetTile(int x, int y, bool PhysicLayer) const
 	int Ny = clamp(y / 32, 0, m_Height - 1);
 
 	int Index = m_pTiles[Ny * m_Width + Nx].m_Index > 128 ? 0 : m_pTiles[Ny * m_Width + Nx].m_Index;
-	if(PhysicLayer &&  m_pPhysicalQuads)
+	if(PhysicLayer && !m_vPhysicalQuads.empty())
 	{
-		// check physical quads
-		for(int q = 0; q < m_pLayers->PhysicalLayer()->m_NumQuads; q++)
+		// check the physical quads that overlap this tile
+		const vec2 Pos = vec2(x, y);
+		const int Bin = Ny / QUAD_BIN_TILES * m_QuadBinsX + Nx / QUAD_BIN_TILES;
+		for(int i = m_vQuadBinStart[Bin]; i < m_vQuadBinStart[Bin + 1]; i++)
 		{
-			vec2 p0 = vec2(fx2f(m_pPhysicalQuads[q].m_aPoints[0].x), fx2f(m_pPhysicalQuads[q].m_aPoints[0].y));
-			vec2 p1 = vec2(fx2f(m_pPhysicalQuads[q].m_aPoints[1].x), fx2f(m_pPhysicalQuads[q].m_aPoints[1].y));
-			vec2 p2 = vec2(fx2f(m_pPhysicalQuads[q].m_aPoints[2].x), fx2f(m_pPhysicalQuads[q].m_aPoints[2].y));
-			vec2 p3 = vec2(fx2f(m_pPhysicalQuads[q].m_aPoints[3].x), fx2f(m_pPhysicalQuads[q].m_aPoints[3].y));
+			const CPhysicalQuad &Quad = m_vPhysicalQuads[m_vQuadBinQuads[i]];
+			if((Quad.m_Flags & ~Index) == 0)
+				continue; // can't add anything
+			if(Pos.x < Quad.m_Min.x || Pos.x > Quad.m_Max.x || Pos.y < Quad.m_Min.y || Pos.y > Quad.m_Max.y)
+				continue;
 
-			if(InsideQuad(p0, p1, p2, p3, vec2(x, y)))
+			if(InsideQuad(Quad.m_aCorners[0], Quad.m_aCorners[1], Quad.m_aCorners[2], Quad.m_aCorners[3], Pos))
 			{
-				Index |= m_pPhysicalQuads[q].m_ColorEnvOffset;
+				Index |= Quad.m_Flags;
 			}
 		}
 	}
@@ -161,26 +238,102 @@ bool CCollision::IsTile(int x, int y, int Flag, bool PhysicLayer) const
 	return GetTile(x, y, PhysicLayer) & Flag;
 }
 
-// TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, bool PhysicLayer) const
 {
+	// the line is sampled at End + 1 evenly spaced points and the first sample inside a solid tile is the hit.
+	// instead of testing every sample, walk the tiles the line passes (Amanatides-Woo) and only test the
+	// samples in solid tiles. the result is exactly the same as testing every sample, which matters
+	// because clients predict the hook with the sampled version.
 	const int End = distance(Pos0, Pos1) + 1;
 	const float InverseEnd = 1.0f / End;
-	vec2 Last = Pos0;
 
-	for(int i = 0; i <= End; i++)
+	// the sampled version passes PhysicLayer as the flag to CheckPoint, so without it nothing stops the line
+	if(PhysicLayer)
 	{
-		vec2 Pos = mix(Pos0, Pos1, i * InverseEnd);
-		if(CheckPoint(Pos.x, Pos.y, PhysicLayer))
+		// a sample at Pos is in tile floor((Pos + 0.5) / 32) because of the rounding in CheckPoint
+		const double StartX = Pos0.x + 0.5;
+		const double StartY = Pos0.y + 0.5;
+		const double DirX = Pos1.x - Pos0.x;
+		const double DirY = Pos1.y - Pos0.y;
+		const double Infinity = 1e30;
+		int CellX = (int) floor(StartX / 32);
+		int CellY = (int) floor(StartY / 32);
+		const int StepX = DirX > 0 ? 1 : -1;
+		const int StepY = DirY > 0 ? 1 : -1;
+		double NextX = DirX != 0 ? ((CellX + (StepX > 0)) * 32.0 - StartX) / DirX : Infinity;
+		double NextY = DirY != 0 ? ((CellY + (StepY > 0)) * 32.0 - StartY) / DirY : Infinity;
+		const double DeltaX = DirX != 0 ? 32.0 / fabs(DirX) : Infinity;
+		const double DeltaY = DirY != 0 ? 32.0 / fabs(DirY) : Infinity;
+
+		// the last sample can land a bit past Pos1 due to float rounding
+		const double Limit = 1.0 + 2.0 / End;
+		// the samples are computed and rounded in float, parts of the line closer than this to a tile border
+		// also test the tile on the other side
+		const double Epsilon = (maximum(maximum(fabs(Pos0.x), fabs(Pos0.y)), maximum(fabs(Pos1.x), fabs(Pos1.y))) + 1.0) * 1e-5;
+		double Enter = 0.0;
+		int NextSample = 0;
+		int Hit = -1;
+
+		// tests the samples from Enter to Exit if they can be in a solid tile, with one extra on each side against rounding.
+		// physical quads can't set COLFLAG_SOLID (Init clears it), so tiles without it are skipped
+		auto TestTile = [&](int x, int y, double Enter, double Exit) {
+			const int Index = m_pTiles[clamp(y, 0, m_Height - 1) * m_Width + clamp(x, 0, m_Width - 1)].m_Index;
+			if(Index > 128 || !(Index & COLFLAG_SOLID))
+				return;
+			const int Last = minimum(End, (int) ceil(Exit * End) + 1);
+			for(int i = maximum(NextSample, (int) floor(Enter * End) - 1); i <= Last && Hit == -1; i++)
+			{
+				vec2 Pos = mix(Pos0, Pos1, i * InverseEnd);
+				if(CheckPoint(Pos.x, Pos.y, PhysicLayer))
+					Hit = i;
+			}
+			NextSample = maximum(NextSample, Last + 1);
+		};
+
+		while(Enter <= Limit && NextSample <= End && Hit == -1)
+		{
+			const double Exit = minimum(minimum(NextX, NextY), Limit);
+			TestTile(CellX, CellY, Enter, Exit);
+
+			// the part of the line in this tile, lines along a border can have samples on both sides of it
+			const double EnterX = StartX + DirX * Enter;
+			const double ExitX = StartX + DirX * Exit;
+			const double EnterY = StartY + DirY * Enter;
+			const double ExitY = StartY + DirY * Exit;
+			const int LowX = minimum(EnterX, ExitX) - CellX * 32.0 < Epsilon ? -1 : 0;
+			const int HighX = (CellX + 1) * 32.0 - maximum(EnterX, ExitX) < Epsilon ? 1 : 0;
+			const int LowY = minimum(EnterY, ExitY) - CellY * 32.0 < Epsilon ? -1 : 0;
+			const int HighY = (CellY + 1) * 32.0 - maximum(EnterY, ExitY) < Epsilon ? 1 : 0;
+			for(int y = LowY; y <= HighY && Hit == -1; y++)
+				for(int x = LowX; x <= HighX && Hit == -1; x++)
+					if(x != 0 || y != 0)
+						TestTile(CellX + x, CellY + y, Enter, Exit);
+
+			if(NextX < NextY)
+			{
+				CellX += StepX;
+				Enter = NextX;
+				NextX += DeltaX;
+			}
+			else
+			{
+				CellY += StepY;
+				Enter = NextY;
+				NextY += DeltaY;
+			}
+		}
+
+		if(Hit != -1)
 		{
+			vec2 Pos = mix(Pos0, Pos1, Hit * InverseEnd);
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = Hit > 0 ? mix(Pos0, Pos1, (Hit - 1) * InverseEnd) : Pos0;
 			return GetCollisionAt(Pos.x, Pos.y, PhysicLayer);
 		}
-		Last = Pos;
 	}
+
 	if(pOutCollision)
 		*pOutCollision = Pos1;
 	if(pOutBeforeCollision)
@@ -188,6 +341,206 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 	return 0;
 }
 
+int CCollision::IntersectLines(const vec2 *pStarts, const vec2 *pEnds, int Num, int *pResults, vec2 *pOutCollisions, bool PhysicLayer) const
+{
+	int Hits = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		pResults[i] = IntersectLine(pStarts[i], pEnds[i], pOutCollisions ? &pOutCollisions[i] : nullptr, nullptr, PhysicLayer);
+		if(pResults[i])
+			Hits++;
+	}
+	return Hits;
+}
+
+// true if the tile box touches the convex hull of the boxes A and B, which is every box interpolated between them
+static bool TouchesHull(vec2 AMin, vec2 AMax, vec2 BMin, vec2 BMax, vec2 TileMin, vec2 TileMax)
+{
+	float Low = 0.0f;
+	float High = 1.0f;
+	// each side gives one linear condition on the interpolation: Start + t * Delta <= Limit
+	auto Limit = [&](float Start, float Delta, float Bound) {
+		if(Delta > 0.0f)
+			High = minimum(High, (Bound - Start) / Delta);
+		else if(Delta < 0.0f)
+			Low = maximum(Low, (Bound - Start) / Delta);
+		else if(Start > Bound)
+			High = -1.0f;
+	};
+	Limit(AMin.x, BMin.x - AMin.x, TileMax.x);
+	Limit(-AMax.x, AMax.x - BMax.x, -TileMin.x);
+	Limit(AMin.y, BMin.y - AMin.y, TileMax.y);
+	Limit(-AMax.y, AMax.y - BMax.y, -TileMin.y);
+	return Low <= High;
+}
+
+bool CCollision::VisibilityRegion(vec2 Pos, int *pX, int *pY) const
+{
+	// positions outside of the map are clamped to the border tiles by GetTile, they have no region
+	const int x = round_to_int(Pos.x);
+	const int y = round_to_int(Pos.y);
+	if(x < 0 || y < 0 || x >= m_Width * 32 || y >= m_Height * 32)
+		return false;
+	*pX = x / 32 / VISIBILITY_REGION_TILES;
+	*pY = y / 32 / VISIBILITY_REGION_TILES;
+	return true;
+}
+
+bool CCollision::RegionsMaySee(int AX, int AY, int BX, int BY, std::vector<unsigned char> *pvVisited, std::vector<int> *pvStack) const
+{
+	// IntersectLine tests samples less than a unit apart, so the tiles of the samples of a line that hits
+	// nothing are free and 8-connected. they also touch the convex hull of both regions, grown by the rounding
+	// to whole units. if no such path of tiles joins the regions, every line between them hits a solid tile.
+	const vec2 AMin = vec2(AX, AY) * (VISIBILITY_REGION_TILES * 32.0f);
+	const vec2 AMax = vec2(minimum((AX + 1) * VISIBILITY_REGION_TILES, m_Width), minimum((AY + 1) * VISIBILITY_REGION_TILES, m_Height)) * 32.0f;
+	const vec2 BMin = vec2(BX, BY) * (VISIBILITY_REGION_TILES * 32.0f);
+	const vec2 BMax = vec2(minimum((BX + 1) * VISIBILITY_REGION_TILES, m_Width), minimum((BY + 1) * VISIBILITY_REGION_TILES, m_Height)) * 32.0f;
+
+	// the tiles of the regions with a border of one, the last sample can round into the next tile
+	const int ATileX0 = maximum(AX * VISIBILITY_REGION_TILES - 1, 0);
+	const int ATileY0 = maximum(AY * VISIBILITY_REGION_TILES - 1, 0);
+	const int ATileX1 = minimum((AX + 1) * VISIBILITY_REGION_TILES, m_Width - 1);
+	const int ATileY1 = minimum((AY + 1) * VISIBILITY_REGION_TILES, m_Height - 1);
+	const int BTileX0 = maximum(BX * VISIBILITY_REGION_TILES - 1, 0);
+	const int BTileY0 = maximum(BY * VISIBILITY_REGION_TILES - 1, 0);
+	const int BTileX1 = minimum((BX + 1) * VISIBILITY_REGION_TILES, m_Width - 1);
+	const int BTileY1 = minimum((BY + 1) * VISIBILITY_REGION_TILES, m_Height - 1);
+	const int X0 = minimum(ATileX0, BTileX0);
+	const int Y0 = minimum(ATileY0, BTileY0);
+	const int Width = maximum(ATileX1, BTileX1) - X0 + 1;
+	const int Height = maximum(ATileY1, BTileY1) - Y0 + 1;
+
+	auto InA = [&](int x, int y) { return x >= ATileX0 && x <= ATileX1 && y >= ATileY0 && y <= ATileY1; };
+	auto InB = [&](int x, int y) { return x >= BTileX0 && x <= BTileX1 && y >= BTileY0 && y <= BTileY1; };
+	auto Passable = [&](int x, int y) {
+		const int Index = m_pTiles[y * m_Width + x].m_Index;
+		if(Index <= 128 && (Index & COLFLAG_SOLID))
+			return false;
+		return InA(x, y) || InB(x, y) || TouchesHull(AMin, AMax, BMin, BMax, vec2(x, y) * 32.0f - vec2(2.0f, 2.0f), vec2(x + 1, y + 1) * 32.0f + vec2(2.0f, 2.0f));
+	};
+
+	pvVisited->assign(Width * Height, 0);
+	pvStack->clear();
+	for(int y = ATileY0; y <= ATileY1; y++)
+		for(int x = ATileX0; x <= ATileX1; x++)
+		{
+			(*pvVisited)[(y - Y0) * Width + x - X0] = 1;
+			if(Passable(x, y))
+			{
+				if(InB(x, y))
+					return true;
+				pvStack->push_back((y - Y0) * Width + x - X0);
+			}
+		}
+
+	while(!pvStack->empty())
+	{
+		const int Cell = pvStack->back();
+		pvStack->pop_back();
+		const int CellX = Cell % Width;
+		const int CellY = Cell / Width;
+		for(int y = maximum(CellY - 1, 0); y <= minimum(CellY + 1, Height - 1); y++)
+			for(int x = maximum(CellX - 1, 0); x <= minimum(CellX + 1, Width - 1); x++)
+			{
+				if((*pvVisited)[y * Width + x])
+					continue;
+				(*pvVisited)[y * Width + x] = 1;
+				if(!Passable(X0 + x, Y0 + y))
+					continue;
+				if(InB(X0 + x, Y0 + y))
+					return true;
+				pvStack->push_back(y * Width + x);
+			}
+	}
+	return false;
+}
+
+void CCollision::InitVisibility()
+{
+	m_VisibilityRegionsX = (m_Width + VISIBILITY_REGION_TILES - 1) / VISIBILITY_REGION_TILES;
+	m_VisibilityRegionsY = (m_Height + VISIBILITY_REGION_TILES - 1) / VISIBILITY_REGION_TILES;
+	m_vVisibility.assign((m_VisibilityRegionsX * m_VisibilityRegionsY * VISIBILITY_NEIGHBOURS + 7) / 8, 0);
+
+	auto SetBit = [&](int X, int Y, int DX, int DY) {
+		const int Bit = (Y * m_VisibilityRegionsX + X) * VISIBILITY_NEIGHBOURS + (DY + VISIBILITY_RANGE) * VISIBILITY_SPAN + DX + VISIBILITY_RANGE;
+		m_vVisibility[Bit / 8] |= 1 << (Bit % 8);
+	};
+
+	std::vector<unsigned char> vVisited;
+	std::vector<int> vStack;
+	for(int AY = 0; AY < m_VisibilityRegionsY; AY++)
+		for(int AX = 0; AX < m_VisibilityRegionsX; AX++)
+		{
+			// the test is symmetric, do each pair once
+			for(int DY = 0; DY <= VISIBILITY_RANGE; DY++)
+				for(int DX = DY == 0 ? 0 : -VISIBILITY_RANGE; DX <= VISIBILITY_RANGE; DX++)
+				{
+					const int BX = AX + DX;
+					const int BY = AY + DY;
+					if(BX < 0 || BX >= m_VisibilityRegionsX || BY >= m_VisibilityRegionsY)
+						continue;
+					if((DX == 0 && DY == 0) || RegionsMaySee(AX, AY, BX, BY, &vVisited, &vStack))
+					{
+						SetBit(AX, AY, DX, DY);
+						SetBit(BX, BY, -DX, -DY);
+					}
+				}
+		}
+}
+
+static const unsigned char gs_aVisibilityMagic[4] = {'T', 'W', 'V', 'S'};
+static const int gs_VisibilityVersion = 1;
+
+bool CCollision::LoadVisibility(IOHANDLE File)
+{
+	// magic, version, region size, range and map size, then the bits
+	unsigned char aHeader[4 + 5 * 4];
+	if(io_read(File, aHeader, sizeof(aHeader)) != sizeof(aHeader) || mem_comp(aHeader, gs_aVisibilityMagic, sizeof(gs_aVisibilityMagic)) != 0)
+		return false;
+	if(bytes_be_to_int(aHeader + 4) != gs_VisibilityVersion || bytes_be_to_int(aHeader + 8) != VISIBILITY_REGION_TILES ||
+		bytes_be_to_int(aHeader + 12) != VISIBILITY_RANGE || bytes_be_to_int(aHeader + 16) != m_Width || bytes_be_to_int(aHeader + 20) != m_Height)
+		return false;
+
+	m_VisibilityRegionsX = (m_Width + VISIBILITY_REGION_TILES - 1) / VISIBILITY_REGION_TILES;
+	m_VisibilityRegionsY = (m_Height + VISIBILITY_REGION_TILES - 1) / VISIBILITY_REGION_TILES;
+	m_vVisibility.resize((m_VisibilityRegionsX * m_VisibilityRegionsY * VISIBILITY_NEIGHBOURS + 7) / 8);
+	if(io_read(File, m_vVisibility.data(), m_vVisibility.size()) != m_vVisibility.size())
+	{
+		m_vVisibility.clear();
+		return false;
+	}
+	return true;
+}
+
+bool CCollision::SaveVisibility(IOHANDLE File) const
+{
+	if(!HasVisibility())
+		return false;
+
+	unsigned char aHeader[4 + 5 * 4];
+	mem_copy(aHeader, gs_aVisibilityMagic, sizeof(gs_aVisibilityMagic));
+	int_to_bytes_be(aHeader + 4, gs_VisibilityVersion);
+	int_to_bytes_be(aHeader + 8, VISIBILITY_REGION_TILES);
+	int_to_bytes_be(aHeader + 12, VISIBILITY_RANGE);
+	int_to_bytes_be(aHeader + 16, m_Width);
+	int_to_bytes_be(aHeader + 20, m_Height);
+	return io_write(File, aHeader, sizeof(aHeader)) == sizeof(aHeader) &&
+	       io_write(File, m_vVisibility.data(), m_vVisibility.size()) == m_vVisibility.size();
+}
+
+bool CCollision::MaySee(vec2 Pos0, vec2 Pos1) const
+{
+	int AX, AY, BX, BY;
+	if(!HasVisibility() || !VisibilityRegion(Pos0, &AX, &AY) || !VisibilityRegion(Pos1, &BX, &BY))
+		return true;
+	const int DX = BX - AX;
+	const int DY = BY - AY;
+	if(absolute(DX) > VISIBILITY_RANGE || absolute(DY) > VISIBILITY_RANGE)
+		return true;
+	const int Bit = (AY * m_VisibilityRegionsX + AX) * VISIBILITY_NEIGHBOURS + (DY + VISIBILITY_RANGE) * VISIBILITY_SPAN + DX + VISIBILITY_RANGE;
+	return m_vVisibility[Bit / 8] & (1 << (Bit % 8));
+}
+
 // TODO: OPT: rewrite this smarter!
 void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces, bool PhysicLayer) const
 {
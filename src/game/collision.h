@@ -3,16 +3,52 @@
 #ifndef GAME_COLLISION_H
 #define GAME_COLLISION_H
 
+#include <base/system.h>
 #include <base/vmath.h>
 
+#include <vector>
+
 class CCollision
 {
+	enum
+	{
+		QUAD_BIN_TILES = 4, // width and height of a quad bin in tiles
+		VISIBILITY_REGION_TILES = 4, // width and height of a visibility region in tiles
+		VISIBILITY_RANGE = 5, // regions up to this far away in each direction have a visibility bit
+		VISIBILITY_SPAN = 2 * VISIBILITY_RANGE + 1,
+		VISIBILITY_NEIGHBOURS = VISIBILITY_SPAN * VISIBILITY_SPAN,
+	};
+
+	// a physical quad that sets collision flags, with its corners and bounding box in world units
+	class CPhysicalQuad
+	{
+	public:
+		vec2 m_aCorners[4];
+		vec2 m_Min;
+		vec2 m_Max;
+		int m_Flags;
+	};
+
 	struct CTile *m_pTiles;
-	struct CQuad *m_pPhysicalQuads;
 	int m_Width;
 	int m_Height;
 	class CLayers *m_pLayers;
 
+	std::vector<CPhysicalQuad> m_vPhysicalQuads;
+	// quads overlapping each bin, the quads of bin i are m_vQuadBinQuads[m_vQuadBinStart[i]] up to m_vQuadBinStart[i + 1]
+	std::vector<int> m_vQuadBinStart;
+	std::vector<int> m_vQuadBinQuads;
+	int m_QuadBinsX;
+
+	// one bit for each region and each region around it, a cleared bit means every line between the two hits a solid tile
+	std::vector<unsigned char> m_vVisibility;
+	int m_VisibilityRegionsX;
+	int m_VisibilityRegionsY;
+
+	void InitPhysicalQuads(struct CQuad *pQuads, int NumQuads);
+	bool VisibilityRegion(vec2 Pos, int *pX, int *pY) const;
+	bool RegionsMaySee(int AX, int AY, int BX, int BY, std::vector<unsigned char> *pvVisited, std::vector<int> *pvStack) const;
+
 	bool IsTile(int x, int y, int Flag = COLFLAG_SOLID, bool PhysicLayer = true) const;
 	int GetTile(int x, int y, bool PhysicLayer = true) const;
 
@@ -27,15 +63,26 @@ public:
 
 	CCollision();
 	void Init(class CLayers *pLayers);
+	void Init(struct CTile *pTiles, int Width, int Height, struct CQuad *pPhysicalQuads, int NumPhysicalQuads);
 	bool CheckPoint(float x, float y, int Flag = COLFLAG_SOLID, bool PhysicLayer = true) const { return IsTile(round_to_int(x), round_to_int(y), Flag); }
 	bool CheckPoint(vec2 Pos, int Flag = COLFLAG_SOLID, bool PhysicLayer = true) const { return CheckPoint(Pos.x, Pos.y, Flag); }
 	int GetCollisionAt(float x, float y, bool PhysicLayer = true) const { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() const { return m_Width; }
 	int GetHeight() const { return m_Height; }
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, bool PhysicLayer = true) const;
+	// tests Num lines from pStarts to pEnds, pResults (and pOutCollisions if given) get what IntersectLine returns for each, returns the number of lines that hit
+	int IntersectLines(const vec2 *pStarts, const vec2 *pEnds, int Num, int *pResults, vec2 *pOutCollisions = nullptr, bool PhysicLayer = true) const;
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces, bool PhysicLayer = true) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath = 0, bool PhysicLayer = true) const;
 	bool TestBox(vec2 Pos, vec2 Size, int Flag = COLFLAG_SOLID, bool PhysicLayer = true) const;
+
+	// precomputed region to region visibility, it only depends on the solid tiles
+	void InitVisibility();
+	bool LoadVisibility(IOHANDLE File);
+	bool SaveVisibility(IOHANDLE File) const;
+	bool HasVisibility() const { return !m_vVisibility.empty(); }
+	// false if IntersectLine(Pos0, Pos1) is known to hit a solid tile, true if the line has to be tested
+	bool MaySee(vec2 Pos0, vec2 Pos1) const;
 };
 
 #endif
@@ -366,14 +366,29 @@ void CCharacterCore::Move(bool PhysicLayer)
 	if(!m_pWorld)
 		return;
 
+	CMoveIntent Intent;
+	PrepareMove(&Intent, PhysicLayer);
+	ApplyMove(&Intent);
+}
+
+void CCharacterCore::PrepareMove(CMoveIntent *pIntent, bool PhysicLayer) const
+{
 	float RampValue = VelocityRamp(length(m_Vel) * 50, m_pWorld->m_Tuning.m_VelrampStart, m_pWorld->m_Tuning.m_VelrampRange, m_pWorld->m_Tuning.m_VelrampCurvature);
 
-	m_Vel.x = m_Vel.x * RampValue;
+	pIntent->m_Vel = m_Vel;
+	pIntent->m_Vel.x = pIntent->m_Vel.x * RampValue;
 
-	vec2 NewPos = m_Pos;
-	m_pCollision->MoveBox(&NewPos, &m_Vel, vec2(PHYS_SIZE, PHYS_SIZE), 0, &m_Death, PhysicLayer);
+	pIntent->m_Pos = m_Pos;
+	m_pCollision->MoveBox(&pIntent->m_Pos, &pIntent->m_Vel, vec2(PHYS_SIZE, PHYS_SIZE), 0, &pIntent->m_Death, PhysicLayer);
 
-	m_Vel.x = m_Vel.x * (1.0f / RampValue);
+	pIntent->m_Vel.x = pIntent->m_Vel.x * (1.0f / RampValue);
+}
+
+void CCharacterCore::ApplyMove(const CMoveIntent *pIntent)
+{
+	m_Vel = pIntent->m_Vel;
+	m_Death = pIntent->m_Death;
+	vec2 NewPos = pIntent->m_Pos;
 
 	if(m_pWorld->m_Tuning.m_PlayerCollision)
 	{
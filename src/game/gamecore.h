@@ -155,6 +155,15 @@ class CCharacterCore
 	CCollision *m_pCollision;
 
 public:
+	// the part of a move that only depends on this core and the map
+	class CMoveIntent
+	{
+	public:
+		vec2 m_Pos;
+		vec2 m_Vel;
+		bool m_Death;
+	};
+
 	static const float PHYS_SIZE;
 	vec2 m_Pos;
 	vec2 m_Vel;
@@ -182,6 +191,9 @@ public:
 	void Reset();
 	void Tick(bool UseInput, bool PhysicLayer = true);
 	void Move(bool PhysicLayer = true);
+	// Move split in two, PrepareMove does not read other characters and can run on any thread
+	void PrepareMove(CMoveIntent *pIntent, bool PhysicLayer = true) const;
+	void ApplyMove(const CMoveIntent *pIntent);
 
 	void AddDragVelocity();
 	void ResetDragVelocity();
@@ -4,7 +4,9 @@
 #define GAME_SERVER_ALLOC_H
 
 #include <new>
+#include <vector>
 
+#include <base/math.h>
 #include <base/system.h>
 
 #define MACRO_ALLOC_HEAP() \
@@ -60,4 +62,84 @@ private:
 		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	}
 
+/*
+	Class: Slab Allocator
+		Hands out objects of one size from slabs that hold many
+		of them, so the objects of a type stay close together in
+		memory. Freed objects are reused before a new slab is
+		allocated, slabs are only released with the allocator.
+*/
+class CSlabAllocator
+{
+	class CFreeObject
+	{
+	public:
+		CFreeObject *m_pNext;
+	};
+
+	int m_ObjectSize;
+	int m_SlabObjects;
+	std::vector<char *> m_vpSlabs;
+	CFreeObject *m_pFirstFree;
+
+public:
+	CSlabAllocator(int ObjectSize, int SlabObjects) :
+		m_ObjectSize(maximum<int>(ObjectSize, sizeof(CFreeObject))), m_SlabObjects(SlabObjects), m_pFirstFree(0)
+	{
+	}
+
+	~CSlabAllocator()
+	{
+		for(char *pSlab : m_vpSlabs)
+			mem_free(pSlab);
+	}
+
+	void *Allocate()
+	{
+		if(!m_pFirstFree)
+		{
+			char *pSlab = (char *) mem_alloc(m_ObjectSize * m_SlabObjects);
+			m_vpSlabs.push_back(pSlab);
+			// chain the objects so they are handed out in address order
+			for(int i = m_SlabObjects - 1; i >= 0; i--)
+			{
+				CFreeObject *pObject = (CFreeObject *) (pSlab + i * m_ObjectSize);
+				pObject->m_pNext = m_pFirstFree;
+				m_pFirstFree = pObject;
+			}
+		}
+
+		CFreeObject *pObject = m_pFirstFree;
+		m_pFirstFree = pObject->m_pNext;
+		mem_zero(pObject, m_ObjectSize);
+		return pObject;
+	}
+
+	void Free(void *pPtr)
+	{
+		CFreeObject *pObject = (CFreeObject *) pPtr;
+		pObject->m_pNext = m_pFirstFree;
+		m_pFirstFree = pObject;
+	}
+};
+
+#define MACRO_ALLOC_SLAB() \
+public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *p); \
+\
+private:
+
+#define MACRO_ALLOC_SLAB_IMPL(POOLTYPE, SlabSize) \
+	static CSlabAllocator ms_Slab##POOLTYPE(sizeof(POOLTYPE), SlabSize); \
+	void *POOLTYPE::operator new(size_t Size) \
+	{ \
+		dbg_assert(sizeof(POOLTYPE) == Size, "size error"); \
+		return ms_Slab##POOLTYPE.Allocate(); \
+	} \
+	void POOLTYPE::operator delete(void *p) \
+	{ \
+		ms_Slab##POOLTYPE.Free(p); \
+	}
+
 #endif
@@ -49,7 +49,7 @@ CCharacter::CCharacter(CGameWorld *pWorld) :
 	m_Armor = 0;
 	m_TriggeredEvents = 0;
 
-	for(int i = 0; i < 2; i++)
+	for(int i = 0; i < NUM_LIGHT_BEAMS; i++)
 	{
 		m_aFlashlightIDs[i] = Server()->SnapNewID();
 	}
@@ -57,7 +57,7 @@ CCharacter::CCharacter(CGameWorld *pWorld) :
 
 CCharacter::~CCharacter()
 {
-	for(int i = 0; i < 2; i++)
+	for(int i = 0; i < NUM_LIGHT_BEAMS; i++)
 	{
 		Server()->SnapFreeID(m_aFlashlightIDs[i]);
 	}
@@ -78,7 +78,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_QueuedWeapon = -1;
 
 	m_pPlayer = pPlayer;
-	m_Pos = Pos;
+	CEntity::SetPos(Pos);
 
 	m_Core.Reset();
 	m_Core.Init(&GameWorld()->m_Core, GameServer()->Collision());
@@ -90,12 +90,16 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_ReckoningTick = 0;
 	mem_zero(&m_SendCore, sizeof(m_SendCore));
 	mem_zero(&m_ReckoningCore, sizeof(m_ReckoningCore));
+	m_PhysicsIntent.m_Valid = false;
 
 	GameWorld()->InsertEntity(this);
 	m_Alive = true;
 
 	m_IsFlashlightOpened = false;
 	m_IsVisible = true;
+	m_Light.m_Lighting = false;
+	m_Light.m_InLight = false;
+	m_Light.m_BeamsValid = false;
 
 	GameServer()->m_pController->OnCharacterSpawn(this);
 
@@ -327,7 +331,7 @@ void CCharacter::FireWeapon()
 			// the free ghosts can't be hit
 			if(pTarget->GetPlayer()->GetTeam() == TEAM_RED)
 			{
-				auto Find = std::find(m_vCaughtGhosts.begin(), m_vCaughtGhosts.end(), pTarget);
+				auto Find = std::find(m_vCaughtGhosts.begin(), m_vCaughtGhosts.end(), pTarget->GetHandle());
 				if(Find == m_vCaughtGhosts.end())
 					continue;
 				pTarget->AddEscapeProgress(-100);
@@ -594,6 +598,12 @@ void CCharacter::Tick()
 		SetEmote(EMOTE_NORMAL, -1);
 	}
 
+	RemoveGoneGhosts();
+
+	// the hunter left the world without letting go
+	if(m_IsCaught && !CharacterFromHandle(m_Hunter))
+		BeCaught(nullptr, false);
+
 	if(m_IsCaught)
 	{
 		m_IsVisible = true;
@@ -604,10 +614,11 @@ void CCharacter::Tick()
 
 			if(GetEscapeProgress() >= 300)
 			{
-				m_pHunter->OnCharacterDeadOrEscaped(this);
+				CCharacter *pHunter = CharacterFromHandle(m_Hunter);
+				pHunter->OnCharacterDeadOrEscaped(this);
 				GameServer()->CreateSound(m_Pos, SOUND_CTF_GRAB_EN);
 				if(GameServer()->Collision()->TestBox(m_Pos, vec2(GetProximityRadius(), GetProximityRadius())))
-					SetPos(m_pHunter->GetPos());
+					SetPos(pHunter->GetPos());
 				BeCaught(nullptr, false);
 			}
 			else if(GetEscapeProgress() > 200 && GetEscapeProgress() % 15 == 0)
@@ -621,11 +632,10 @@ void CCharacter::Tick()
 	}
 	else if(m_pPlayer->GetTeam() == TEAM_RED)
 	{
-		bool Visible = false;
+		// the lights were tested against this ghost at the end of the last tick
+		bool Visible = m_Light.m_InLight;
 		CCharacter *apEnts[MAX_PLAYERS];
-		float LightLength = 512.0f;
-		float Spreading = 0.355f;
-		int Num = GameWorld()->FindEntities(m_Pos, LightLength, (CEntity **) apEnts,
+		int Num = GameWorld()->FindEntities(m_Pos, ms_LightLength, (CEntity **) apEnts,
 			MAX_PLAYERS, CGameWorld::ENTTYPE_CHARACTER);
 
 		for(int i = 0; i < Num; ++i)
@@ -636,15 +646,10 @@ void CCharacter::Tick()
 
 			vec2 Direction = pChr->GetDirection();
 			vec2 TargetDirection = normalize(m_Pos - pChr->GetPos());
-			if(acosf(dot(TargetDirection, Direction)) > Spreading)
+			if(acosf(dot(TargetDirection, Direction)) > ms_LightSpreading)
 				continue;
 
 			vec2 StartPos = pChr->GetPos() + Direction * GetProximityRadius() * 0.75f;
-			if(!Visible && pChr->IsLighting())
-			{
-				if(!GameServer()->Collision()->IntersectLine(StartPos, m_Pos, nullptr, nullptr))
-					Visible = true;
-			}
 			if(pChr->IsGhostCleanerUsing() && !pChr->IsSurpriseFrozen())
 			{
 				pChr->SetEmote(EMOTE_HAPPY, Server()->Tick() + 1);
@@ -746,9 +751,11 @@ void CCharacter::Tick()
 				char aMsg[64];
 				str_format(aMsg, sizeof(aMsg), "'%s' has left with %s", Server()->ClientName(m_pPlayer->GetCID()), aWithMsg);
 				GameServer()->SendChat(-1, CHAT_ALL, -1, aMsg);
-				for(auto &pGhost : m_vCaughtGhosts)
+				for(auto &Ghost : m_vCaughtGhosts)
 				{
-					pGhost->Die(m_pPlayer->GetCID(), WEAPON_GRENADE);
+					CCharacter *pGhost = CharacterFromHandle(Ghost);
+					if(pGhost)
+						pGhost->Die(m_pPlayer->GetCID(), WEAPON_GRENADE);
 				}
 				m_vCaughtGhosts.clear();
 				GameServer()->m_pController->DoTeamChange(m_pPlayer, TEAM_RED, false);
@@ -761,8 +768,9 @@ void CCharacter::Tick()
 			}
 		}
 
-		for(auto &pGhost : m_vCaughtGhosts)
+		for(auto &Ghost : m_vCaughtGhosts)
 		{
+			CCharacter *pGhost = CharacterFromHandle(Ghost);
 			if(!pGhost)
 				continue;
 			pGhost->SetVel(m_Core.m_Vel);
@@ -786,17 +794,38 @@ void CCharacter::Tick()
 	HandleWeapons();
 }
 
+void CCharacter::AdvanceReckoningCore(CCharacterCore *pCore)
+{
+	CWorldCore TempWorld;
+	pCore->Init(&TempWorld, GameServer()->Collision());
+	pCore->Tick(false, false);
+	pCore->Move(false);
+	pCore->Quantize();
+}
+
+void CCharacter::PreparePhysics()
+{
+	// nothing but TickDefered changes the dead reckoning core
+	m_PhysicsIntent.m_ReckoningCore = m_ReckoningCore;
+	AdvanceReckoningCore(&m_PhysicsIntent.m_ReckoningCore);
+
+	CCharacterCore Core = m_Core;
+	if(UseDragVelocity())
+		Core.AddDragVelocity();
+	m_PhysicsIntent.m_MoveFromPos = Core.m_Pos;
+	m_PhysicsIntent.m_MoveFromVel = Core.m_Vel;
+	Core.PrepareMove(&m_PhysicsIntent.m_Move);
+	m_PhysicsIntent.m_Valid = true;
+}
+
 void CCharacter::TickDefered()
 {
 	static const vec2 ColBox(CCharacterCore::PHYS_SIZE, CCharacterCore::PHYS_SIZE);
 	// advance the dummy
-	{
-		CWorldCore TempWorld;
-		m_ReckoningCore.Init(&TempWorld, GameServer()->Collision());
-		m_ReckoningCore.Tick(false, false);
-		m_ReckoningCore.Move(false);
-		m_ReckoningCore.Quantize();
-	}
+	if(m_PhysicsIntent.m_Valid)
+		m_ReckoningCore = m_PhysicsIntent.m_ReckoningCore;
+	else
+		AdvanceReckoningCore(&m_ReckoningCore);
 
 	if(m_IsCaught)
 	{
@@ -809,7 +838,7 @@ void CCharacter::TickDefered()
 
 	// apply drag velocity when the player is not firing ninja
 	// and set it back to 0 for the next tick
-	if(m_ActiveWeapon != WEAPON_NINJA || m_Ninja.m_CurrentMoveTime < 0)
+	if(UseDragVelocity())
 		m_Core.AddDragVelocity();
 	m_Core.ResetDragVelocity();
 
@@ -818,12 +847,18 @@ void CCharacter::TickDefered()
 	vec2 StartVel = m_Core.m_Vel;
 	bool StuckBefore = GameServer()->Collision()->TestBox(m_Core.m_Pos, ColBox);
 
-	m_Core.Move();
+	// the prepared move only holds if nothing moved the character since, compare bitwise
+	if(m_PhysicsIntent.m_Valid && mem_comp(&m_PhysicsIntent.m_MoveFromPos, &StartPos, sizeof(StartPos)) == 0 &&
+		mem_comp(&m_PhysicsIntent.m_MoveFromVel, &StartVel, sizeof(StartVel)) == 0)
+		m_Core.ApplyMove(&m_PhysicsIntent.m_Move);
+	else
+		m_Core.Move();
+	m_PhysicsIntent.m_Valid = false;
 
 	bool StuckAfterMove = GameServer()->Collision()->TestBox(m_Core.m_Pos, ColBox);
 	m_Core.Quantize();
 	bool StuckAfterQuant = GameServer()->Collision()->TestBox(m_Core.m_Pos, ColBox);
-	m_Pos = m_Core.m_Pos;
+	CEntity::SetPos(m_Core.m_Pos);
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -854,10 +889,7 @@ void CCharacter::TickDefered()
 	m_TriggeredEvents |= m_Core.m_TriggeredEvents;
 
 	if(m_pPlayer->GetTeam() == TEAM_SPECTATORS)
-	{
-		m_Pos.x = m_Input.m_TargetX;
-		m_Pos.y = m_Input.m_TargetY;
-	}
+		SetPos(vec2(m_Input.m_TargetX, m_Input.m_TargetY));
 	else if(m_Core.m_Death)
 	{
 		// handle death-tiles
@@ -962,8 +994,9 @@ void CCharacter::Die(int Killer, int Weapon)
 	// this is for auto respawn after 3 secs
 	m_pPlayer->m_DieTick = Server()->Tick();
 
-	for(auto &pGhost : m_vCaughtGhosts)
+	for(auto &Ghost : m_vCaughtGhosts)
 	{
+		CCharacter *pGhost = CharacterFromHandle(Ghost);
 		if(!pGhost)
 			continue;
 		pGhost->BeCaught(nullptr, false);
@@ -1080,31 +1113,47 @@ bool CCharacter::TakeDamage(vec2 Force, vec2 Source, int Dmg, int From, int Weap
 
 void CCharacter::Snap(int SnappingClient)
 {
+	// only the character item with health, armor and ammo differs between clients,
+	// everything else is in the snap layer
+	if(!GameServer()->m_SnapLayer.IsPersonal(m_pPlayer->GetCID(), SnappingClient))
+		return;
+
 	if(SnappingClient != -1 && !m_IsVisible)
 	{
 		if(GameServer()->m_apPlayers[SnappingClient]->GetTeam() != m_pPlayer->GetTeam() && GameServer()->m_apPlayers[SnappingClient]->GetTeam() != TEAM_SPECTATORS)
 			return;
 	}
 
-	SnapCharacter(SnappingClient);
+	if(NetworkClippedLine(SnappingClient, m_Pos, m_Core.m_HookPos))
+		return;
 
-	if(IsLighting())
-	{
-		float LightLength = 512.0f;
-		float Spreading[] = {-0.355f, 0.355f};
-		vec2 Direction = normalize(vec2(m_LatestInput.m_TargetX, m_LatestInput.m_TargetY));
-		vec2 StartPos = m_Pos + Direction * GetProximityRadius() * 0.75f;
+	CNetObj_Character *pCharacter = static_cast<CNetObj_Character *>(Server()->SnapNewItem(NETOBJTYPE_CHARACTER, m_pPlayer->GetCID(), sizeof(CNetObj_Character)));
+	if(!pCharacter)
+		return;
 
-		for(int i = 0; i < 2; i++)
-		{
-			vec2 LightDir = direction(angle(Direction) + Spreading[i]);
-			vec2 EndPos = StartPos + LightDir * LightLength;
-			GameServer()->Collision()->IntersectLine(StartPos, EndPos, nullptr, &EndPos);
+	SnapCharacter(pCharacter, true);
+}
 
-			if(NetworkClippedLine(SnappingClient, StartPos, EndPos))
-				continue;
+void CCharacter::SnapCommon()
+{
+	// invisible ghosts are only sent to their own team and spectators
+	const int Team = m_IsVisible ? (int) CSnapLayer::TEAM_ALL : m_pPlayer->GetTeam();
+	CSnapLayer *pLayer = &GameServer()->m_SnapLayer;
+
+	CNetObj_Character *pCharacter = static_cast<CNetObj_Character *>(pLayer->NewItem(NETOBJTYPE_CHARACTER, m_pPlayer->GetCID(), sizeof(CNetObj_Character),
+		m_Pos, m_Core.m_HookPos, Team, m_pPlayer->GetCID()));
+	if(pCharacter)
+		SnapCharacter(pCharacter, false);
 
-			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_aFlashlightIDs[i], sizeof(CNetObj_Laser)));
+	if(m_Light.m_Lighting)
+	{
+		UpdateBeams();
+		for(int i = 0; i < NUM_LIGHT_BEAMS; i++)
+		{
+			vec2 StartPos = m_Light.m_StartPos;
+			vec2 EndPos = m_Light.m_aBeamEnds[i];
+
+			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(pLayer->NewItem(NETOBJTYPE_LASER, m_aFlashlightIDs[i], sizeof(CNetObj_Laser), StartPos, EndPos, Team));
 			if(!pObj)
 				return;
 
@@ -1112,13 +1161,13 @@ void CCharacter::Snap(int SnappingClient)
 			pObj->m_Y = round_to_int(StartPos.y);
 			pObj->m_FromX = round_to_int(EndPos.x);
 			pObj->m_FromY = round_to_int(EndPos.y);
-			pObj->m_StartTick = Server()->Tick() - (int) ((distance(StartPos, EndPos) / LightLength) * 4);
+			pObj->m_StartTick = Server()->Tick() - (int) ((distance(StartPos, EndPos) / ms_LightLength) * 4);
 		}
 	}
 
 	if(m_HasGhostCleaner)
 	{
-		CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup)));
+		CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(pLayer->NewItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup), Team));
 		if(!pObj)
 			return;
 
@@ -1133,15 +1182,8 @@ void CCharacter::PostSnap()
 	m_TriggeredEvents = 0;
 }
 
-void CCharacter::SnapCharacter(int SnappingClient)
+void CCharacter::SnapCharacter(CNetObj_Character *pCharacter, bool Personal)
 {
-	if(NetworkClippedLine(SnappingClient, m_Pos, m_Core.m_HookPos))
-		return;
-
-	CNetObj_Character *pCharacter = static_cast<CNetObj_Character *>(Server()->SnapNewItem(NETOBJTYPE_CHARACTER, m_pPlayer->GetCID(), sizeof(CNetObj_Character)));
-	if(!pCharacter)
-		return;
-
 	// write down the m_Core
 	if(!m_ReckoningTick || GameWorld()->m_Paused)
 	{
@@ -1168,8 +1210,7 @@ void CCharacter::SnapCharacter(int SnappingClient)
 
 	pCharacter->m_Direction = m_Input.m_Direction;
 
-	if(m_pPlayer->GetCID() == SnappingClient || SnappingClient == -1 ||
-		(!Config()->m_SvStrictSpectateMode && m_pPlayer->GetCID() == GameServer()->m_apPlayers[SnappingClient]->GetSpectatorID()))
+	if(Personal)
 	{
 		pCharacter->m_Health = m_IsCaught ? clamp(m_EscapeProgress / 15, 0, 10) : m_Health;
 		pCharacter->m_Armor = m_IsCaught ? clamp(m_EscapeProgress / 15 - 10, 0, 10) : m_Armor;
@@ -1207,6 +1248,70 @@ bool CCharacter::IsLighting()
 	       (m_ActiveWeapon == WEAPON_GRENADE && m_HasGhostCleaner && m_GhostCleanerPower);
 }
 
+void CCharacter::UpdateLight()
+{
+	m_Light.m_InLight = false;
+	m_Light.m_Lighting = IsLighting();
+	if(!m_Light.m_Lighting)
+		return;
+
+	m_Light.m_Direction = GetDirection();
+	m_Light.m_StartPos = m_Pos + m_Light.m_Direction * GetProximityRadius() * 0.75f;
+}
+
+void CCharacter::RevealGhosts()
+{
+	if(!m_Light.m_Lighting || m_pPlayer->GetTeam() != TEAM_BLUE)
+		return;
+
+	CCharacter *apEnts[MAX_PLAYERS];
+	int Num = GameWorld()->FindEntities(m_Pos, ms_LightLength, (CEntity **) apEnts,
+		MAX_PLAYERS, CGameWorld::ENTTYPE_CHARACTER);
+	for(int i = 0; i < Num; ++i)
+	{
+		CCharacter *pGhost = apEnts[i];
+		if(pGhost->GetPlayer()->GetTeam() != TEAM_RED)
+			continue;
+
+		vec2 TargetDirection = normalize(pGhost->m_Pos - m_Pos);
+		if(acosf(dot(TargetDirection, m_Light.m_Direction)) > ms_LightSpreading)
+			continue;
+
+		// another light already reached this ghost, or the map has a wall between them for sure
+		if(pGhost->m_Light.m_InLight || !GameServer()->Collision()->MaySee(m_Light.m_StartPos, pGhost->m_Pos))
+		{
+			GameWorld()->m_NumLightRaycastsSaved++;
+			continue;
+		}
+
+		GameWorld()->m_NumLightRaycasts++;
+		if(!GameServer()->Collision()->IntersectLine(m_Light.m_StartPos, pGhost->m_Pos, nullptr, nullptr))
+			pGhost->m_Light.m_InLight = true;
+	}
+}
+
+void CCharacter::UpdateBeams()
+{
+	// the map does not change, so the beams hold as long as the light does not move
+	if(m_Light.m_BeamsValid && m_Light.m_BeamStartPos == m_Light.m_StartPos && m_Light.m_BeamDirection == m_Light.m_Direction)
+	{
+		GameWorld()->m_NumLightRaycastsSaved += NUM_LIGHT_BEAMS;
+		return;
+	}
+
+	const float aSpreading[NUM_LIGHT_BEAMS] = {-ms_LightSpreading, ms_LightSpreading};
+	for(int i = 0; i < NUM_LIGHT_BEAMS; i++)
+	{
+		vec2 LightDir = direction(angle(m_Light.m_Direction) + aSpreading[i]);
+		m_Light.m_aBeamEnds[i] = m_Light.m_StartPos + LightDir * ms_LightLength;
+		GameServer()->Collision()->IntersectLine(m_Light.m_StartPos, m_Light.m_aBeamEnds[i], nullptr, &m_Light.m_aBeamEnds[i]);
+	}
+	GameWorld()->m_NumLightRaycasts += NUM_LIGHT_BEAMS;
+	m_Light.m_BeamsValid = true;
+	m_Light.m_BeamStartPos = m_Light.m_StartPos;
+	m_Light.m_BeamDirection = m_Light.m_Direction;
+}
+
 void CCharacter::AddEscapeProgress(int Progress)
 {
 	if(Progress < 0 && absolute(Progress) >= m_EscapeProgress && m_EscapeProgress > 50)
@@ -1220,13 +1325,13 @@ void CCharacter::AddEscapeProgress(int Progress)
 
 void CCharacter::CatchGhost(CCharacter *pGhost)
 {
-	for(auto &pCaughtGhost : m_vCaughtGhosts)
+	for(auto &CaughtGhost : m_vCaughtGhosts)
 	{
-		if(pCaughtGhost == pGhost)
+		if(CaughtGhost == pGhost->GetHandle())
 			return;
 	}
 
-	m_vCaughtGhosts.push_back(pGhost);
+	m_vCaughtGhosts.push_back(pGhost->GetHandle());
 }
 
 void CCharacter::BeDraging(vec2 From)
@@ -1237,7 +1342,7 @@ void CCharacter::BeDraging(vec2 From)
 
 void CCharacter::BeCaught(CCharacter *pHunter, bool Catch)
 {
-	m_pHunter = pHunter;
+	m_Hunter = pHunter ? pHunter->GetHandle() : CEntityHandle();
 	m_IsCaught = Catch;
 	m_EscapeProgress = 0;
 
@@ -1260,7 +1365,7 @@ void CCharacter::SetGhostCleaner(bool Give)
 void CCharacter::SetPos(vec2 Pos)
 {
 	m_Core.m_Pos = Pos;
-	m_Pos = Pos;
+	CEntity::SetPos(Pos);
 }
 
 void CCharacter::SetVel(vec2 Vel)
@@ -1273,12 +1378,18 @@ void CCharacter::ClearCaughtList()
 	m_vCaughtGhosts.clear();
 }
 
+void CCharacter::RemoveGoneGhosts()
+{
+	auto IsGone = [this](CEntityHandle Ghost) { return !CharacterFromHandle(Ghost); };
+	m_vCaughtGhosts.erase(std::remove_if(m_vCaughtGhosts.begin(), m_vCaughtGhosts.end(), IsGone), m_vCaughtGhosts.end());
+}
+
 void CCharacter::OnCharacterDeadOrEscaped(CCharacter *pChr)
 {
-	if(m_pHunter == pChr)
+	if(m_Hunter == pChr->GetHandle())
 		BeCaught(nullptr, false);
 
-	auto Find = std::find(m_vCaughtGhosts.begin(), m_vCaughtGhosts.end(), pChr);
+	auto Find = std::find(m_vCaughtGhosts.begin(), m_vCaughtGhosts.end(), pChr->GetHandle());
 	if(Find == m_vCaughtGhosts.end())
 		return;
 	m_vCaughtGhosts.erase(Find);
@@ -1289,5 +1400,6 @@ void CCharacter::OnKilledByGhost(CPlayer *pGhost)
 	if(!pGhost)
 		return;
 
+	RemoveGoneGhosts();
 	pGhost->m_Score += m_vCaughtGhosts.size() * 3; // rescue a ghost score +3
 }
\ No newline at end of file
@@ -21,8 +21,13 @@ public:
 	enum
 	{
 		MIN_KILLMESSAGE_CLIENTVERSION = 0x0704, // todo 0.8: remove me
+		NUM_LIGHT_BEAMS = 2,
 	};
 
+	// reach and half opening angle of flashlights
+	static constexpr float ms_LightLength = 512.0f;
+	static constexpr float ms_LightSpreading = 0.355f;
+
 	CCharacter(CGameWorld *pWorld);
 	~CCharacter();
 
@@ -31,7 +36,10 @@ public:
 	void Tick() override;
 	void TickDefered() override;
 	void TickPaused() override;
+	// the physics of TickDefered that only read this character and the map, may run on a worker
+	void PreparePhysics();
 	void Snap(int SnappingClient) override;
+	void SnapCommon() override;
 	void PostSnap() override;
 
 	bool IsGrounded();
@@ -66,7 +74,7 @@ public:
 	class CPlayer *GetPlayer() { return m_pPlayer; }
 
 private:
-	void SnapCharacter(int SnappingClient);
+	void SnapCharacter(CNetObj_Character *pCharacter, bool Personal);
 	// player controlling this character
 	class CPlayer *m_pPlayer;
 
@@ -129,6 +137,19 @@ private:
 	CCharacterCore m_SendCore; // core that we should send
 	CCharacterCore m_ReckoningCore; // the dead reckoning core
 
+	// result of PreparePhysics, used by TickDefered if the core still starts from the same state
+	struct CPhysicsIntent
+	{
+		bool m_Valid;
+		CCharacterCore m_ReckoningCore;
+		vec2 m_MoveFromPos;
+		vec2 m_MoveFromVel;
+		CCharacterCore::CMoveIntent m_Move;
+	} m_PhysicsIntent;
+
+	bool UseDragVelocity() const { return m_ActiveWeapon != WEAPON_NINJA || m_Ninja.m_CurrentMoveTime < 0; }
+	void AdvanceReckoningCore(CCharacterCore *pCore);
+
 	// Human
 	bool m_HasFlashlight;
 	bool m_HasGhostCleaner;
@@ -144,18 +165,39 @@ private:
 	int m_GhostCleanerPower;
 
 	// Human
-	int m_aFlashlightIDs[2];
+	int m_aFlashlightIDs[NUM_LIGHT_BEAMS];
 	int m_SurpriseFrozenTick;
 
 	// Ghost
 	int m_LastVisibleTick;
 
+	// light geometry of the last world tick, read by ghost visibility and snapping
+	struct CLightState
+	{
+		bool m_Lighting;
+		vec2 m_Direction;
+		vec2 m_StartPos;
+		bool m_InLight; // ghost reached by a light
+
+		// beam ends and the light position they were cast from
+		bool m_BeamsValid;
+		vec2 m_BeamDirection;
+		vec2 m_BeamStartPos;
+		vec2 m_aBeamEnds[NUM_LIGHT_BEAMS];
+	} m_Light;
+
+	void UpdateBeams();
+
 	// Ghost
 	int m_EscapeProgress;
 	int m_EscapingFrozenTick;
 
-	CCharacter *m_pHunter;
-	std::vector<CCharacter *> m_vCaughtGhosts;
+	CEntityHandle m_Hunter;
+	std::vector<CEntityHandle> m_vCaughtGhosts;
+
+	CCharacter *CharacterFromHandle(CEntityHandle Handle) { return (CCharacter *) GameWorld()->GetEntity(Handle); }
+	// forgets the caught ghosts that left the world
+	void RemoveGoneGhosts();
 
 public:
 	inline bool HasFlashlight() { return m_HasFlashlight; }
@@ -180,6 +222,10 @@ public:
 	bool IsEscapingFrozen();
 	bool IsLighting();
 
+	// called by the world once per tick, after all characters moved
+	void UpdateLight();
+	void RevealGhosts();
+
 	void AddEscapeProgress(int Progress);
 	void CatchGhost(CCharacter *pGhost);
 	void BeDraging(vec2 From);
@@ -7,13 +7,15 @@
 
 class CLaser : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEnergy, int Owner);
 
 	void Reset() override;
 	void Tick() override;
 	void TickPaused() override;
-	void Snap(int SnappingClient) override;
+	void SnapCommon() override;
 
 protected:
 	bool HitCharacter(vec2 From, vec2 To);
@@ -7,6 +7,8 @@
 #include "character.h"
 #include "pickup.h"
 
+MACRO_ALLOC_SLAB_IMPL(CPickup, 64)
+
 CPickup::CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos) :
 	CEntity(pGameWorld, CGameWorld::ENTTYPE_PICKUP, Pos, PickupPhysSize)
 {
@@ -134,12 +136,12 @@ void CPickup::TickPaused()
 		++m_SpawnTick;
 }
 
-void CPickup::Snap(int SnappingClient)
+void CPickup::SnapCommon()
 {
-	if(m_SpawnTick != -1 || NetworkClipped(SnappingClient))
+	if(m_SpawnTick != -1)
 		return;
 
-	CNetObj_Pickup *pP = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup)));
+	CNetObj_Pickup *pP = static_cast<CNetObj_Pickup *>(GameServer()->m_SnapLayer.NewItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup), m_Pos));
 	if(!pP)
 		return;
 
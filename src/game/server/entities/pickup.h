@@ -9,13 +9,15 @@ const int PickupPhysSize = 14;
 
 class CPickup : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos);
 
 	void Reset() override;
 	void Tick() override;
 	void TickPaused() override;
-	void Snap(int SnappingClient) override;
+	void SnapCommon() override;
 
 private:
 	int m_Type;
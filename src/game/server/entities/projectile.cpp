@@ -6,6 +6,8 @@
 #include "character.h"
 #include "projectile.h"
 
+MACRO_ALLOC_SLAB_IMPL(CProjectile, 128)
+
 CProjectile::CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 	int Damage, bool Explosive, float Force, int SoundImpact, int Weapon) :
 	CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE, vec2(round_to_int(Pos.x), round_to_int(Pos.y)))
@@ -107,14 +109,11 @@ void CProjectile::FillInfo(CNetObj_Projectile *pProj)
 	pProj->m_Type = m_Type;
 }
 
-void CProjectile::Snap(int SnappingClient)
+void CProjectile::SnapCommon()
 {
 	float Ct = (Server()->Tick() - m_StartTick) / (float) Server()->TickSpeed();
 
-	if(NetworkClipped(SnappingClient, GetPos(Ct)))
-		return;
-
-	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, GetID(), sizeof(CNetObj_Projectile)));
+	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(GameServer()->m_SnapLayer.NewItem(NETOBJTYPE_PROJECTILE, GetID(), sizeof(CNetObj_Projectile), GetPos(Ct)));
 	if(pProj)
 		FillInfo(pProj);
 }
@@ -13,6 +13,8 @@ enum
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon);
@@ -26,7 +28,7 @@ public:
 	void Reset() override;
 	void Tick() override;
 	void TickPaused() override;
-	void Snap(int SnappingClient) override;
+	void SnapCommon() override;
 
 private:
 	vec2 m_Direction;
@@ -11,6 +11,8 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 
 	m_pPrevTypeEntity = 0;
 	m_pNextTypeEntity = 0;
+	m_GridNode.m_pUser = this;
+	m_InsertOrder = 0;
 
 	m_ID = Server()->SnapNewID();
 	m_ObjType = ObjType;
@@ -27,6 +29,12 @@ CEntity::~CEntity()
 	Server()->SnapFreeID(m_ID);
 }
 
+void CEntity::SetPos(vec2 Pos)
+{
+	m_Pos = Pos;
+	GameWorld()->UpdateEntityCell(this);
+}
+
 int CEntity::NetworkClipped(int SnappingClient)
 {
 	return NetworkClipped(SnappingClient, m_Pos);
@@ -37,15 +45,7 @@ int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos)
 	if(SnappingClient == -1)
 		return 0;
 
-	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x - CheckPos.x;
-	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y - CheckPos.y;
-
-	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
-
-	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
-		return 1;
-	return 0;
+	return ViewClipped(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos);
 }
 
 int CEntity::NetworkClippedLine(int SnappingClient, vec2 Start, vec2 End)
@@ -53,16 +53,21 @@ int CEntity::NetworkClippedLine(int SnappingClient, vec2 Start, vec2 End)
 	if(SnappingClient == -1)
 		return 0;
 
-	vec2 CheckPos = closest_point_on_line(Start, End, GameServer()->m_apPlayers[SnappingClient]->m_ViewPos);
-	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x - CheckPos.x;
-	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y - CheckPos.y;
+	vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+	return ViewClipped(ViewPos, closest_point_on_line(Start, End, ViewPos));
+}
+
+bool CEntity::ViewClipped(vec2 ViewPos, vec2 CheckPos)
+{
+	float dx = ViewPos.x - CheckPos.x;
+	float dy = ViewPos.y - CheckPos.y;
 
 	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
+		return true;
 
-	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
-		return 1;
-	return 0;
+	if(distance(ViewPos, CheckPos) > 1100.0f)
+		return true;
+	return false;
 }
 
 bool CEntity::GameLayerClipped(vec2 CheckPos)
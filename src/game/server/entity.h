@@ -5,6 +5,8 @@
 
 #include <base/vmath.h>
 
+#include <game/spatialgrid.h>
+
 #include "alloc.h"
 #include "gameworld.h"
 
@@ -25,6 +27,9 @@ private:
 
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
+	CSpatialGrid::CNode m_GridNode;
+	int64_t m_InsertOrder;
+	CEntityHandle m_Handle;
 
 	int m_ID;
 	int m_ObjType;
@@ -43,10 +48,17 @@ protected:
 
 	/*
 		Variable: m_Pos
-			Contains the current posititon of the entity.
+			Contains the current posititon of the entity. Use SetPos
+			to change it, so the world can keep track of it.
 	*/
 	vec2 m_Pos;
 
+	/*
+		Function: SetPos
+			Moves the entity and updates its cell in the world grid.
+	*/
+	void SetPos(vec2 Pos);
+
 	/* Getters */
 	int GetID() const { return m_ID; }
 
@@ -67,6 +79,8 @@ public:
 	CEntity *TypeNext() { return m_pNextTypeEntity; }
 	CEntity *TypePrev() { return m_pPrevTypeEntity; }
 	const vec2 &GetPos() const { return m_Pos; }
+	// null while the entity is not in the world
+	CEntityHandle GetHandle() const { return m_Handle; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
 	bool IsMarkedForDestroy() const { return m_MarkedForDestroy; }
 
@@ -120,6 +134,15 @@ public:
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapCommon
+			Called once per snapshot to add the items that are the
+			same for every client to the snap layer of the game
+			context. Snap() is still called for each client to add
+			the items that differ between clients.
+	*/
+	virtual void SnapCommon() {}
+
 	virtual void PostSnap() {}
 
 	/*
@@ -140,6 +163,13 @@ public:
 	int NetworkClipped(int SnappingClient, vec2 CheckPos);
 	int NetworkClippedLine(int SnappingClient, vec2 Start, vec2 End);
 
+	/*
+		Function: ViewClipped
+			Tests whether a position is outside of the area a client
+			with the given view position can see.
+	*/
+	static bool ViewClipped(vec2 ViewPos, vec2 CheckPos);
+
 	bool GameLayerClipped(vec2 CheckPos);
 };
 
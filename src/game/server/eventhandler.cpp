@@ -5,12 +5,16 @@
 #include "gamecontext.h"
 #include "player.h"
 
+#include <algorithm>
+
 //////////////////////////////////////////////////
 // Event handler
 //////////////////////////////////////////////////
 CEventHandler::CEventHandler()
 {
 	m_pGameServer = 0;
+	m_NumDropped = 0;
+	m_LastDropReport = -1;
 	Clear();
 }
 
@@ -19,18 +23,32 @@ void CEventHandler::SetGameServer(CGameContext *pGameServer)
 	m_pGameServer = pGameServer;
 }
 
+int CEventHandler::UnwrappedCellCoord(float Value)
+{
+	// clamp before converting, positions can be anything
+	const float Limit = (float) CELL_SIZE * 0x100000;
+	if(!(Value > -Limit))
+		Value = -Limit;
+	else if(Value > Limit)
+		Value = Limit;
+	return (int) floorf(Value / CELL_SIZE);
+}
+
 void *CEventHandler::Create(int Type, int Size, int64_t Mask)
 {
-	if(m_NumEvents == MAX_EVENTS)
-		return 0;
-	if(m_CurrentOffset + Size >= MAX_DATASIZE)
+	if(m_NumEvents == MAX_EVENTS || m_CurrentOffset + Size >= MAX_DATASIZE)
+	{
+		m_NumDropped++;
 		return 0;
+	}
+
+	CEvent *pEvent = &m_aEvents[m_NumEvents];
+	pEvent->m_Type = Type;
+	pEvent->m_Size = Size;
+	pEvent->m_Offset = m_CurrentOffset;
+	pEvent->m_ClientMask = Mask;
 
 	void *p = &m_aData[m_CurrentOffset];
-	m_aOffsets[m_NumEvents] = m_CurrentOffset;
-	m_aTypes[m_NumEvents] = Type;
-	m_aSizes[m_NumEvents] = Size;
-	m_aClientMasks[m_NumEvents] = Mask;
 	m_CurrentOffset += Size;
 	m_NumEvents++;
 	return p;
@@ -40,21 +58,77 @@ void CEventHandler::Clear()
 {
 	m_NumEvents = 0;
 	m_CurrentOffset = 0;
+	mem_zero(m_aNumClientEvents, sizeof(m_aNumClientEvents));
 }
 
-void CEventHandler::Snap(int SnappingClient)
+void CEventHandler::SnapCommon()
 {
-	for(int i = 0; i < m_NumEvents; i++)
+	// report dropped events at most once a second
+	const int Tick = GameServer()->Server()->Tick();
+	if(m_NumDropped && (m_LastDropReport == -1 || Tick >= m_LastDropReport + GameServer()->Server()->TickSpeed()))
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "dropped %d events, there is room for %d per snapshot", m_NumDropped, (int) MAX_EVENTS);
+		GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+		m_NumDropped = 0;
+		m_LastDropReport = Tick;
+	}
+
+	// bucket the events by position, pushing to the front in reverse keeps every bucket in creation order
+	for(int i = 0; i < NUM_CELLS; i++)
+		m_aCellEvents[i] = -1;
+	for(int i = m_NumEvents - 1; i >= 0; i--)
 	{
-		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
-		{
-			CNetEvent_Common *ev = (CNetEvent_Common *) &m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
+		const CNetEvent_Common *pEvent = (CNetEvent_Common *) &m_aData[m_aEvents[i].m_Offset];
+		const int Cell = (UnwrappedCellCoord(pEvent->m_Y) & (GRID_SIZE - 1)) * GRID_SIZE + (UnwrappedCellCoord(pEvent->m_X) & (GRID_SIZE - 1));
+		m_aEvents[i].m_NextInCell = m_aCellEvents[Cell];
+		m_aCellEvents[Cell] = i;
+	}
+
+	// every client only looks at the buckets around its view
+	const float Range = 1500.0f;
+	for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+	{
+		m_aNumClientEvents[ClientID] = 0;
+		const CPlayer *pPlayer = GameServer()->m_apPlayers[ClientID];
+		if(!pPlayer || !m_NumEvents)
+			continue;
+
+		const vec2 ViewPos = pPlayer->m_ViewPos;
+		const int X0 = UnwrappedCellCoord(ViewPos.x - Range);
+		const int Y0 = UnwrappedCellCoord(ViewPos.y - Range);
+		const int X1 = minimum(UnwrappedCellCoord(ViewPos.x + Range), X0 + GRID_SIZE - 1);
+		const int Y1 = minimum(UnwrappedCellCoord(ViewPos.y + Range), Y0 + GRID_SIZE - 1);
+		unsigned char *pClientEvents = m_aaClientEvents[ClientID];
+		int NumClientEvents = 0;
+		for(int y = Y0; y <= Y1; y++)
+			for(int x = X0; x <= X1; x++)
 			{
-				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
-				if(d)
-					mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
+				for(int i = m_aCellEvents[(y & (GRID_SIZE - 1)) * GRID_SIZE + (x & (GRID_SIZE - 1))]; i != -1; i = m_aEvents[i].m_NextInCell)
+				{
+					if(!CmaskIsSet(m_aEvents[i].m_ClientMask, ClientID))
+						continue;
+					const CNetEvent_Common *pEvent = (CNetEvent_Common *) &m_aData[m_aEvents[i].m_Offset];
+					if(distance(ViewPos, vec2(pEvent->m_X, pEvent->m_Y)) < Range)
+						pClientEvents[NumClientEvents++] = i;
+				}
 			}
-		}
+
+		// the buckets are visited by position, put the events back in creation order
+		std::sort(pClientEvents, pClientEvents + NumClientEvents);
+		m_aNumClientEvents[ClientID] = NumClientEvents;
+	}
+}
+
+void CEventHandler::Snap(int SnappingClient)
+{
+	// demos get every event
+	const int Num = SnappingClient == -1 ? m_NumEvents : m_aNumClientEvents[SnappingClient];
+	for(int n = 0; n < Num; n++)
+	{
+		const int i = SnappingClient == -1 ? n : m_aaClientEvents[SnappingClient][n];
+		void *d = GameServer()->Server()->SnapNewItem(m_aEvents[i].m_Type, i, m_aEvents[i].m_Size);
+		if(d)
+			mem_copy(d, &m_aData[m_aEvents[i].m_Offset], m_aEvents[i].m_Size);
 	}
 }
@@ -3,22 +3,50 @@
 #ifndef GAME_SERVER_EVENTHANDLER_H
 #define GAME_SERVER_EVENTHANDLER_H
 
-//
+#include <engine/shared/protocol.h>
+
+/*
+	Class: Event handler
+		Events of the current snap tick. Before the snapshots are
+		built, the events are bucketed by position and each client
+		gets the list of events it receives, so its snapshot only
+		looks at those.
+*/
 class CEventHandler
 {
-	static const int MAX_EVENTS = 128;
-	static const int MAX_DATASIZE = 128 * 64;
+	enum
+	{
+		MAX_EVENTS = 128,
+		MAX_DATASIZE = 128 * 64,
+		CELL_SIZE = 1024, // width and height of an event bucket in world units
+		GRID_SIZE = 16, // buckets in each direction, the grid wraps around
+		NUM_CELLS = GRID_SIZE * GRID_SIZE,
+	};
+
+	struct CEvent
+	{
+		int m_Type;
+		int m_Size;
+		int m_Offset;
+		int64_t m_ClientMask;
+		int m_NextInCell;
+	};
 
-	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
-	int m_aOffsets[MAX_EVENTS];
-	int m_aSizes[MAX_EVENTS];
-	int64_t m_aClientMasks[MAX_EVENTS];
+	CEvent m_aEvents[MAX_EVENTS];
 	char m_aData[MAX_DATASIZE];
 
+	int m_aCellEvents[NUM_CELLS]; // first event of each bucket, -1 if empty
+	unsigned char m_aaClientEvents[MAX_CLIENTS][MAX_EVENTS];
+	int m_aNumClientEvents[MAX_CLIENTS];
+
 	class CGameContext *m_pGameServer;
 
 	int m_CurrentOffset;
 	int m_NumEvents;
+	int m_NumDropped; // since the last report
+	int m_LastDropReport;
+
+	static int UnwrappedCellCoord(float Value);
 
 public:
 	CGameContext *GameServer() const { return m_pGameServer; }
@@ -27,6 +55,7 @@ public:
 	CEventHandler();
 	void *Create(int Type, int Size, int64_t Mask = -1);
 	void Clear();
+	void SnapCommon();
 	void Snap(int SnappingClient);
 };
 
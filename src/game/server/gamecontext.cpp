@@ -385,6 +385,24 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 	str_copy(m_aVoteReason, pReason, sizeof(m_aVoteReason));
 	SendVoteSet(m_VoteType, -1);
 	m_VoteUpdate = true;
+
+	// load a voted map while the vote is running
+	const char *pMap = str_startswith(pCommand, "sv_map ");
+	if(pMap)
+	{
+		char aMap[128];
+		str_copy(aMap, str_skip_whitespaces_const(pMap), sizeof(aMap));
+		char *pName = aMap[0] == '"' ? aMap + 1 : aMap;
+		for(char *p = pName; *p; p++)
+		{
+			if(*p == '"' || *p == ';')
+			{
+				*p = 0;
+				break;
+			}
+		}
+		Server()->PreloadMap(pName);
+	}
 }
 
 void CGameContext::EndVote(int Type, bool Force)
@@ -394,6 +412,10 @@ void CGameContext::EndVote(int Type, bool Force)
 	if(Force)
 		m_VoteCreator = -1;
 	SendVoteSet(Type, -1);
+
+	// don't keep the map of a failed vote loaded
+	if(Type != VOTE_END_PASS && str_startswith(m_aVoteCommand, "sv_map "))
+		Server()->CancelPreload();
 }
 
 void CGameContext::SendForceVote(int Type, const char *pDescription, const char *pReason)
@@ -656,6 +678,45 @@ void CGameContext::OnClientPredictedInput(int ClientID, void *pInput)
 	}
 }
 
+void CGameContext::OnBenchmarkJoin(int ClientID, bool Human)
+{
+	CPlayer *pPlayer = m_apPlayers[ClientID];
+	pPlayer->m_IsBenchmark = true;
+	pPlayer->m_IsBenchmarkHuman = Human;
+	pPlayer->m_IsReadyToEnter = true;
+}
+
+static unsigned BenchmarkHash(unsigned Seed, unsigned ClientID, unsigned Segment)
+{
+	unsigned Hash = Seed * 0x9e3779b1u ^ ClientID * 0x85ebca77u ^ Segment * 0xc2b2ae3du;
+	Hash ^= Hash >> 15;
+	Hash *= 0x2c1b3c6du;
+	Hash ^= Hash >> 12;
+	Hash *= 0x297a2d39u;
+	Hash ^= Hash >> 15;
+	return Hash;
+}
+
+void CGameContext::OnBenchmarkInput(int ClientID, int Tick, unsigned Seed, void *pInput)
+{
+	// each half second the player picks a new move, aim and hook, and sweeps the aim meanwhile
+	const int SegmentTicks = Server()->TickSpeed() / 2;
+	unsigned Hash = BenchmarkHash(Seed, ClientID, Tick / SegmentTicks);
+
+	CNetObj_PlayerInput *pPlayerInput = (CNetObj_PlayerInput *) pInput;
+	mem_zero(pPlayerInput, sizeof(*pPlayerInput));
+	pPlayerInput->m_Direction = (int) (Hash % 3) - 1;
+	pPlayerInput->m_Jump = (Hash >> 2) & 1;
+	pPlayerInput->m_Hook = (Hash >> 3) & 1;
+
+	float Angle = (Hash >> 8 & 0xff) * (2.0f * pi / 256.0f) + (Tick % SegmentTicks) * 0.02f;
+	pPlayerInput->m_TargetX = (int) (cosf(Angle) * 256.0f);
+	pPlayerInput->m_TargetY = (int) (sinf(Angle) * 256.0f);
+
+	// a click every second, which toggles the flashlight of humans
+	pPlayerInput->m_Fire = (Tick / Server()->TickSpeed() * 2) & INPUT_STATE_MASK;
+}
+
 void CGameContext::OnClientEnter(int ClientID)
 {
 	// send chat commands
@@ -1231,6 +1292,14 @@ void CGameContext::ConTunes(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CGameContext::ConLightStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *) pUserData;
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "flashlight raycasts: cast=%lld saved=%lld", (long long) pSelf->m_World.m_NumLightRaycasts, (long long) pSelf->m_World.m_NumLightRaycastsSaved);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "game", aBuf);
+}
+
 void CGameContext::ConSay(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *) pUserData;
@@ -1462,6 +1531,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "s[tuning] ?i[value]", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value or show current value");
 	Console()->Register("tune_reset", "?s[tuning]", CFGFLAG_SERVER, ConTuneReset, this, "Reset all or one tuning variable to default");
 	Console()->Register("tunes", "", CFGFLAG_SERVER, ConTunes, this, "List all tuning variables and their values");
+	Console()->Register("light_stats", "", CFGFLAG_SERVER, ConLightStats, this, "Show how many flashlight raycasts were cast and saved");
 
 	Console()->Register("say", "r[text]", CFGFLAG_SERVER, ConSay, this, "Say in chat");
 	Console()->Register("broadcast", "r[text]", CFGFLAG_SERVER, ConBroadcast, this, "Broadcast message");
@@ -1486,6 +1556,87 @@ void CGameContext::RemoveCommandHook(const CCommandManager::CCommand *pCommand,
 	pSelf->SendRemoveChatCommand(pCommand, -1);
 }
 
+struct CStaleVisibilityFiles
+{
+	IStorage *m_pStorage;
+	const char *m_pDirectory;
+	const char *m_pPrefix; // map name and '_'
+	const char *m_pKeep;
+};
+
+static int RemoveStaleVisibility(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	// files of other versions of the map are named like the current one, only the hash differs
+	CStaleVisibilityFiles *pFiles = (CStaleVisibilityFiles *) pUser;
+	const char *pHash = str_startswith(pName, pFiles->m_pPrefix);
+	if(IsDir || !pHash || str_length(pHash) != SHA256_MAXSTRSIZE - 1 + 4 || !str_endswith(pHash, ".vis") || str_comp(pName, pFiles->m_pKeep) == 0)
+		return 0;
+	SHA256_DIGEST Sha256;
+	char aHash[SHA256_MAXSTRSIZE];
+	str_copy(aHash, pHash, sizeof(aHash));
+	if(sha256_from_str(&Sha256, aHash))
+		return 0;
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s/%s", pFiles->m_pDirectory, pName);
+	pFiles->m_pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+	return 0;
+}
+
+void CGameContext::InitVisibility()
+{
+	// the visibility set only depends on the map, keep it next to the map under its hash
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Kernel()->RequestInterface<IEngineMap>()->Sha256(), aSha256, sizeof(aSha256));
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "maps/%s_%s.vis", Server()->GetCurrentMap(), aSha256);
+
+	IOHANDLE File = Storage()->OpenFile(aPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(File)
+	{
+		const bool Loaded = m_Collision.LoadVisibility(File);
+		io_close(File);
+		if(Loaded)
+			return;
+	}
+
+	const int64_t Start = time_get();
+	m_Collision.InitVisibility();
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "built map visibility in %.2fms", (time_get() - Start) * 1000.0 / time_freq());
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
+
+	// maps can be in subdirectories of maps/, create all of them
+	char aDirectory[IO_MAX_PATH_LENGTH];
+	for(int i = 0; aPath[i]; i++)
+	{
+		if(aPath[i] != '/')
+			continue;
+		str_copy(aDirectory, aPath, minimum(i + 1, (int) sizeof(aDirectory)));
+		Storage()->CreateFolder(aDirectory, IStorage::TYPE_SAVE);
+	}
+
+	File = Storage()->OpenFile(aPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	const bool Saved = File && m_Collision.SaveVisibility(File);
+	if(File)
+		io_close(File);
+	if(!Saved)
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to save map visibility to '%s'", aPath);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "game", aBuf);
+		return;
+	}
+
+	// the map changed if there was none for this hash, drop the files of its old versions
+	str_copy(aDirectory, aPath, sizeof(aDirectory));
+	fs_parent_dir(aDirectory);
+	const char *pFilename = aPath + str_length(aDirectory) + 1;
+	char aPrefix[IO_MAX_PATH_LENGTH];
+	str_copy(aPrefix, pFilename, minimum(str_length(pFilename) - (SHA256_MAXSTRSIZE - 1) - 4 + 1, (int) sizeof(aPrefix)));
+	CStaleVisibilityFiles StaleFiles = {Storage(), aDirectory, aPrefix, pFilename};
+	Storage()->ListDirectory(IStorage::TYPE_SAVE, aDirectory, RemoveStaleVisibility, &StaleFiles);
+}
+
 void CGameContext::OnInit()
 {
 	// init everything
@@ -1495,6 +1646,7 @@ void CGameContext::OnInit()
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
+	m_SnapLayer.SetGameServer(this);
 	m_CommandManager.Init(m_pConsole, this, NewCommandHook, RemoveCommandHook);
 
 	// HACK: only set static size for items, which were available in the first 0.7 release
@@ -1505,6 +1657,8 @@ void CGameContext::OnInit()
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	if(Config()->m_SvMapVisibility)
+		InitVisibility();
 
 	m_pController = new CGameController(this);
 	m_pController->RegisterChatCommands(CommandManager());
@@ -1570,6 +1724,7 @@ void CGameContext::OnSnap(int ClientID)
 		mem_copy(pTuneParams->m_aTuneParams, &m_Tuning, sizeof(pTuneParams->m_aTuneParams));
 	}
 
+	m_SnapLayer.Snap(ClientID);
 	m_World.Snap(ClientID);
 	m_pController->Snap(ClientID);
 	m_Events.Snap(ClientID);
@@ -1580,7 +1735,14 @@ void CGameContext::OnSnap(int ClientID)
 			m_apPlayers[i]->Snap(ClientID);
 	}
 }
-void CGameContext::OnPreSnap() {}
+void CGameContext::OnPreSnap()
+{
+	m_SnapLayer.Clear();
+	m_World.SnapCommon();
+	m_pController->SnapCommon();
+	m_Events.SnapCommon();
+}
+
 void CGameContext::OnPostSnap()
 {
 	m_World.PostSnap();
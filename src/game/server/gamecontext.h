@@ -12,6 +12,7 @@
 
 #include "eventhandler.h"
 #include "gameworld.h"
+#include "snaplayer.h"
 
 /*
 	Tick
@@ -25,8 +26,17 @@
 			All players (CPlayer::tick)
 
 
-	Snap
+	PreSnap, once per snapshot tick
+		Game Context (CGameContext::pre_snap)
+			Snap layer (SNAP_LAYER::clear)
+			Game World (GAMEWORLD::snap_common)
+				All entities in the world (ENTITY::snap_common)
+			Game Controller (GAMECONTROLLER::snap_common)
+
+
+	Snap, once per client
 		Game Context (CGameContext::snap)
+			Snap layer (SNAP_LAYER::snap)
 			Game World (GAMEWORLD::snap)
 				All entities in the world (ENTITY::snap)
 			Game Controller (GAMECONTROLLER::snap)
@@ -48,6 +58,7 @@ class CGameContext : public IGameServer
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static void ConTunes(IConsole::IResult *pResult, void *pUserData);
+	static void ConLightStats(IConsole::IResult *pResult, void *pUserData);
 	static void ConSay(IConsole::IResult *pResult, void *pUserData);
 	static void ConBroadcast(IConsole::IResult *pResult, void *pUserData);
 	static void ConSetTeam(IConsole::IResult *pResult, void *pUserData);
@@ -64,6 +75,7 @@ class CGameContext : public IGameServer
 
 	CGameContext(int Resetting);
 	void Construct(int Resetting);
+	void InitVisibility();
 
 	bool m_Resetting;
 
@@ -81,6 +93,7 @@ public:
 	void Clear();
 
 	CEventHandler m_Events;
+	CSnapLayer m_SnapLayer;
 	class CPlayer *m_apPlayers[MAX_PLAYERS];
 
 	class CGameController *m_pController;
@@ -178,6 +191,9 @@ public:
 	void OnClientDirectInput(int ClientID, void *pInput) override;
 	void OnClientPredictedInput(int ClientID, void *pInput) override;
 
+	void OnBenchmarkJoin(int ClientID, bool Human) override;
+	void OnBenchmarkInput(int ClientID, int Tick, unsigned Seed, void *pInput) override;
+
 	bool IsClientBot(int ClientID) const override;
 	bool IsClientReady(int ClientID) const override;
 	bool IsClientPlayer(int ClientID) const override;
@@ -275,9 +275,9 @@ void CGameController::ResetGame()
 }
 
 // general
-void CGameController::Snap(int SnappingClient)
+void CGameController::SnapCommon()
 {
-	CNetObj_GameData *pGameData = static_cast<CNetObj_GameData *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData)));
+	CNetObj_GameData *pGameData = static_cast<CNetObj_GameData *>(GameServer()->m_SnapLayer.NewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData)));
 	if(!pGameData)
 		return;
 
@@ -285,13 +285,16 @@ void CGameController::Snap(int SnappingClient)
 	pGameData->m_GameStateFlags = m_GamePreparing ? GAMESTATEFLAG_WARMUP : 0;
 	pGameData->m_GameStateEndTick = maximum(0, m_GameEndTick); // no timer/infinite = 0, on end = GameEndTick, otherwise = GameStateEndTick
 
-	CNetObj_GameDataTeam *pGameDataTeam = static_cast<CNetObj_GameDataTeam *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATATEAM, 0, sizeof(CNetObj_GameDataTeam)));
+	CNetObj_GameDataTeam *pGameDataTeam = static_cast<CNetObj_GameDataTeam *>(GameServer()->m_SnapLayer.NewItem(NETOBJTYPE_GAMEDATATEAM, 0, sizeof(CNetObj_GameDataTeam)));
 	if(!pGameDataTeam)
 		return;
 
 	pGameDataTeam->m_TeamscoreBlue = m_aTeamPlayersCount[TEAM_BLUE];
 	pGameDataTeam->m_TeamscoreRed = m_aTeamPlayersCount[TEAM_RED];
+}
 
+void CGameController::Snap(int SnappingClient)
+{
 	// demo recording
 	if(SnappingClient == -1)
 	{
@@ -355,10 +358,21 @@ void CGameController::Tick()
 		vPlayers.clear();
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			if(GameServer()->m_apPlayers[i])
+			CPlayer *pPlayer = GameServer()->m_apPlayers[i];
+			if(pPlayer)
 			{
-				GameServer()->m_apPlayers[i]->KillCharacter();
-				if(GameServer()->m_apPlayers[i]->GetTeam() != TEAM_SPECTATORS)
+				pPlayer->KillCharacter();
+				if(pPlayer->GetTeam() == TEAM_SPECTATORS)
+					continue;
+
+				// benchmark players bring their role along
+				if(pPlayer->m_IsBenchmark)
+				{
+					if(pPlayer->m_IsBenchmarkHuman)
+						DoTeamChange(pPlayer, TEAM_BLUE, false);
+					Humans = 0;
+				}
+				else
 					vPlayers.push_back(i);
 			}
 		}
@@ -119,6 +119,7 @@ public:
 
 	// general
 	void Snap(int SnappingClient);
+	void SnapCommon();
 	void Tick();
 
 	bool CanChangeTeam(class CPlayer *pPlayer, int JoinTeam) const;
@@ -1,6 +1,11 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <algorithm>
+
+#include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
+
 #include "gameworld.h"
 #include "entities/character.h"
 #include "entity.h"
@@ -19,7 +24,18 @@ CGameWorld::CGameWorld()
 	m_Paused = false;
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = 0;
+		m_aMaxProximityRadius[i] = 0.0f;
+		m_aProfileSections[i] = -1;
+	}
+	m_ProfileLights = -1;
+	m_ProfilePhysics = -1;
+	m_NumPhysicsThreads = 0;
+	m_NextInsertOrder = 0;
+	m_FirstFreeHandleSlot = -1;
+	m_NumLightRaycasts = 0;
+	m_NumLightRaycastsSaved = 0;
 }
 
 CGameWorld::~CGameWorld()
@@ -28,6 +44,12 @@ CGameWorld::~CGameWorld()
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		while(m_apFirstEntityTypes[i])
 			delete m_apFirstEntityTypes[i];
+
+	if(m_NumPhysicsThreads > 0)
+	{
+		m_PhysicsJobPool.Shutdown();
+		sphore_destroy(&m_PhysicsJobsDone);
+	}
 }
 
 void CGameWorld::SetGameServer(CGameContext *pGameServer)
@@ -35,6 +57,23 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 	m_pGameServer = pGameServer;
 	m_pConfig = m_pGameServer->Config();
 	m_pServer = m_pGameServer->Server();
+
+	static const char *s_apTypeNames[NUM_ENTTYPES] = {"projectile", "laser", "pickup", "character"};
+	char aName[CProfiler::MAX_NAME_LENGTH];
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
+		str_format(aName, sizeof(aName), "world_tick_%s", s_apTypeNames[i]);
+		m_aProfileSections[i] = m_pServer->Profiler()->RegisterSection(aName);
+	}
+	m_ProfileLights = m_pServer->Profiler()->RegisterSection("world_lights");
+	m_ProfilePhysics = m_pServer->Profiler()->RegisterSection("world_physics");
+
+	m_NumPhysicsThreads = Config()->m_SvPhysicsThreads;
+	if(m_NumPhysicsThreads > 0)
+	{
+		sphore_init(&m_PhysicsJobsDone);
+		m_PhysicsJobPool.Init(m_NumPhysicsThreads);
+	}
 }
 
 CEntity *CGameWorld::FindFirst(int Type)
@@ -42,13 +81,44 @@ CEntity *CGameWorld::FindFirst(int Type)
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
 }
 
+CEntity *CGameWorld::CNearbyEntities::First()
+{
+	m_Index = 0;
+	if(m_Num < 0)
+		return m_pCur;
+	return m_Num > 0 ? m_apEnts[0] : 0;
+}
+
+CEntity *CGameWorld::CNearbyEntities::Next()
+{
+	if(m_Num < 0)
+		return m_pCur = m_pCur->m_pNextTypeEntity;
+	return ++m_Index < m_Num ? m_apEnts[m_Index] : 0;
+}
+
+void CGameWorld::FindNearby(CNearbyEntities *pNearby, int Type, vec2 Min, vec2 Max)
+{
+	// pad a little so rounding never drops an entity right at the edge
+	const float Pad = m_aMaxProximityRadius[Type] + 1.0f;
+	const vec2 Reach = vec2(Pad, Pad);
+	pNearby->m_Num = m_aGrids[Type].Query(Min - Reach, Max + Reach, (void **) pNearby->m_apEnts, MAX_NEARBY);
+	pNearby->m_pCur = m_apFirstEntityTypes[Type];
+
+	// the type list has the newest entity first, keep that order so results don't depend on the grid
+	if(pNearby->m_Num > 1)
+		std::sort(pNearby->m_apEnts, pNearby->m_apEnts + pNearby->m_Num, [](const CEntity *pA, const CEntity *pB) { return pA->m_InsertOrder > pB->m_InsertOrder; });
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
+	CNearbyEntities Nearby;
+	FindNearby(&Nearby, Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius));
+
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+	for(CEntity *pEnt = Nearby.First(); pEnt; pEnt = Nearby.Next())
 	{
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
@@ -76,6 +146,27 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	pEnt->m_InsertOrder = m_NextInsertOrder++;
+
+	if(m_FirstFreeHandleSlot < 0)
+	{
+		m_FirstFreeHandleSlot = m_vHandleSlots.size();
+		m_vHandleSlots.push_back({0, 0, -1});
+	}
+	CHandleSlot *pSlot = &m_vHandleSlots[m_FirstFreeHandleSlot];
+	pEnt->m_Handle.m_Index = m_FirstFreeHandleSlot;
+	pEnt->m_Handle.m_Generation = pSlot->m_Generation;
+	pSlot->m_pEntity = pEnt;
+	m_FirstFreeHandleSlot = pSlot->m_NextFree;
+
+	m_aGrids[pEnt->m_ObjType].Insert(&pEnt->m_GridNode, pEnt->m_Pos);
+	m_aMaxProximityRadius[pEnt->m_ObjType] = maximum(m_aMaxProximityRadius[pEnt->m_ObjType], pEnt->m_ProximityRadius);
+}
+
+void CGameWorld::UpdateEntityCell(CEntity *pEnt)
+{
+	m_aGrids[pEnt->m_ObjType].Move(&pEnt->m_GridNode, pEnt->m_Pos);
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -103,6 +194,15 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+	m_aGrids[pEnt->m_ObjType].Remove(&pEnt->m_GridNode);
+
+	// invalidate the handles to it
+	CHandleSlot *pSlot = &m_vHandleSlots[pEnt->m_Handle.m_Index];
+	pSlot->m_pEntity = 0;
+	pSlot->m_Generation++;
+	pSlot->m_NextFree = m_FirstFreeHandleSlot;
+	m_FirstFreeHandleSlot = pEnt->m_Handle.m_Index;
+	pEnt->m_Handle = CEntityHandle();
 }
 
 //
@@ -117,6 +217,17 @@ void CGameWorld::Snap(int SnappingClient)
 		}
 }
 
+void CGameWorld::SnapCommon()
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
+		{
+			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			pEnt->SnapCommon();
+			pEnt = m_pNextTraverseEntity;
+		}
+}
+
 void CGameWorld::PostSnap()
 {
 	for(int i = 0; i < NUM_ENTTYPES; i++)
@@ -180,25 +291,86 @@ void CGameWorld::Tick()
 	}
 	else
 	{
+		CProfiler *pProfiler = Server()->Profiler();
+
 		// update all objects
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			CProfileScope Scope(pProfiler, m_aProfileSections[i]);
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->Tick();
 				pEnt = m_pNextTraverseEntity;
 			}
+		}
+
+		{
+			CProfileScope Scope(pProfiler, m_ProfilePhysics);
+			PreparePhysics();
+		}
 
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			CProfileScope Scope(pProfiler, m_aProfileSections[i]);
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->TickDefered();
 				pEnt = m_pNextTraverseEntity;
 			}
+		}
 	}
 
 	RemoveEntities();
+	UpdateLights();
+}
+
+void CGameWorld::CPhysicsJob::Run()
+{
+	for(int i = 0; i < m_Num; i++)
+		m_ppCharacters[i]->PreparePhysics();
+	sphore_signal(m_pDone);
+}
+
+void CGameWorld::PreparePhysics()
+{
+	if(m_NumPhysicsThreads <= 0)
+		return;
+
+	m_vpPhysicsCharacters.clear();
+	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		m_vpPhysicsCharacters.push_back(static_cast<CCharacter *>(pEnt));
+
+	// one range per worker and one for this thread, TickDefered then merges the results in list order
+	int NumCharacters = m_vpPhysicsCharacters.size();
+	int NumRanges = minimum(m_NumPhysicsThreads + 1, NumCharacters);
+	int NumJobs = 0;
+	for(int i = 1; i < NumRanges; i++)
+	{
+		int Start = NumCharacters * i / NumRanges;
+		int End = NumCharacters * (i + 1) / NumRanges;
+		m_PhysicsJobPool.Add(std::make_shared<CPhysicsJob>(&m_vpPhysicsCharacters[Start], End - Start, &m_PhysicsJobsDone));
+		NumJobs++;
+	}
+
+	int End = NumRanges > 0 ? NumCharacters / NumRanges : 0;
+	for(int i = 0; i < End; i++)
+		m_vpPhysicsCharacters[i]->PreparePhysics();
+
+	for(int i = 0; i < NumJobs; i++)
+		sphore_wait(&m_PhysicsJobsDone);
+}
+
+void CGameWorld::UpdateLights()
+{
+	CProfileScope Scope(Server()->Profiler(), m_ProfileLights);
+
+	// take every light once, then test the ghosts against them
+	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		static_cast<CCharacter *>(pEnt)->UpdateLight();
+	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		static_cast<CCharacter *>(pEnt)->RevealGhosts();
 }
 
 // TODO: should be more general
@@ -208,8 +380,10 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CCharacter *pClosest = 0;
 
-	CCharacter *p = (CCharacter *) FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *) p->TypeNext())
+	CNearbyEntities Nearby;
+	FindNearby(&Nearby, ENTTYPE_CHARACTER, vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius),
+		vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius));
+	for(CCharacter *p = (CCharacter *) Nearby.First(); p; p = (CCharacter *) Nearby.Next())
 	{
 		if(p == pNotThis)
 			continue;
@@ -233,12 +407,16 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 
 CEntity *CGameWorld::ClosestEntity(vec2 Pos, float Radius, int Type, CEntity *pNotThis)
 {
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
+
 	// Find other players
 	float ClosestRange = Radius * 2;
 	CEntity *pClosest = 0;
 
-	CEntity *p = FindFirst(Type);
-	for(; p; p = p->TypeNext())
+	CNearbyEntities Nearby;
+	FindNearby(&Nearby, Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius));
+	for(CEntity *p = Nearby.First(); p; p = Nearby.Next())
 	{
 		if(p == pNotThis)
 			continue;
@@ -3,11 +3,36 @@
 #ifndef GAME_SERVER_GAMEWORLD_H
 #define GAME_SERVER_GAMEWORLD_H
 
+#include <engine/shared/jobs.h>
 #include <game/gamecore.h>
+#include <game/spatialgrid.h>
+
+#include <vector>
 
 class CEntity;
 class CCharacter;
 
+/*
+	Class: Entity Handle
+		Refers to an entity while it is in the world. Once the
+		entity is removed from the world the handle resolves to
+		null, so it can be kept instead of a pointer that would
+		dangle.
+*/
+class CEntityHandle
+{
+public:
+	int m_Index;
+	int m_Generation;
+
+	CEntityHandle() :
+		m_Index(-1), m_Generation(0) {}
+
+	bool IsNull() const { return m_Index < 0; }
+	bool operator==(const CEntityHandle &Other) const { return m_Index == Other.m_Index && m_Generation == Other.m_Generation; }
+	bool operator!=(const CEntityHandle &Other) const { return !(*this == Other); }
+};
+
 /*
 	Class: Game World
 		Tracks all entities in the game. Propagates tick and
@@ -26,12 +51,75 @@ public:
 	};
 
 private:
+	enum
+	{
+		MAX_NEARBY = 256,
+	};
+
+	// entities of a type that may be close to an area, in type list order
+	class CNearbyEntities
+	{
+	public:
+		CEntity *m_apEnts[MAX_NEARBY];
+		int m_Num; // -1 if there are too many, walk the whole type list instead
+		int m_Index;
+		CEntity *m_pCur;
+
+		CEntity *First();
+		CEntity *Next();
+	};
+
 	void Reset();
 	void RemoveEntities();
+	void FindNearby(CNearbyEntities *pNearby, int Type, vec2 Min, vec2 Max);
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// broadphase for the position queries, one grid per entity type
+	CSpatialGrid m_aGrids[NUM_ENTTYPES];
+	float m_aMaxProximityRadius[NUM_ENTTYPES];
+	int64_t m_NextInsertOrder;
+
+	// entities that handles refer to, a slot gets a new generation when its entity leaves the world
+	class CHandleSlot
+	{
+	public:
+		CEntity *m_pEntity;
+		int m_Generation;
+		int m_NextFree;
+	};
+	std::vector<CHandleSlot> m_vHandleSlots;
+	int m_FirstFreeHandleSlot;
+
+	// profiler section per entity type
+	int m_aProfileSections[NUM_ENTTYPES];
+	int m_ProfileLights;
+	int m_ProfilePhysics;
+
+	void UpdateLights();
+
+	// prepares the physics of a range of characters
+	class CPhysicsJob : public IJob
+	{
+		CCharacter **m_ppCharacters;
+		int m_Num;
+		SEMAPHORE *m_pDone;
+
+		void Run() override;
+
+	public:
+		CPhysicsJob(CCharacter **ppCharacters, int Num, SEMAPHORE *pDone) :
+			m_ppCharacters(ppCharacters), m_Num(Num), m_pDone(pDone) {}
+	};
+
+	CJobPool m_PhysicsJobPool;
+	SEMAPHORE m_PhysicsJobsDone;
+	int m_NumPhysicsThreads;
+	std::vector<CCharacter *> m_vpPhysicsCharacters;
+
+	void PreparePhysics();
+
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
 	class IServer *m_pServer;
@@ -45,6 +133,10 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	// raycasts done for flashlights, and those answered from the light state instead
+	int64_t m_NumLightRaycasts;
+	int64_t m_NumLightRaycastsSaved;
+
 	CGameWorld();
 	~CGameWorld();
 
@@ -52,6 +144,20 @@ public:
 
 	CEntity *FindFirst(int Type);
 
+	/*
+		Function: get_entity
+			Resolves a handle to its entity.
+
+		Returns:
+			The entity, or null if it was removed from the world.
+	*/
+	CEntity *GetEntity(CEntityHandle Handle) const
+	{
+		if(Handle.m_Index < 0 || Handle.m_Index >= (int) m_vHandleSlots.size() || m_vHandleSlots[Handle.m_Index].m_Generation != Handle.m_Generation)
+			return 0;
+		return m_vHandleSlots[Handle.m_Index].m_pEntity;
+	}
+
 	/*
 		Function: find_entities
 			Finds entities close to a position and returns them in a list.
@@ -118,6 +224,16 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: update_entity_cell
+			Moves an entity to the grid cell of its current position.
+			Called by CEntity::SetPos.
+
+		Arguments:
+			entity - Entity that moved
+	*/
+	void UpdateEntityCell(CEntity *pEntity);
+
 	/*
 		Function: destroy_entity
 			Destroys an entity in the world.
@@ -138,6 +254,13 @@ public:
 	*/
 	void Snap(int SnappingClient);
 
+	/*
+		Function: snap_common
+			Calls snap_common on all the entities in the world to
+			build the items that are shared by all snapshots.
+	*/
+	void SnapCommon();
+
 	void PostSnap();
 
 	/*
@@ -28,6 +28,8 @@ CPlayer::CPlayer(CGameContext *pGameServer, int ClientID, bool Dummy, bool AsSpe
 	m_InactivityTickCounter = 0;
 	m_Dummy = Dummy;
 	m_IsReadyToPlay = false;
+	m_IsBenchmark = false;
+	m_IsBenchmarkHuman = false;
 	m_RespawnDisabled = false;
 	m_DeadSpecMode = false;
 	m_Spawning = false;
@@ -185,10 +187,6 @@ void CPlayer::OnDisconnect()
 					GameServer()->m_apPlayers[i]->m_SpectatorID = -1;
 				}
 			}
-			if(m_Team == TEAM_RED && m_pCharacter && m_pCharacter->IsAlive() && GameServer()->GetPlayerChar(i))
-			{
-				GameServer()->GetPlayerChar(i)->OnCharacterDeadOrEscaped(m_pCharacter);
-			}
 		}
 	}
 
@@ -62,6 +62,10 @@ public:
 	bool m_IsReadyToEnter;
 	bool m_IsReadyToPlay;
 
+	// scripted player of a --bench run, keeps its role across rounds
+	bool m_IsBenchmark;
+	bool m_IsBenchmarkHuman;
+
 	bool m_RespawnDisabled;
 
 	//
@@ -0,0 +1,103 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/shared/config.h>
+
+#include "entity.h"
+#include "gamecontext.h"
+#include "player.h"
+#include "snaplayer.h"
+
+//////////////////////////////////////////////////
+// Snap layer
+//////////////////////////////////////////////////
+CSnapLayer::CSnapLayer()
+{
+	m_pGameServer = 0;
+	Clear();
+}
+
+void CSnapLayer::SetGameServer(CGameContext *pGameServer)
+{
+	m_pGameServer = pGameServer;
+}
+
+void *CSnapLayer::AddItem(int Type, int ID, int Size, int Clip, vec2 ClipFrom, vec2 ClipTo, int Team, int Owner)
+{
+	if(m_NumItems == MAX_ITEMS)
+		return 0;
+	if(m_CurrentOffset + Size > MAX_DATASIZE)
+		return 0;
+
+	CItem *pItem = &m_aItems[m_NumItems];
+	pItem->m_Type = Type;
+	pItem->m_ID = ID;
+	pItem->m_Size = Size;
+	pItem->m_Offset = m_CurrentOffset;
+	pItem->m_Clip = Clip;
+	pItem->m_ClipFrom = ClipFrom;
+	pItem->m_ClipTo = ClipTo;
+	pItem->m_Team = Team;
+	pItem->m_Owner = Owner;
+
+	void *p = &m_aData[m_CurrentOffset];
+	mem_zero(p, Size);
+	m_CurrentOffset += Size;
+	m_NumItems++;
+	return p;
+}
+
+void *CSnapLayer::NewItem(int Type, int ID, int Size, int Team, int Owner)
+{
+	return AddItem(Type, ID, Size, CLIP_NONE, vec2(0, 0), vec2(0, 0), Team, Owner);
+}
+
+void *CSnapLayer::NewItem(int Type, int ID, int Size, vec2 ClipPos, int Team, int Owner)
+{
+	return AddItem(Type, ID, Size, CLIP_POINT, ClipPos, ClipPos, Team, Owner);
+}
+
+void *CSnapLayer::NewItem(int Type, int ID, int Size, vec2 ClipFrom, vec2 ClipTo, int Team, int Owner)
+{
+	return AddItem(Type, ID, Size, CLIP_LINE, ClipFrom, ClipTo, Team, Owner);
+}
+
+bool CSnapLayer::IsPersonal(int Owner, int SnappingClient) const
+{
+	return Owner == SnappingClient || SnappingClient == -1 ||
+	       (!GameServer()->Config()->m_SvStrictSpectateMode && Owner == GameServer()->m_apPlayers[SnappingClient]->GetSpectatorID());
+}
+
+void CSnapLayer::Clear()
+{
+	m_NumItems = 0;
+	m_CurrentOffset = 0;
+}
+
+void CSnapLayer::Snap(int SnappingClient)
+{
+	const CPlayer *pPlayer = SnappingClient == -1 ? 0 : GameServer()->m_apPlayers[SnappingClient];
+
+	for(int i = 0; i < m_NumItems; i++)
+	{
+		const CItem *pItem = &m_aItems[i];
+
+		if(pItem->m_Owner != -1 && IsPersonal(pItem->m_Owner, SnappingClient))
+			continue;
+
+		if(pPlayer)
+		{
+			if(pItem->m_Team != TEAM_ALL && pPlayer->GetTeam() != pItem->m_Team && pPlayer->GetTeam() != TEAM_SPECTATORS)
+				continue;
+
+			if(pItem->m_Clip == CLIP_POINT && CEntity::ViewClipped(pPlayer->m_ViewPos, pItem->m_ClipFrom))
+				continue;
+			if(pItem->m_Clip == CLIP_LINE && CEntity::ViewClipped(pPlayer->m_ViewPos, closest_point_on_line(pItem->m_ClipFrom, pItem->m_ClipTo, pPlayer->m_ViewPos)))
+				continue;
+		}
+
+		void *d = GameServer()->Server()->SnapNewItem(pItem->m_Type, pItem->m_ID, pItem->m_Size);
+		if(d)
+			mem_copy(d, &m_aData[pItem->m_Offset], pItem->m_Size);
+	}
+}
@@ -0,0 +1,89 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SERVER_SNAPLAYER_H
+#define GAME_SERVER_SNAPLAYER_H
+
+#include <base/vmath.h>
+
+/*
+	Class: Snap layer
+		Snapshot items that are the same for every client. They are
+		built once per snap tick and copied into the snapshot of each
+		client that is able to see them.
+*/
+class CSnapLayer
+{
+	enum
+	{
+		MAX_ITEMS = 1024,
+		MAX_DATASIZE = 64 * 1024,
+	};
+
+	enum
+	{
+		CLIP_NONE = 0,
+		CLIP_POINT,
+		CLIP_LINE,
+	};
+
+	struct CItem
+	{
+		int m_Type;
+		int m_ID;
+		int m_Size;
+		int m_Offset;
+		int m_Clip;
+		vec2 m_ClipFrom;
+		vec2 m_ClipTo;
+		int m_Team;
+		int m_Owner;
+	};
+
+	CItem m_aItems[MAX_ITEMS];
+	char m_aData[MAX_DATASIZE];
+
+	class CGameContext *m_pGameServer;
+
+	int m_CurrentOffset;
+	int m_NumItems;
+
+	void *AddItem(int Type, int ID, int Size, int Clip, vec2 ClipFrom, vec2 ClipTo, int Team, int Owner);
+
+public:
+	enum
+	{
+		TEAM_ALL = -2,
+	};
+
+	CGameContext *GameServer() const { return m_pGameServer; }
+	void SetGameServer(CGameContext *pGameServer);
+
+	CSnapLayer();
+
+	/*
+		Function: NewItem
+			Adds an item to the layer.
+
+		Arguments:
+			Team - If not TEAM_ALL, only players of this team and
+				spectators receive the item.
+			Owner - If not -1, the item is left out for the owner, the
+				players watching him and demos. The owning entity has to
+				snap its own version of the item for them.
+			ClipPos/ClipFrom/ClipTo - The item is left out for clients
+				that are too far away from this position or line.
+
+		Returns:
+			Pointer to the item data or 0 if the layer is full.
+	*/
+	void *NewItem(int Type, int ID, int Size, int Team = TEAM_ALL, int Owner = -1);
+	void *NewItem(int Type, int ID, int Size, vec2 ClipPos, int Team = TEAM_ALL, int Owner = -1);
+	void *NewItem(int Type, int ID, int Size, vec2 ClipFrom, vec2 ClipTo, int Team = TEAM_ALL, int Owner = -1);
+
+	bool IsPersonal(int Owner, int SnappingClient) const;
+
+	void Clear();
+	void Snap(int SnappingClient);
+};
+
+#endif
@@ -0,0 +1,97 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <math.h>
+
+#include "spatialgrid.h"
+
+CSpatialGrid::CSpatialGrid()
+{
+	for(int i = 0; i < NUM_CELLS; i++)
+		m_apCells[i] = 0;
+}
+
+int CSpatialGrid::UnwrappedCellCoord(float Value)
+{
+	// clamp before converting, positions can be anything
+	const float Limit = (float) CELL_SIZE * 0x100000;
+	if(!(Value > -Limit))
+		Value = -Limit;
+	else if(Value > Limit)
+		Value = Limit;
+	return (int) floorf(Value / CELL_SIZE);
+}
+
+void CSpatialGrid::Link(CNode *pNode, int Cell)
+{
+	pNode->m_Cell = Cell;
+	pNode->m_pPrev = 0;
+	pNode->m_pNext = m_apCells[Cell];
+	if(m_apCells[Cell])
+		m_apCells[Cell]->m_pPrev = pNode;
+	m_apCells[Cell] = pNode;
+}
+
+void CSpatialGrid::Unlink(CNode *pNode)
+{
+	if(pNode->m_pPrev)
+		pNode->m_pPrev->m_pNext = pNode->m_pNext;
+	else
+		m_apCells[pNode->m_Cell] = pNode->m_pNext;
+	if(pNode->m_pNext)
+		pNode->m_pNext->m_pPrev = pNode->m_pPrev;
+	pNode->m_pPrev = 0;
+	pNode->m_pNext = 0;
+	pNode->m_Cell = -1;
+}
+
+void CSpatialGrid::Insert(CNode *pNode, vec2 Pos)
+{
+	if(pNode->InGrid())
+		Unlink(pNode);
+	Link(pNode, CellIndex(Pos));
+}
+
+void CSpatialGrid::Move(CNode *pNode, vec2 Pos)
+{
+	if(!pNode->InGrid())
+		return;
+
+	const int Cell = CellIndex(Pos);
+	if(Cell == pNode->m_Cell)
+		return;
+	Unlink(pNode);
+	Link(pNode, Cell);
+}
+
+void CSpatialGrid::Remove(CNode *pNode)
+{
+	if(pNode->InGrid())
+		Unlink(pNode);
+}
+
+int CSpatialGrid::Query(vec2 Min, vec2 Max, void **ppUsers, int MaxUsers) const
+{
+	// walk each cell at most once, even if the area is wider than the grid
+	const int StartX = UnwrappedCellCoord(Min.x);
+	const int StartY = UnwrappedCellCoord(Min.y);
+	const int NumX = minimum(UnwrappedCellCoord(Max.x) - StartX + 1, (int) GRID_SIZE);
+	const int NumY = minimum(UnwrappedCellCoord(Max.y) - StartY + 1, (int) GRID_SIZE);
+
+	int Num = 0;
+	for(int y = 0; y < NumY; y++)
+	{
+		const int Row = ((StartY + y) & (GRID_SIZE - 1)) * GRID_SIZE;
+		for(int x = 0; x < NumX; x++)
+		{
+			for(const CNode *pNode = m_apCells[Row + ((StartX + x) & (GRID_SIZE - 1))]; pNode; pNode = pNode->m_pNext)
+			{
+				if(Num == MaxUsers)
+					return -1;
+				ppUsers[Num++] = pNode->m_pUser;
+			}
+		}
+	}
+	return Num;
+}
@@ -0,0 +1,79 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SPATIALGRID_H
+#define GAME_SPATIALGRID_H
+
+#include <base/vmath.h>
+
+/*
+	Class: Spatial Grid
+		Buckets objects into square cells by position so that area
+		queries only look at the objects close to the area. The grid
+		has a fixed number of cells and wraps around, so objects far
+		apart can share a cell. Queries return candidates, the caller
+		has to do the exact test.
+*/
+class CSpatialGrid
+{
+public:
+	enum
+	{
+		CELL_SIZE = 256,
+		GRID_SIZE = 64,
+		NUM_CELLS = GRID_SIZE * GRID_SIZE,
+	};
+
+	/*
+		Class: Node
+			Link of an object in the grid, embedded in the object.
+	*/
+	class CNode
+	{
+		friend class CSpatialGrid;
+
+		CNode *m_pPrev;
+		CNode *m_pNext;
+		int m_Cell;
+
+	public:
+		void *m_pUser;
+
+		CNode() :
+			m_pPrev(0), m_pNext(0), m_Cell(-1), m_pUser(0) {}
+		bool InGrid() const { return m_Cell != -1; }
+	};
+
+private:
+	CNode *m_apCells[NUM_CELLS];
+
+	static int UnwrappedCellCoord(float Value);
+	static int CellCoord(float Value) { return UnwrappedCellCoord(Value) & (GRID_SIZE - 1); }
+	static int CellIndex(vec2 Pos) { return CellCoord(Pos.y) * GRID_SIZE + CellCoord(Pos.x); }
+	void Link(CNode *pNode, int Cell);
+	void Unlink(CNode *pNode);
+
+public:
+	CSpatialGrid();
+
+	void Insert(CNode *pNode, vec2 Pos);
+	void Move(CNode *pNode, vec2 Pos);
+	void Remove(CNode *pNode);
+
+	/*
+		Function: Query
+			Finds the objects in the cells that overlap an area.
+
+		Arguments:
+			Min - Top left corner of the area.
+			Max - Bottom right corner of the area.
+			ppUsers - Filled with the user pointers of the objects.
+			MaxUsers - Number of pointers that fit into ppUsers.
+
+		Returns:
+			Number of objects found, or -1 if there are more than
+			MaxUsers of them.
+	*/
+	int Query(vec2 Min, vec2 Max, void **ppUsers, int MaxUsers) const;
+};
+
+#endif
@@ -16,6 +16,9 @@ MACRO_CONFIG_INT(SvInactiveKickTime, sv_inactivekick_time, 3, 0, 1000, CFGFLAG_S
 MACRO_CONFIG_INT(SvInactiveKick, sv_inactivekick, 2, 1, 3, CFGFLAG_SAVE | CFGFLAG_SERVER, "How to deal with inactive clients (1=move player to spectator, 2=move to free spectator slot/kick, 3=kick)")
 MACRO_CONFIG_INT(SvInactiveKickSpec, sv_inactivekick_spec, 0, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Kick inactive spectators")
 
+MACRO_CONFIG_INT(SvMapVisibility, sv_map_visibility, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Precompute which parts of the map can see each other to skip line of sight tests, cached next to the map (takes effect on map change)")
+MACRO_CONFIG_INT(SvPhysicsThreads, sv_physics_threads, 0, 0, 16, CFGFLAG_SAVE | CFGFLAG_SERVER, "Number of threads that help preparing character movement, 0 does it in the tick (takes effect on map change)")
+
 MACRO_CONFIG_INT(SvSilentSpectatorMode, sv_silent_spectator_mode, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Mute join/leave message of spectator")
 
 MACRO_CONFIG_INT(SvStrictSpectateMode, sv_strict_spectate_mode, 0, 0, 1, CFGFLAG_SAVE | CFGFLAG_SERVER, "Restricts information in spectator mode")
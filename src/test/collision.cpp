@@ -0,0 +1,377 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/collision.h>
+#include <game/mapitems.h>
+
+#include <stdio.h>
+#include <vector>
+
+static const int MAP_WIDTH = 200;
+static const int MAP_HEIGHT = 100;
+
+static unsigned s_Seed = 7;
+static int RandomInt(int Range)
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+	return (s_Seed >> 8) % Range;
+}
+
+// a map with a solid border, some death tiles and rotated physical quads of all kinds
+static void CreateMap(std::vector<CTile> *pvTiles, std::vector<CQuad> *pvQuads, int NumQuads)
+{
+	pvTiles->assign(MAP_WIDTH * MAP_HEIGHT, CTile());
+	for(int y = 0; y < MAP_HEIGHT; y++)
+		for(int x = 0; x < MAP_WIDTH; x++)
+		{
+			CTile &Tile = (*pvTiles)[y * MAP_WIDTH + x];
+			if(x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1)
+				Tile.m_Index = TILE_SOLID;
+			else if(RandomInt(40) == 0)
+				Tile.m_Index = RandomInt(2) ? TILE_DEATH : TILE_NOHOOK;
+		}
+
+	static const int s_aFlags[] = {TILE_AIR, TILE_SOLID, TILE_DEATH, TILE_EXPORT};
+	pvQuads->assign(NumQuads, CQuad());
+	for(auto &Quad : *pvQuads)
+	{
+		const vec2 Center = vec2(RandomInt(MAP_WIDTH * 32 + 400) - 200, RandomInt(MAP_HEIGHT * 32 + 400) - 200);
+		const vec2 Size = vec2(8 + RandomInt(300), 8 + RandomInt(200));
+		const float Angle = RandomInt(628) / 100.0f;
+		const vec2 aCorners[4] = {vec2(-Size.x, -Size.y), vec2(Size.x, -Size.y), vec2(-Size.x, Size.y), vec2(Size.x, Size.y)};
+		for(int c = 0; c < 4; c++)
+		{
+			const vec2 Rotated = vec2(aCorners[c].x * cosf(Angle) - aCorners[c].y * sinf(Angle), aCorners[c].x * sinf(Angle) + aCorners[c].y * cosf(Angle));
+			Quad.m_aPoints[c].x = f2fx(Center.x + Rotated.x);
+			Quad.m_aPoints[c].y = f2fx(Center.y + Rotated.y);
+		}
+		Quad.m_ColorEnvOffset = s_aFlags[RandomInt(4)];
+	}
+}
+
+// the inside test of CCollision, checking every quad like before the quad bins
+static bool SameSide(vec2 l0, vec2 l1, vec2 p0, vec2 p1)
+{
+	vec2 l0l1 = l1 - l0;
+	vec2 l0p0 = p0 - l0;
+	vec2 l0p1 = p1 - l0;
+	return sign(l0l1.x * l0p0.y - l0l1.y * l0p0.x) == sign(l0l1.x * l0p1.y - l0l1.y * l0p1.x);
+}
+
+static bool InsideTriangle(vec2 t0, vec2 t1, vec2 t2, vec2 p)
+{
+	vec2 e0 = t1 - t0;
+	vec2 e1 = t2 - t0;
+	vec2 e2 = p - t0;
+	float d00 = dot(e0, e0);
+	float d01 = dot(e0, e1);
+	float d11 = dot(e1, e1);
+	float d20 = dot(e2, e0);
+	float d21 = dot(e2, e1);
+	float denom = d00 * d11 - d01 * d01;
+	float u = (d11 * d20 - d01 * d21) / denom;
+	float v = (d00 * d21 - d01 * d20) / denom;
+	return u >= 0.0f && v >= 0.0f && u + v < 1.0f;
+}
+
+static int ReferenceCollisionAt(const std::vector<CTile> &vTiles, const std::vector<CQuad> &vQuads, int x, int y)
+{
+	int Nx = clamp(x / 32, 0, MAP_WIDTH - 1);
+	int Ny = clamp(y / 32, 0, MAP_HEIGHT - 1);
+	int Index = vTiles[Ny * MAP_WIDTH + Nx].m_Index > 128 ? 0 : vTiles[Ny * MAP_WIDTH + Nx].m_Index;
+	for(const auto &Quad : vQuads)
+	{
+		vec2 p[4];
+		for(int c = 0; c < 4; c++)
+			p[c] = vec2(fx2f(Quad.m_aPoints[c].x), fx2f(Quad.m_aPoints[c].y));
+		vec2 Pos = vec2(x, y);
+		if(SameSide(p[1], p[2], Pos, p[0]) ? InsideTriangle(p[0], p[1], p[2], Pos) : InsideTriangle(p[1], p[2], p[3], Pos))
+			Index |= Quad.m_ColorEnvOffset;
+	}
+	return Index;
+}
+
+TEST(Collision, PhysicalQuadsMatchReference)
+{
+	std::vector<CTile> vTiles;
+	std::vector<CQuad> vQuads;
+	CreateMap(&vTiles, &vQuads, 300);
+	CCollision Collision;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, vQuads.data(), vQuads.size());
+
+	int NumDeath = 0;
+	for(int i = 0; i < 50000; i++)
+	{
+		const int x = RandomInt(MAP_WIDTH * 32 + 800) - 400;
+		const int y = RandomInt(MAP_HEIGHT * 32 + 800) - 400;
+		const int Flags = Collision.GetCollisionAt(x, y);
+		ASSERT_EQ(Flags, ReferenceCollisionAt(vTiles, vQuads, x, y)) << "x=" << x << " y=" << y;
+		NumDeath += (Flags & CCollision::COLFLAG_DEATH) != 0;
+	}
+	EXPECT_GT(NumDeath, 0);
+
+	// no physical quads at all
+	CCollision TilesOnly;
+	TilesOnly.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+	EXPECT_EQ(TilesOnly.GetCollisionAt(0, 0), CCollision::COLFLAG_SOLID);
+	EXPECT_EQ(TilesOnly.GetCollisionAt(-1000, 50 * 32), CCollision::COLFLAG_SOLID);
+}
+
+TEST(Collision, DISABLED_BenchmarkPhysicalQuads)
+{
+	std::vector<CTile> vTiles, vTilesOnly;
+	std::vector<CQuad> vQuads, vNoQuads;
+	CreateMap(&vTiles, &vQuads, 500);
+	vTilesOnly = vTiles;
+	CCollision Collision, TilesOnly;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, vQuads.data(), vQuads.size());
+	TilesOnly.Init(vTilesOnly.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+
+	const int NumPoints = 20000;
+	std::vector<int> vX(NumPoints), vY(NumPoints);
+	for(int i = 0; i < NumPoints; i++)
+	{
+		vX[i] = RandomInt(MAP_WIDTH * 32);
+		vY[i] = RandomInt(MAP_HEIGHT * 32);
+	}
+
+	int Sum[3] = {0, 0, 0};
+	int64_t Start = time_get();
+	for(int i = 0; i < NumPoints; i++)
+		Sum[0] += TilesOnly.GetCollisionAt(vX[i], vY[i]);
+	int64_t TilesTime = time_get() - Start;
+
+	Start = time_get();
+	for(int i = 0; i < NumPoints; i++)
+		Sum[1] += Collision.GetCollisionAt(vX[i], vY[i]);
+	int64_t QuadsTime = time_get() - Start;
+
+	Start = time_get();
+	for(int i = 0; i < NumPoints; i++)
+		Sum[2] += ReferenceCollisionAt(vTiles, vQuads, vX[i], vY[i]);
+	int64_t ReferenceTime = time_get() - Start;
+
+	EXPECT_EQ(Sum[1], Sum[2]);
+	printf("500 physical quads: tiles only %.1fns, binned quads %.1fns, all quads %.1fns per point\n",
+		TilesTime * 1e9 / time_freq() / NumPoints, QuadsTime * 1e9 / time_freq() / NumPoints, ReferenceTime * 1e9 / time_freq() / NumPoints);
+}
+
+// CCollision::IntersectLine before the tile walk, testing every sample
+static int ReferenceIntersectLine(const CCollision *pCollision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	const int End = distance(Pos0, Pos1) + 1;
+	const float InverseEnd = 1.0f / End;
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		vec2 Pos = mix(Pos0, Pos1, i * InverseEnd);
+		if(pCollision->CheckPoint(Pos.x, Pos.y))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return pCollision->GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static void RandomLine(vec2 *pPos0, vec2 *pPos1)
+{
+	*pPos0 = vec2(RandomInt(MAP_WIDTH * 32 + 400) - 200, RandomInt(MAP_HEIGHT * 32 + 400) - 200) + vec2(RandomInt(100), RandomInt(100)) / 100.0f;
+	switch(RandomInt(5))
+	{
+	case 0: // axis aligned
+		*pPos1 = *pPos0 + (RandomInt(2) ? vec2(RandomInt(1024) - 512, 0) : vec2(0, RandomInt(1024) - 512));
+		break;
+	case 1: // diagonal through tile corners
+		*pPos0 = vec2(RandomInt(MAP_WIDTH) * 32 - 0.5f, RandomInt(MAP_HEIGHT) * 32 - 0.5f);
+		*pPos1 = *pPos0 + vec2(RandomInt(2) ? 1 : -1, RandomInt(2) ? 1 : -1) * (float) (32 * RandomInt(16));
+		break;
+	case 2: // short
+		*pPos1 = *pPos0 + vec2(RandomInt(64) - 32, RandomInt(64) - 32) / 4.0f;
+		break;
+	case 3: // along a border where the samples round into the next tile, with a tiny slope
+	{
+		const float Border = RandomInt(MAP_WIDTH) * 32 - 0.5f;
+		const float Along = RandomInt(1024) - 512;
+		const float Slope = (RandomInt(2001) - 1000) / 100000.0f;
+		if(RandomInt(2))
+		{
+			*pPos0 = vec2(pPos0->x, Border);
+			*pPos1 = *pPos0 + vec2(Along, Slope);
+		}
+		else
+		{
+			*pPos0 = vec2(Border, pPos0->y);
+			*pPos1 = *pPos0 + vec2(Slope, Along);
+		}
+		break;
+	}
+	default:
+		*pPos1 = *pPos0 + vec2(RandomInt(2048) - 1024, RandomInt(2048) - 1024) + vec2(RandomInt(100), RandomInt(100)) / 100.0f;
+	}
+}
+
+TEST(Collision, IntersectLineMatchesSampling)
+{
+	std::vector<CTile> vTiles;
+	std::vector<CQuad> vQuads;
+	CreateMap(&vTiles, &vQuads, 100);
+	CCollision Collision;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, vQuads.data(), vQuads.size());
+
+	int NumHits = 0;
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos0, Pos1;
+		RandomLine(&Pos0, &Pos1);
+
+		vec2 Collision0, Before0, Collision1, Before1;
+		const int Result = Collision.IntersectLine(Pos0, Pos1, &Collision0, &Before0);
+		ASSERT_EQ(Result, ReferenceIntersectLine(&Collision, Pos0, Pos1, &Collision1, &Before1)) << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+		ASSERT_EQ(mem_comp(&Collision0, &Collision1, sizeof(vec2)), 0);
+		ASSERT_EQ(mem_comp(&Before0, &Before1, sizeof(vec2)), 0);
+		NumHits += Result != 0;
+	}
+	EXPECT_GT(NumHits, 1000);
+
+	// lines along rounding borders that the tile walk got wrong
+	const vec2 aaBorderLines[][2] = {
+		{vec2(188.0f, 1087.5f), vec2(-211.988007f, 1087.499878f)},
+		{vec2(1599.5f, 1545.0f), vec2(1599.497803f, 681.658386f)},
+	};
+	for(const auto &aLine : aaBorderLines)
+	{
+		vec2 Collision0, Before0, Collision1, Before1;
+		EXPECT_EQ(Collision.IntersectLine(aLine[0], aLine[1], &Collision0, &Before0), ReferenceIntersectLine(&Collision, aLine[0], aLine[1], &Collision1, &Before1));
+		EXPECT_EQ(mem_comp(&Collision0, &Collision1, sizeof(vec2)), 0);
+		EXPECT_EQ(mem_comp(&Before0, &Before1, sizeof(vec2)), 0);
+	}
+
+	// a few lines through known tiles, one at a time
+	std::vector<CTile> vTilesOnly = vTiles;
+	vTilesOnly[3 * MAP_WIDTH + 3].m_Index = TILE_SOLID;
+	vTilesOnly[4 * MAP_WIDTH + 4].m_Index = TILE_AIR;
+	vTilesOnly[5 * MAP_WIDTH + 4].m_Index = TILE_AIR;
+	CCollision TilesOnly;
+	TilesOnly.Init(vTilesOnly.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+
+	vec2 aStarts[3] = {vec2(100, 100), vec2(150, 150), vec2(-50, 100)};
+	vec2 aEnds[3] = {vec2(140, 100), vec2(150, 180), vec2(40, 100)};
+	vec2 aCollisions[3];
+	int aResults[3];
+	EXPECT_EQ(TilesOnly.IntersectLines(aStarts, aEnds, 3, aResults, aCollisions), 2);
+	EXPECT_EQ(aResults[0], CCollision::COLFLAG_SOLID);
+	EXPECT_EQ(aResults[1], 0);
+	EXPECT_EQ(aResults[2], CCollision::COLFLAG_SOLID);
+	EXPECT_EQ(aCollisions[0], vec2(100, 100));
+	EXPECT_EQ(aCollisions[1], vec2(150, 180));
+	EXPECT_EQ(aCollisions[2], vec2(-50, 100));
+}
+
+TEST(Collision, DISABLED_BenchmarkIntersectLine)
+{
+	std::vector<CTile> vTiles;
+	std::vector<CQuad> vQuads;
+	CreateMap(&vTiles, &vQuads, 0);
+	CCollision Collision;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+
+	// line of sight checks in flashlight range
+	const int NumLines = 20000;
+	std::vector<vec2> vStarts(NumLines), vEnds(NumLines);
+	std::vector<int> vResults(NumLines);
+	for(int i = 0; i < NumLines; i++)
+	{
+		vStarts[i] = vec2(RandomInt(MAP_WIDTH * 32), RandomInt(MAP_HEIGHT * 32));
+		vEnds[i] = vStarts[i] + normalize(vec2(RandomInt(200) - 100, RandomInt(200) - 100)) * 512.0f;
+	}
+
+	int64_t Start = time_get();
+	const int Hits = Collision.IntersectLines(vStarts.data(), vEnds.data(), NumLines, vResults.data());
+	int64_t Walk = time_get() - Start;
+
+	Start = time_get();
+	int ReferenceHits = 0;
+	for(int i = 0; i < NumLines; i++)
+	{
+		vec2 Out, Before;
+		ReferenceHits += ReferenceIntersectLine(&Collision, vStarts[i], vEnds[i], &Out, &Before) != 0;
+	}
+	int64_t Sampling = time_get() - Start;
+
+	EXPECT_EQ(Hits, ReferenceHits);
+	printf("512 unit lines: tile walk %.2fus, sampling %.2fus per line\n",
+		Walk * 1e6 / time_freq() / NumLines, Sampling * 1e6 / time_freq() / NumLines);
+}
+
+// rooms with doors and some pillars, so many regions can't see each other
+static void CreateRoomMap(std::vector<CTile> *pvTiles)
+{
+	pvTiles->assign(MAP_WIDTH * MAP_HEIGHT, CTile());
+	for(int y = 0; y < MAP_HEIGHT; y++)
+		for(int x = 0; x < MAP_WIDTH; x++)
+		{
+			CTile &Tile = (*pvTiles)[y * MAP_WIDTH + x];
+			const bool Wall = (x % 13 == 0 && y % 13 > 2) || (y % 11 == 0 && x % 11 > 3);
+			if(x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1 || Wall || RandomInt(30) == 0)
+				Tile.m_Index = RandomInt(4) ? TILE_SOLID : TILE_NOHOOK;
+		}
+}
+
+TEST(Collision, VisibilityNeverHidesFreeLines)
+{
+	CTestInfo Info;
+	std::vector<CTile> vTiles;
+	CreateRoomMap(&vTiles);
+	std::vector<CTile> vLoadedTiles = vTiles;
+	CCollision Collision;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+	EXPECT_TRUE(Collision.MaySee(vec2(100, 100), vec2(3000, 1000)));
+	Collision.InitVisibility();
+	ASSERT_TRUE(Collision.HasVisibility());
+
+	// the set has to give the same answers after a round trip through a file
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_TRUE(Collision.SaveVisibility(File));
+	io_close(File);
+	CCollision Loaded;
+	Loaded.Init(vLoadedTiles.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	EXPECT_TRUE(Loaded.LoadVisibility(File));
+	io_close(File);
+	fs_remove(Info.m_aFilename);
+
+	int NumHidden = 0;
+	for(int i = 0; i < 100000; i++)
+	{
+		vec2 Pos0, Pos1;
+		if(i % 2)
+			RandomLine(&Pos0, &Pos1);
+		else
+		{
+			// flashlight range
+			Pos0 = vec2(RandomInt(MAP_WIDTH * 3200), RandomInt(MAP_HEIGHT * 3200)) / 100.0f;
+			Pos1 = Pos0 + vec2(RandomInt(1200) - 600, RandomInt(1200) - 600) + vec2(RandomInt(100), RandomInt(100)) / 100.0f;
+		}
+
+		const bool MaySee = Collision.MaySee(Pos0, Pos1);
+		ASSERT_EQ(MaySee, Loaded.MaySee(Pos0, Pos1));
+		if(!MaySee)
+		{
+			ASSERT_NE(Collision.IntersectLine(Pos0, Pos1, nullptr, nullptr), 0) << Pos0.x << "," << Pos0.y << " " << Pos1.x << "," << Pos1.y;
+			NumHidden++;
+		}
+	}
+	EXPECT_GT(NumHidden, 5000);
+}
@@ -2,8 +2,11 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <gtest/gtest.h>
 
+#include <base/system.h>
 #include <engine/shared/compression.h>
 
+#include <stdio.h>
+
 static const int DATA[] = {0, 1, -1, 32, 64, 256, -512, 12345, -123456, 1234567, 12345678, 123456789, 2147483647, (-2147483647 - 1)};
 static const int NUM = sizeof(DATA) / sizeof(int);
 static const int SIZES[NUM] = {1, 1, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4, 5, 5};
@@ -84,3 +87,92 @@ TEST(CVariableInt, DecompressBufferTooSmall)
 	long CompressedSize = CVariableInt::Decompress(aCompressed, sizeof(aCompressed), aUncompressed, sizeof(aUncompressed));
 	ASSERT_EQ(CompressedSize, -1);
 }
+
+// mostly small values with some of every size, like a snapshot delta
+static void FillDeltaLike(int *pData, int Num)
+{
+	unsigned Seed = 1;
+	for(int i = 0; i < Num; i++)
+	{
+		Seed = Seed * 1103515245u + 12345u;
+		unsigned Rand = Seed >> 8;
+		if(Rand % 3)
+			pData[i] = Rand % 5 ? 0 : (int) (Rand % 64);
+		else
+			pData[i] = DATA[Rand % NUM] + (int) (Rand % 3) - 1;
+	}
+}
+
+TEST(CVariableInt, BulkMatchesSingle)
+{
+	static int s_aData[4096];
+	static unsigned char s_aCompressed[sizeof(s_aData) / sizeof(int) * CVariableInt::MAX_BYTES_PACKED];
+	static unsigned char s_aPacked[sizeof(s_aCompressed)];
+	static int s_aDecompressed[4096];
+	FillDeltaLike(s_aData, 4096);
+
+	for(int Num = 0; Num <= 4096; Num += Num < 64 ? 1 : 509)
+	{
+		unsigned char *pPacked = s_aPacked;
+		for(int i = 0; i < Num; i++)
+			pPacked = CVariableInt::Pack(pPacked, s_aData[i], s_aPacked + sizeof(s_aPacked) - pPacked);
+		const long PackedSize = pPacked - s_aPacked;
+
+		ASSERT_EQ(CVariableInt::Compress(s_aData, Num * sizeof(int), s_aCompressed, sizeof(s_aCompressed)), PackedSize);
+		ASSERT_EQ(mem_comp(s_aCompressed, s_aPacked, PackedSize), 0);
+		EXPECT_EQ(CVariableInt::Compress(s_aData, Num * sizeof(int), s_aCompressed, PackedSize), PackedSize);
+		if(Num)
+		{
+			EXPECT_EQ(CVariableInt::Compress(s_aData, Num * sizeof(int), s_aCompressed, PackedSize - 1), -1);
+		}
+
+		ASSERT_EQ(CVariableInt::Decompress(s_aPacked, PackedSize, s_aDecompressed, sizeof(s_aDecompressed)), (long) (Num * sizeof(int)));
+		EXPECT_EQ(mem_comp(s_aDecompressed, s_aData, Num * sizeof(int)), 0);
+		if(Num)
+		{
+			EXPECT_EQ(CVariableInt::Decompress(s_aPacked, PackedSize, s_aDecompressed, (Num - 1) * sizeof(int)), -1);
+		}
+	}
+}
+
+TEST(CVariableInt, DISABLED_BenchmarkBulk)
+{
+	static int s_aData[4096];
+	static unsigned char s_aCompressed[sizeof(s_aData) / sizeof(int) * CVariableInt::MAX_BYTES_PACKED];
+	static int s_aDecompressed[4096];
+	FillDeltaLike(s_aData, 4096);
+
+	const int Rounds = 500;
+	long Size = 0;
+	int64_t Start = time_get();
+	for(int r = 0; r < Rounds; r++)
+		Size = CVariableInt::Compress(s_aData, sizeof(s_aData), s_aCompressed, sizeof(s_aCompressed));
+	int64_t Compress = time_get() - Start;
+
+	Start = time_get();
+	for(int r = 0; r < Rounds; r++)
+	{
+		unsigned char *pDst = s_aCompressed;
+		for(int i = 0; i < 4096; i++)
+			pDst = CVariableInt::Pack(pDst, s_aData[i], s_aCompressed + sizeof(s_aCompressed) - pDst);
+	}
+	int64_t Pack = time_get() - Start;
+
+	Start = time_get();
+	for(int r = 0; r < Rounds; r++)
+		ASSERT_EQ(CVariableInt::Decompress(s_aCompressed, Size, s_aDecompressed, sizeof(s_aDecompressed)), (long) sizeof(s_aData));
+	int64_t Decompress = time_get() - Start;
+
+	Start = time_get();
+	for(int r = 0; r < Rounds; r++)
+	{
+		const unsigned char *pSrc = s_aCompressed;
+		for(int i = 0; i < 4096; i++)
+			pSrc = CVariableInt::Unpack(pSrc, &s_aDecompressed[i], s_aCompressed + Size - pSrc);
+	}
+	int64_t Unpack = time_get() - Start;
+
+	const double Ints = 4096.0 * Rounds / 1000000.0;
+	printf("varint: compress %.0fM ints/s (pack %.0fM), decompress %.0fM ints/s (unpack %.0fM)\n",
+		Ints * time_freq() / Compress, Ints * time_freq() / Pack, Ints * time_freq() / Decompress, Ints * time_freq() / Unpack);
+}
@@ -7,6 +7,8 @@
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
+#include <zlib.h>
+
 TEST(Datafile, RoundtripItemDataAndSize)
 {
 	CTestInfo Info;
@@ -65,3 +67,121 @@ TEST(Datafile, RoundtripItemDataAndSize)
 
 	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
 }
+
+TEST(Datafile, FileDataAndHashes)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+
+	// hand-written uncompressed v3 file with one item and one data block
+	static const char TEST_DATA[] = "Hello World";
+	int aFile[] = {
+		0x41544144, 3, 0, 0, // "DATA", version, size, swaplen
+		1, 1, 1, 12, sizeof(TEST_DATA), // item types, items, raw data, item size, data size
+		12, 0, 1, // item type 12 starting at item 0
+		0, // item offsets
+		0, // data offsets
+		(12 << 16) | 34, 4, 0, // item 0 with one int pointing at data 0
+		0, 0, 0, // data
+	};
+	mem_copy(&aFile[sizeof(aFile) / sizeof(aFile[0]) - 3], TEST_DATA, sizeof(TEST_DATA));
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, aFile, sizeof(aFile));
+	io_close(File);
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	ASSERT_EQ(Reader.FileSize(), sizeof(aFile));
+	EXPECT_TRUE(mem_comp(Reader.FileData(), aFile, sizeof(aFile)) == 0);
+	EXPECT_EQ(Reader.Crc(), crc32(0, (const unsigned char *) aFile, sizeof(aFile)));
+	EXPECT_TRUE(sha256_comp(Reader.Sha256(), sha256(aFile, sizeof(aFile))) == 0);
+
+	int Type, ID;
+	int *pItem = (int *) Reader.GetItem(0, &Type, &ID);
+	ASSERT_TRUE(pItem);
+	EXPECT_EQ(Type, 12);
+	EXPECT_EQ(ID, 34);
+	ASSERT_EQ(Reader.GetDataSize(*pItem), sizeof(TEST_DATA));
+	char *pData = (char *) Reader.GetData(*pItem);
+	ASSERT_TRUE(pData);
+	EXPECT_STREQ(pData, TEST_DATA);
+
+	// modifying loaded data must not change the file data served for downloads
+	pData[0] = 'J';
+	EXPECT_TRUE(mem_comp(Reader.FileData(), aFile, sizeof(aFile)) == 0);
+	EXPECT_STREQ((char *) Reader.GetData(*pItem), "Jello World");
+
+	Reader.UnloadData(*pItem);
+	EXPECT_TRUE(Reader.Close());
+	EXPECT_EQ(Reader.FileData(), (const unsigned char *) 0);
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, HashCache)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	char aCacheFilename[64];
+	Info.Filename(aCacheFilename, sizeof(aCacheFilename), ".hashes");
+	IStorage *pStorage = CreateTestStorage();
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+	int aItem[1] = {0};
+	Writer.AddItem(12, 34, sizeof(aItem), aItem);
+	EXPECT_TRUE(Writer.Finish());
+
+	CDataFileHashCache HashCache;
+	EXPECT_FALSE(HashCache.Load(pStorage, aCacheFilename));
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL, &HashCache));
+	const SHA256_DIGEST Sha256 = Reader.Sha256();
+	const unsigned Crc = Reader.Crc();
+	const unsigned Size = Reader.FileSize();
+	EXPECT_EQ(Crc, crc32(0, Reader.FileData(), Size));
+	EXPECT_EQ(HashCache.Num(), 1);
+	EXPECT_TRUE(Reader.Close());
+
+	// entries survive a save and load
+	EXPECT_TRUE(HashCache.Save(pStorage, aCacheFilename));
+	CDataFileHashCache LoadedCache;
+	EXPECT_TRUE(LoadedCache.Load(pStorage, aCacheFilename));
+	EXPECT_EQ(LoadedCache.Num(), 1);
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL, &LoadedCache));
+	EXPECT_EQ(Reader.Sha256(), Sha256);
+	EXPECT_EQ(Reader.Crc(), Crc);
+	EXPECT_TRUE(Reader.Close());
+
+	// a cached entry is trusted as long as size and modification time match
+	char aPath[IO_MAX_PATH_LENGTH];
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_READ, IStorage::TYPE_ALL, aPath, sizeof(aPath));
+	ASSERT_TRUE(File);
+	io_close(File);
+	time_t Created, Modified;
+	ASSERT_EQ(fs_file_time(aPath, &Created, &Modified), 0);
+	SHA256_DIGEST Sha256Cached;
+	unsigned CrcCached;
+	ASSERT_TRUE(LoadedCache.Find(aPath, Size, Modified, &Sha256Cached, &CrcCached));
+	EXPECT_EQ(Sha256Cached, Sha256);
+	EXPECT_FALSE(LoadedCache.Find(aPath, Size, Modified + 1, &Sha256Cached, &CrcCached));
+	EXPECT_FALSE(LoadedCache.Find(aPath, Size + 1, Modified, &Sha256Cached, &CrcCached));
+	LoadedCache.Add(aPath, Size, Modified, SHA256_ZEROED, 0);
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL, &LoadedCache));
+	EXPECT_EQ(Reader.Sha256(), SHA256_ZEROED);
+	EXPECT_TRUE(Reader.Close());
+
+	// a stale entry is replaced by the real hashes
+	LoadedCache.Add(aPath, Size, Modified - 1, SHA256_ZEROED, 0);
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL, &LoadedCache));
+	EXPECT_EQ(Reader.Sha256(), Sha256);
+	EXPECT_TRUE(Reader.Close());
+	EXPECT_EQ(LoadedCache.Num(), 1);
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+	EXPECT_TRUE(pStorage->RemoveFile(aCacheFilename, IStorage::TYPE_SAVE));
+}
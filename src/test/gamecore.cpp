@@ -0,0 +1,121 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+
+#include <vector>
+
+static const int MAP_WIDTH = 40;
+static const int MAP_HEIGHT = 30;
+static const int NUM_CORES = 24;
+
+static unsigned s_Seed = 3;
+static int RandomInt(int Range)
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+	return (s_Seed >> 8) % Range;
+}
+
+// a solid box with some platforms and death tiles
+static void CreateMap(std::vector<CTile> *pvTiles)
+{
+	pvTiles->assign(MAP_WIDTH * MAP_HEIGHT, CTile());
+	for(int y = 0; y < MAP_HEIGHT; y++)
+		for(int x = 0; x < MAP_WIDTH; x++)
+		{
+			CTile &Tile = (*pvTiles)[y * MAP_WIDTH + x];
+			if(x == 0 || y == 0 || x == MAP_WIDTH - 1 || y == MAP_HEIGHT - 1 || (y % 6 == 0 && x % 9 < 5))
+				Tile.m_Index = TILE_SOLID;
+			else if(RandomInt(60) == 0)
+				Tile.m_Index = TILE_DEATH;
+		}
+}
+
+// many characters close together, so they push and block each other
+static void CreateCores(CWorldCore *pWorld, CCollision *pCollision, CCharacterCore *pCores)
+{
+	for(int i = 0; i < NUM_CORES; i++)
+	{
+		pCores[i].Init(pWorld, pCollision);
+		pCores[i].Reset();
+		pCores[i].m_Pos = vec2(200 + RandomInt(400), 60 + RandomInt(120));
+		pCores[i].m_Vel = vec2(RandomInt(41) - 20, RandomInt(41) - 20);
+		mem_zero(&pCores[i].m_Input, sizeof(pCores[i].m_Input));
+		pWorld->m_apCharacters[i] = &pCores[i];
+	}
+}
+
+static void ExpectSameCore(const CCharacterCore *pExpected, const CCharacterCore *pActual)
+{
+	EXPECT_EQ(mem_comp(&pExpected->m_Pos, &pActual->m_Pos, sizeof(vec2)), 0);
+	EXPECT_EQ(mem_comp(&pExpected->m_Vel, &pActual->m_Vel, sizeof(vec2)), 0);
+	EXPECT_EQ(mem_comp(&pExpected->m_HookDragVel, &pActual->m_HookDragVel, sizeof(vec2)), 0);
+	EXPECT_EQ(pExpected->m_Death, pActual->m_Death);
+	EXPECT_EQ(pExpected->m_HookState, pActual->m_HookState);
+	EXPECT_EQ(pExpected->m_HookedPlayer, pActual->m_HookedPlayer);
+}
+
+TEST(GameCore, PreparedMoveMatchesMove)
+{
+	std::vector<CTile> vTiles;
+	CreateMap(&vTiles);
+	CCollision Collision;
+	Collision.Init(vTiles.data(), MAP_WIDTH, MAP_HEIGHT, nullptr, 0);
+
+	CWorldCore SerialWorld, PreparedWorld;
+	CCharacterCore aSerial[NUM_CORES], aPrepared[NUM_CORES];
+	unsigned Seed = s_Seed;
+	CreateCores(&SerialWorld, &Collision, aSerial);
+	s_Seed = Seed;
+	CreateCores(&PreparedWorld, &Collision, aPrepared);
+
+	for(int Tick = 0; Tick < 500; Tick++)
+	{
+		for(int i = 0; i < NUM_CORES; i++)
+		{
+			CNetObj_PlayerInput Input;
+			mem_zero(&Input, sizeof(Input));
+			Input.m_Direction = RandomInt(3) - 1;
+			Input.m_Jump = RandomInt(8) == 0;
+			Input.m_Hook = RandomInt(4) == 0;
+			Input.m_TargetX = RandomInt(201) - 100;
+			Input.m_TargetY = RandomInt(201) - 100;
+			aSerial[i].m_Input = Input;
+			aPrepared[i].m_Input = Input;
+		}
+		for(int i = 0; i < NUM_CORES; i++)
+		{
+			aSerial[i].Tick(true);
+			aPrepared[i].Tick(true);
+		}
+		for(int i = 0; i < NUM_CORES; i++)
+		{
+			aSerial[i].AddDragVelocity();
+			aSerial[i].ResetDragVelocity();
+			aPrepared[i].AddDragVelocity();
+			aPrepared[i].ResetDragVelocity();
+		}
+
+		// prepare all moves before any character moved, apply them in order
+		CCharacterCore::CMoveIntent aIntents[NUM_CORES];
+		for(int i = 0; i < NUM_CORES; i++)
+			aPrepared[i].PrepareMove(&aIntents[i]);
+		for(int i = 0; i < NUM_CORES; i++)
+		{
+			aSerial[i].Move();
+			aSerial[i].Quantize();
+			aPrepared[i].ApplyMove(&aIntents[i]);
+			aPrepared[i].Quantize();
+		}
+
+		for(int i = 0; i < NUM_CORES; i++)
+			ExpectSameCore(&aSerial[i], &aPrepared[i]);
+		if(::testing::Test::HasFailure())
+			break;
+	}
+}
@@ -42,3 +42,12 @@ TEST(Hash, Sha256Eq)
 {
 	EXPECT_EQ(sha256("", 0), sha256("", 0));
 }
+
+TEST(Hash, Sha256FromStr)
+{
+	SHA256_DIGEST Sha256;
+	EXPECT_EQ(sha256_from_str(&Sha256, "ef537f25c895bfa782526529a9b63d97aa631564d5d789c2b765448c8635fb6c"), 0);
+	Expect(Sha256, "ef537f25c895bfa782526529a9b63d97aa631564d5d789c2b765448c8635fb6c");
+	EXPECT_NE(sha256_from_str(&Sha256, "ef537f25"), 0);
+	EXPECT_NE(sha256_from_str(&Sha256, "xf537f25c895bfa782526529a9b63d97aa631564d5d789c2b765448c8635fb6c"), 0);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/huffman.h>
+
+#include <stdio.h>
+
+// produced by the byte at a time encoder, the format must not change
+static const unsigned char COMPRESSED_EMPTY[] = {0x8a, 0x1b};
+static const unsigned char COMPRESSED_ZEROS[] = {0xff, 0x8a, 0x1b};
+static const unsigned char COMPRESSED_TEXT[] = {
+	0xae, 0x95, 0x13, 0x5c, 0x09, 0x57, 0xc2, 0x16, 0xb1, 0x56, 0xdc, 0xda, 0x22, 0x38, 0xb9, 0x12,
+	0x9c, 0x48, 0x9b, 0x35, 0x94, 0xb8, 0x56, 0xd7, 0x42, 0xa7, 0xac, 0x5d, 0x0b, 0x9d, 0xb2, 0xe6,
+	0x28, 0xd6, 0xae, 0xd5, 0x96, 0xd2, 0x79, 0x3a, 0x4f, 0x47, 0x1c, 0xe5, 0xda, 0x59, 0x43, 0x09,
+	0x27, 0xd0, 0x29, 0x94, 0x28, 0x6e, 0x00};
+static const char TEXT[] = "hello world, this is a huffman test";
+
+static unsigned HashBytes(const unsigned char *pData, int Size)
+{
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < Size; i++)
+		Hash = (Hash ^ pData[i]) * 16777619u;
+	return Hash;
+}
+
+// data that looks like a snapshot delta: mostly zeros and small numbers
+static void FillSnapshotLike(unsigned char *pData, int Size, unsigned Seed)
+{
+	for(int i = 0; i < Size; i++)
+	{
+		Seed = Seed * 1103515245u + 12345u;
+		unsigned Rand = Seed >> 16;
+		pData[i] = Rand % 4 ? 0 : (Rand % 7 ? Rand % 16 : Rand);
+	}
+}
+
+class Huffman : public ::testing::Test
+{
+protected:
+	CHuffman m_Huffman;
+
+	Huffman()
+	{
+		m_Huffman.Init();
+	}
+
+	void ExpectCompressed(const void *pData, int Size, const unsigned char *pExpected, int ExpectedSize)
+	{
+		unsigned char aCompressed[256];
+		ASSERT_EQ(m_Huffman.Compress(pData, Size, aCompressed, sizeof(aCompressed)), ExpectedSize);
+		EXPECT_EQ(mem_comp(aCompressed, pExpected, ExpectedSize), 0);
+
+		unsigned char aDecompressed[256];
+		ASSERT_EQ(m_Huffman.Decompress(pExpected, ExpectedSize, aDecompressed, sizeof(aDecompressed)), Size);
+		EXPECT_EQ(mem_comp(aDecompressed, pData, Size), 0);
+	}
+};
+
+TEST_F(Huffman, KnownOutput)
+{
+	unsigned char aZeros[8] = {0};
+	ExpectCompressed("", 0, COMPRESSED_EMPTY, sizeof(COMPRESSED_EMPTY));
+	ExpectCompressed(aZeros, sizeof(aZeros), COMPRESSED_ZEROS, sizeof(COMPRESSED_ZEROS));
+	ExpectCompressed(TEXT, str_length(TEXT), COMPRESSED_TEXT, sizeof(COMPRESSED_TEXT));
+
+	unsigned char aAll[256];
+	for(int i = 0; i < 256; i++)
+		aAll[i] = i;
+	unsigned char aCompressed[512];
+	ASSERT_EQ(m_Huffman.Compress(aAll, sizeof(aAll), aCompressed, sizeof(aCompressed)), 341);
+	EXPECT_EQ(HashBytes(aCompressed, 341), 0x5fce4db0u);
+}
+
+TEST_F(Huffman, Roundtrip)
+{
+	for(int Size = 0; Size < 1400; Size += 7)
+	{
+		unsigned char aData[1400];
+		unsigned char aCompressed[2048];
+		unsigned char aDecompressed[1400];
+		FillSnapshotLike(aData, Size, Size);
+
+		int CompressedSize = m_Huffman.Compress(aData, Size, aCompressed, sizeof(aCompressed));
+		ASSERT_GT(CompressedSize, 0);
+		ASSERT_EQ(m_Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, sizeof(aDecompressed)), Size);
+		EXPECT_EQ(mem_comp(aDecompressed, aData, Size), 0);
+
+		// the output buffer must hold the compressed size, not a byte more
+		EXPECT_EQ(m_Huffman.Compress(aData, Size, aCompressed, CompressedSize), CompressedSize);
+		EXPECT_EQ(m_Huffman.Compress(aData, Size, aCompressed, CompressedSize - 1), -1);
+		EXPECT_EQ(m_Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, Size), Size);
+		if(Size)
+		{
+			EXPECT_EQ(m_Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, Size - 1), -1);
+		}
+	}
+}
+
+TEST_F(Huffman, DecompressTruncated)
+{
+	unsigned char aDecompressed[64];
+	for(int Size = 0; Size < (int) sizeof(COMPRESSED_TEXT) - 1; Size++)
+		EXPECT_NE(m_Huffman.Decompress(COMPRESSED_TEXT, Size, aDecompressed, sizeof(aDecompressed)), str_length(TEXT));
+}
+
+TEST_F(Huffman, DISABLED_BenchmarkThroughput)
+{
+	const int Size = 1400;
+	const int Rounds = 2000;
+	unsigned char aData[Size];
+	unsigned char aCompressed[2048];
+	unsigned char aDecompressed[Size];
+	FillSnapshotLike(aData, Size, 1);
+
+	int CompressedSize = 0;
+	int64_t Start = time_get();
+	for(int i = 0; i < Rounds; i++)
+		CompressedSize = m_Huffman.Compress(aData, Size, aCompressed, sizeof(aCompressed));
+	int64_t CompressTime = time_get() - Start;
+	ASSERT_GT(CompressedSize, 0);
+
+	int DecompressedSize = 0;
+	Start = time_get();
+	for(int i = 0; i < Rounds; i++)
+		DecompressedSize = m_Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, sizeof(aDecompressed));
+	int64_t DecompressTime = time_get() - Start;
+	ASSERT_EQ(DecompressedSize, Size);
+
+	double Bytes = (double) Size * Rounds;
+	printf("%d bytes -> %d: compress %.1fMB/s, decompress %.1fMB/s\n", Size, CompressedSize,
+		Bytes / 1000000.0 / (CompressTime / (double) time_freq()),
+		Bytes / 1000000.0 / (DecompressTime / (double) time_freq()));
+}
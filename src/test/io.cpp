@@ -63,3 +63,23 @@ TEST(Io, ReadBom6)
 {
 	TestFileRead("\xef\xbb\xbfxyz\xef\xbb\xbf", true, "xyz\xef\xbb\xbf");
 }
+
+TEST(Io, FileTimeOfHandle)
+{
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_write(File, "abc", 3), 3u);
+	EXPECT_FALSE(io_close(File));
+
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	time_t Created, Modified, NameCreated, NameModified;
+	EXPECT_EQ(io_file_time(File, &Created, &Modified), 0);
+	EXPECT_EQ(fs_file_time(Info.m_aFilename, &NameCreated, &NameModified), 0);
+	EXPECT_EQ(Created, NameCreated);
+	EXPECT_EQ(Modified, NameModified);
+	EXPECT_FALSE(io_close(File));
+
+	fs_remove(Info.m_aFilename);
+}
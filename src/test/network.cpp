@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+
+#include <stdio.h>
+
+static NETADDR LocalAddr(int Port)
+{
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	Addr.type = NETTYPE_IPV4;
+	Addr.ip[0] = 127;
+	Addr.ip[3] = 1;
+	Addr.port = Port;
+	return Addr;
+}
+
+TEST(NetAddrMap, SetFindRemove)
+{
+	CNetAddrMap Map;
+	NETADDR aAddrs[NET_MAX_CLIENTS];
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
+		aAddrs[i] = LocalAddr(8303 + i);
+		Map.Set(&aAddrs[i], i);
+	}
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		EXPECT_EQ(Map.Find(&aAddrs[i]), i);
+
+	NETADDR Other = LocalAddr(8303);
+	Other.ip[3] = 2;
+	EXPECT_EQ(Map.Find(&Other), -1);
+
+	// removing entries must not hide the ones that were placed behind them
+	for(int i = 0; i < NET_MAX_CLIENTS; i += 2)
+		Map.Remove(&aAddrs[i]);
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		EXPECT_EQ(Map.Find(&aAddrs[i]), i % 2 ? i : -1);
+
+	Map.Set(&aAddrs[1], 100);
+	EXPECT_EQ(Map.Find(&aAddrs[1]), 100);
+	for(int i = 0; i < NET_MAX_CLIENTS; i += 2)
+		Map.Set(&aAddrs[i], i);
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		EXPECT_EQ(Map.Find(&aAddrs[i]), i == 1 ? 100 : i);
+}
+
+// a client that speaks just enough of the protocol to connect and send chunks
+class CRawClient
+{
+public:
+	NETSOCKET m_Socket;
+	NETADDR m_ServerAddr;
+	TOKEN m_Token;
+	TOKEN m_ServerToken;
+
+	void SendPacket(int Flags, TOKEN Token, const unsigned char *pData, int Size)
+	{
+		unsigned char aBuf[NET_MAX_PACKETSIZE];
+		aBuf[0] = (Flags << 2) & 0xfc;
+		aBuf[1] = 0;
+		aBuf[2] = Flags & NET_PACKETFLAG_CONTROL ? 0 : 1;
+		aBuf[3] = (Token >> 24) & 0xff;
+		aBuf[4] = (Token >> 16) & 0xff;
+		aBuf[5] = (Token >> 8) & 0xff;
+		aBuf[6] = Token & 0xff;
+		mem_copy(aBuf + NET_PACKETHEADERSIZE, pData, Size);
+		net_udp_send(m_Socket, &m_ServerAddr, aBuf, NET_PACKETHEADERSIZE + Size);
+	}
+
+	void SendControl(int Msg, TOKEN Token)
+	{
+		unsigned char aData[NET_TOKENREQUEST_DATASIZE] = {0};
+		aData[0] = Msg;
+		aData[1] = (m_Token >> 24) & 0xff;
+		aData[2] = (m_Token >> 16) & 0xff;
+		aData[3] = (m_Token >> 8) & 0xff;
+		aData[4] = m_Token & 0xff;
+		SendPacket(NET_PACKETFLAG_CONTROL, Token, aData, sizeof(aData));
+	}
+
+	void SendChunk(const unsigned char *pData, int Size)
+	{
+		unsigned char aData[64];
+		aData[0] = (Size >> 6) & 0x3f;
+		aData[1] = Size & 0x3f;
+		mem_copy(aData + 2, pData, Size);
+		SendPacket(0, m_ServerToken, aData, Size + 2);
+	}
+
+	bool ReceiveToken()
+	{
+		unsigned char aBuf[NET_MAX_PACKETSIZE];
+		NETADDR From;
+		for(int Tries = 0; Tries < 100; Tries++)
+		{
+			int Size = net_udp_recv(m_Socket, &From, aBuf, sizeof(aBuf));
+			if(Size >= NET_PACKETHEADERSIZE + 5 && aBuf[NET_PACKETHEADERSIZE] == NET_CTRLMSG_TOKEN)
+			{
+				const unsigned char *p = aBuf + NET_PACKETHEADERSIZE + 1;
+				m_ServerToken = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+				return true;
+			}
+			net_socket_read_wait(m_Socket, 10);
+		}
+		return false;
+	}
+};
+
+static int DrainServer(CNetServer *pServer, int *pClientIDs, int Max)
+{
+	int Num = 0;
+	CNetChunk Chunk;
+	while(pServer->Recv(&Chunk))
+	{
+		if(!(Chunk.m_Flags & NETSENDFLAG_CONNLESS) && Num < Max)
+			pClientIDs[Num++] = Chunk.m_ClientID;
+	}
+	return Num;
+}
+
+// returns the slot of the new connection, -1 if the server didn't take it
+static int ConnectClient(CNetServer *pServer, CRawClient *pClient, int Port, TOKEN Token)
+{
+	pClient->m_Socket = net_udp_create(LocalAddr(0), 0);
+	if(!pClient->m_Socket.type)
+		return -1;
+	pClient->m_ServerAddr = LocalAddr(Port);
+	pClient->m_Token = Token;
+
+	int ClientID = -1;
+	pClient->SendControl(NET_CTRLMSG_TOKEN, NET_TOKEN_NONE);
+	DrainServer(pServer, &ClientID, 0);
+	pServer->FlushSendBatch();
+	if(!pClient->ReceiveToken())
+		return -1;
+	pClient->SendControl(NET_CTRLMSG_CONNECT, pClient->m_ServerToken);
+	DrainServer(pServer, &ClientID, 0);
+
+	// the first chunk takes the connection online
+	const unsigned char aHello[] = {1, 2, 3, 4};
+	pClient->SendChunk(aHello, sizeof(aHello));
+	if(DrainServer(pServer, &ClientID, 1) != 1)
+		return -1;
+	return ClientID;
+}
+
+static int OpenServer(CNetServer *pServer, CConfig *pConfig, int MaxClientsPerIP, NETFUNC_DELCLIENT pfnDelClient, void *pUser)
+{
+	for(int Port = 18400; Port < 18500; Port++)
+		if(pServer->Open(LocalAddr(Port), pConfig, nullptr, nullptr, nullptr, NET_MAX_CLIENTS, MaxClientsPerIP, nullptr, pfnDelClient, pUser))
+			return Port;
+	return -1;
+}
+
+static int CountDelClient(int ClientID, const char *pReason, void *pUser)
+{
+	(*(int *) pUser)++;
+	return 0;
+}
+
+TEST(NetServer, ReuseSlotsOfLostConnections)
+{
+	ASSERT_EQ(secure_random_init(), 0);
+
+	CConfig Config;
+	mem_zero(&Config, sizeof(Config));
+
+	int NumDropped = 0;
+	CNetServer Server;
+	int Port = OpenServer(&Server, &Config, 1, CountDelClient, &NumDropped);
+	if(Port < 0)
+		GTEST_SKIP() << "no local port to bind";
+
+	// one address at a time, each loses its connection by never acking vital chunks
+	CRawClient Previous;
+	Previous.m_Socket.type = 0;
+	int PreviousID = -1;
+	for(int i = 0; i < NET_MAX_CLIENTS * 2 + 1; i++)
+	{
+		CRawClient Client;
+		int ClientID = ConnectClient(&Server, &Client, Port, 0x1000 + i);
+		ASSERT_NE(ClientID, -1) << "connection " << i;
+
+		// the old address of the slot must not reach the new connection
+		if(Previous.m_Socket.type)
+		{
+			if(PreviousID == ClientID)
+			{
+				const unsigned char aStale[] = {5, 6, 7, 8};
+				Previous.SendChunk(aStale, sizeof(aStale));
+				int ReceivedID = -1;
+				EXPECT_EQ(DrainServer(&Server, &ReceivedID, 1), 0);
+			}
+			net_udp_close(Previous.m_Socket);
+		}
+
+		unsigned char aData[1024] = {0};
+		CNetChunk Chunk;
+		Chunk.m_ClientID = ClientID;
+		Chunk.m_Flags = NETSENDFLAG_VITAL;
+		Chunk.m_DataSize = sizeof(aData);
+		Chunk.m_pData = aData;
+		for(int j = 0; j < NET_CONN_BUFFERSIZE / (int) sizeof(aData) + 1 && NumDropped == i; j++)
+			Server.Send(&Chunk);
+		EXPECT_EQ(NumDropped, i + 1);
+
+		// the sweep must not release the slot a second time
+		Server.Update();
+		EXPECT_EQ(NumDropped, i + 1);
+
+		Previous = Client;
+		PreviousID = ClientID;
+	}
+	net_udp_close(Previous.m_Socket);
+	Server.Close("done");
+}
+
+// every connected client sends a chunk per round, the server has to tell them apart
+static void RecvRounds(int Rounds, bool PrintTime)
+{
+	ASSERT_EQ(secure_random_init(), 0);
+
+	CConfig Config;
+	mem_zero(&Config, sizeof(Config));
+
+	CNetServer Server;
+	int Port = OpenServer(&Server, &Config, NET_MAX_CLIENTS, nullptr, nullptr);
+	if(Port < 0)
+		GTEST_SKIP() << "no local port to bind";
+
+	CRawClient aClients[NET_MAX_CLIENTS];
+	int aClientIDs[NET_MAX_CLIENTS];
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
+		aClientIDs[i] = ConnectClient(&Server, &aClients[i], Port, 0x1000 + i);
+		ASSERT_NE(aClientIDs[i], -1);
+	}
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		for(int j = i + 1; j < NET_MAX_CLIENTS; j++)
+			EXPECT_NE(aClientIDs[i], aClientIDs[j]);
+
+	// every round each client sends an input sized chunk and a stranger sends junk
+	CRawClient Stranger = aClients[0];
+	Stranger.m_Socket = net_udp_create(LocalAddr(0), 0);
+	ASSERT_TRUE(Stranger.m_Socket.type);
+	Stranger.m_ServerToken = 0x12345678;
+
+	int64_t Time = 0;
+	unsigned char aInput[40] = {0};
+	for(int r = 0; r < Rounds; r++)
+	{
+		for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		{
+			aClients[i].SendChunk(aInput, sizeof(aInput));
+			if(i % 4 == 0)
+				Stranger.SendChunk(aInput, sizeof(aInput));
+		}
+
+		int aReceived[NET_MAX_CLIENTS];
+		int64_t Start = time_get();
+		int Num = DrainServer(&Server, aReceived, NET_MAX_CLIENTS);
+		Time += time_get() - Start;
+
+		ASSERT_EQ(Num, (int) NET_MAX_CLIENTS);
+		for(int i = 0; i < NET_MAX_CLIENTS; i++)
+			EXPECT_EQ(aReceived[i], aClientIDs[i]);
+	}
+
+	if(PrintTime)
+	{
+		int NumPackets = Rounds * (NET_MAX_CLIENTS + NET_MAX_CLIENTS / 4);
+		printf("%d clients: recv %.2fus per packet\n", (int) NET_MAX_CLIENTS, Time * 1000000.0 / time_freq() / NumPackets);
+	}
+
+	for(auto &Client : aClients)
+		net_udp_close(Client.m_Socket);
+	net_udp_close(Stranger.m_Socket);
+	Server.Close("done");
+}
+
+TEST(NetServer, RecvFindsSlotsByAddress)
+{
+	RecvRounds(10, false);
+}
+
+TEST(NetServer, DISABLED_BenchmarkRecv)
+{
+	RecvRounds(200, true);
+}
+
+TEST(NetUdp, SendBatchSkipsFailedMessages)
+{
+	NETSOCKET Receiver;
+	int Port = 18500;
+	for(; Port < 18600; Port++)
+	{
+		Receiver = net_udp_create(LocalAddr(Port), 0);
+		if(Receiver.type)
+			break;
+	}
+	if(Port == 18600)
+		GTEST_SKIP() << "no local port to bind";
+	NETSOCKET Sender = net_udp_create(LocalAddr(0), 0);
+	ASSERT_TRUE(Sender.type);
+
+	// the kernel refuses port 0, the messages after it have to go out anyway
+	const NETADDR aAddrs[3] = {LocalAddr(Port), LocalAddr(0), LocalAddr(Port)};
+	const unsigned char aaData[3][4] = {{1}, {2}, {3}};
+	const int aSizes[3] = {4, 4, 4};
+	net_udp_send_batch(Sender, aAddrs, &aaData[0][0], sizeof(aaData[0]), aSizes, 3);
+
+	int NumReceived = 0;
+	unsigned char aReceived[2] = {0};
+	while(NumReceived < 2 && net_socket_read_wait(Receiver, 500) > 0)
+	{
+		NETADDR From;
+		unsigned char aBuf[16];
+		if(net_udp_recv(Receiver, &From, aBuf, sizeof(aBuf)) == 4)
+			aReceived[NumReceived++] = aBuf[0];
+	}
+	EXPECT_EQ(NumReceived, 2);
+	EXPECT_EQ(aReceived[0], 1);
+	EXPECT_EQ(aReceived[1], 3);
+
+	net_udp_close(Sender);
+	net_udp_close(Receiver);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/jsonwriter.h>
+#include <engine/shared/profiler.h>
+
+static void AddMicroseconds(CProfiler *pProfiler, int Section, int Microseconds)
+{
+	pProfiler->Add(Section, Microseconds * time_freq() / 1000000);
+}
+
+TEST(Profiler, RegisterSection)
+{
+	CProfiler Profiler;
+	int Tick = Profiler.RegisterSection("tick");
+	int Snap = Profiler.RegisterSection("snap");
+	EXPECT_NE(Tick, Snap);
+	EXPECT_EQ(Profiler.RegisterSection("tick"), Tick);
+	EXPECT_STREQ(Profiler.SectionName(Snap), "snap");
+
+	char aName[16];
+	for(int i = Profiler.NumSections(); i < CProfiler::MAX_SECTIONS; i++)
+	{
+		str_format(aName, sizeof(aName), "section%d", i);
+		EXPECT_GE(Profiler.RegisterSection(aName), 0);
+	}
+	EXPECT_EQ(Profiler.RegisterSection("one too many"), -1);
+	// adding to a section that could not be registered does nothing
+	Profiler.SetEnabled(true);
+	Profiler.Add(-1, 100);
+	Profiler.EndTick();
+}
+
+TEST(Profiler, Disabled)
+{
+	CProfiler Profiler;
+	int Tick = Profiler.RegisterSection("tick");
+	{
+		CProfileScope Scope(&Profiler, Tick);
+	}
+	AddMicroseconds(&Profiler, Tick, 10);
+	Profiler.EndTick();
+
+	CProfiler::CStats Stats;
+	Profiler.GetStats(Tick, &Stats);
+	EXPECT_EQ(Stats.m_NumSamples, 0);
+}
+
+TEST(Profiler, Percentiles)
+{
+	CProfiler Profiler;
+	Profiler.SetEnabled(true);
+	int Tick = Profiler.RegisterSection("tick");
+	int Snap = Profiler.RegisterSection("snap");
+
+	// 1..100us, added in two halves to check that a tick sums its parts
+	for(int i = 100; i >= 1; i--)
+	{
+		AddMicroseconds(&Profiler, Tick, i / 2);
+		AddMicroseconds(&Profiler, Tick, i - i / 2);
+		Profiler.EndTick();
+	}
+
+	CProfiler::CStats Stats;
+	Profiler.GetStats(Tick, &Stats);
+	EXPECT_EQ(Stats.m_NumSamples, 100);
+	EXPECT_EQ(Stats.m_P50, 50);
+	EXPECT_EQ(Stats.m_P99, 99);
+	EXPECT_EQ(Stats.m_Max, 100);
+
+	// sections that did not run in a tick get no sample for it
+	Profiler.GetStats(Snap, &Stats);
+	EXPECT_EQ(Stats.m_NumSamples, 0);
+}
+
+TEST(Profiler, RollingWindow)
+{
+	CProfiler Profiler;
+	Profiler.SetEnabled(true);
+	int Tick = Profiler.RegisterSection("tick");
+
+	AddMicroseconds(&Profiler, Tick, 1000);
+	Profiler.EndTick();
+	for(int i = 0; i < CProfiler::WINDOW_TICKS; i++)
+	{
+		AddMicroseconds(&Profiler, Tick, 5);
+		Profiler.EndTick();
+	}
+
+	CProfiler::CStats Stats;
+	Profiler.GetStats(Tick, &Stats);
+	EXPECT_EQ(Stats.m_NumSamples, (int) CProfiler::WINDOW_TICKS);
+	EXPECT_EQ(Stats.m_Max, 5);
+
+	// toggling the profiler starts a new window
+	Profiler.SetEnabled(false);
+	Profiler.SetEnabled(true);
+	Profiler.GetStats(Tick, &Stats);
+	EXPECT_EQ(Stats.m_NumSamples, 0);
+}
+
+TEST(Profiler, Json)
+{
+	CProfiler Profiler;
+	Profiler.SetEnabled(true);
+	int Tick = Profiler.RegisterSection("tick");
+	AddMicroseconds(&Profiler, Tick, 42);
+	Profiler.EndTick();
+
+	CJsonStringWriter Writer;
+	Profiler.WriteJson(&Writer);
+	std::string Output = Writer.GetOutputString();
+	EXPECT_NE(Output.find("\"name\": \"tick\""), std::string::npos);
+	EXPECT_NE(Output.find("\"samples\": 1"), std::string::npos);
+	EXPECT_NE(Output.find("\"p50_us\": 42"), std::string::npos);
+	EXPECT_NE(Output.find("\"max_us\": 42"), std::string::npos);
+}
@@ -0,0 +1,620 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/snapshot.h>
+
+#include <algorithm>
+#include <stdio.h>
+
+static const int ITEM_INTS = 4;
+
+static void ShuffledKeys(int *pTypes, int *pIDs, int Num, unsigned Seed)
+{
+	for(int i = 0; i < Num; i++)
+	{
+		pTypes[i] = 1 + i % 12;
+		pIDs[i] = i;
+	}
+	for(int i = Num - 1; i > 0; i--)
+	{
+		Seed = Seed * 1103515245 + 12345;
+		int j = (Seed >> 8) % (i + 1);
+		std::swap(pTypes[i], pTypes[j]);
+		std::swap(pIDs[i], pIDs[j]);
+	}
+}
+
+static int BuildSnap(CSnapshotBuilder *pBuilder, const int *pTypes, const int *pIDs, int Num, void *pSnapData)
+{
+	pBuilder->Init();
+	for(int i = 0; i < Num; i++)
+	{
+		int *pData = (int *) pBuilder->NewItem(pTypes[i], pIDs[i], ITEM_INTS * sizeof(int));
+		if(!pData)
+			return -1;
+		for(int d = 0; d < ITEM_INTS; d++)
+			pData[d] = pIDs[i] * 16 + d;
+	}
+	return pBuilder->Finish(pSnapData);
+}
+
+// the previous CSnapshotBuilder::Finish, sorting the keys with a bubble sort
+static void BubbleSortFinish(const int *pTypes, const int *pIDs, int Num, int *pSortedKeys)
+{
+	int aOffsets[1024];
+	for(int i = 0; i < Num; i++)
+	{
+		pSortedKeys[i] = (pTypes[i] << 16) | pIDs[i];
+		aOffsets[i] = i * (int) (sizeof(CSnapshotItem) + ITEM_INTS * sizeof(int));
+	}
+
+	bool Sorting = true;
+	while(Sorting)
+	{
+		Sorting = false;
+		for(int i = 1; i < Num; i++)
+		{
+			if(pSortedKeys[i - 1] > pSortedKeys[i])
+			{
+				Sorting = true;
+				std::swap(pSortedKeys[i], pSortedKeys[i - 1]);
+				std::swap(aOffsets[i], aOffsets[i - 1]);
+			}
+		}
+	}
+}
+
+TEST(SnapshotBuilder, SortsUnorderedItems)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aSnap[CSnapshot::MAX_SIZE];
+	int aTypes[256], aIDs[256];
+	ShuffledKeys(aTypes, aIDs, 256, 1);
+
+	ASSERT_GT(BuildSnap(&s_Builder, aTypes, aIDs, 256, s_aSnap), 0);
+	const CSnapshot *pSnap = (const CSnapshot *) s_aSnap;
+	ASSERT_EQ(pSnap->NumItems(), 256);
+	for(int i = 1; i < pSnap->NumItems(); i++)
+		EXPECT_LT(pSnap->GetItem(i - 1)->Key(), pSnap->GetItem(i)->Key());
+
+	for(int i = 0; i < 256; i++)
+	{
+		int Index = pSnap->GetItemIndex((aTypes[i] << 16) | aIDs[i]);
+		ASSERT_NE(Index, -1);
+		EXPECT_EQ(pSnap->GetItemSize(Index), (int) (ITEM_INTS * sizeof(int)));
+		EXPECT_EQ(pSnap->GetItem(Index)->Data()[0], aIDs[i] * 16);
+		EXPECT_EQ(pSnap->GetItem(Index)->Data()[ITEM_INTS - 1], aIDs[i] * 16 + ITEM_INTS - 1);
+	}
+}
+
+TEST(SnapshotBuilder, GetItemData)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	*(int *) Builder.NewItem(5, 3, sizeof(int)) = 53;
+	*(int *) Builder.NewItem(2, 7, sizeof(int)) = 27;
+	*(int *) Builder.NewItem(5, 1, sizeof(int)) = 51;
+
+	ASSERT_TRUE(Builder.GetItemData((2 << 16) | 7));
+	EXPECT_EQ(*Builder.GetItemData((2 << 16) | 7), 27);
+	EXPECT_EQ(*Builder.GetItemData((5 << 16) | 1), 51);
+	EXPECT_EQ(*Builder.GetItemData((5 << 16) | 3), 53);
+	EXPECT_FALSE(Builder.GetItemData((5 << 16) | 2));
+	EXPECT_FALSE(Builder.GetItemData((1 << 16) | 7));
+}
+
+TEST(SnapshotBuilder, DeltaRoundtrip)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aFrom[CSnapshot::MAX_SIZE];
+	static char s_aTo[CSnapshot::MAX_SIZE];
+	static char s_aUnpacked[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	int aTypes[128], aIDs[128];
+
+	ShuffledKeys(aTypes, aIDs, 128, 2);
+	ASSERT_GT(BuildSnap(&s_Builder, aTypes, aIDs, 100, s_aFrom), 0);
+	ShuffledKeys(aTypes, aIDs, 128, 3);
+	int ToSize = BuildSnap(&s_Builder, aTypes, aIDs, 110, s_aTo);
+	ASSERT_GT(ToSize, 0);
+
+	CSnapshotDelta Delta;
+	CSnapshot *pFrom = (CSnapshot *) s_aFrom;
+	CSnapshot *pTo = (CSnapshot *) s_aTo;
+	int DeltaSize = Delta.CreateDelta(pFrom, pTo, s_aDelta);
+	ASSERT_GT(DeltaSize, 0);
+	ASSERT_EQ(Delta.UnpackDelta(pFrom, (CSnapshot *) s_aUnpacked, s_aDelta, DeltaSize), ToSize);
+	EXPECT_EQ(mem_comp(s_aUnpacked, s_aTo, ToSize), 0);
+}
+
+TEST(SnapshotBuilder, FinishMatchesBubbleSort)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aSnap[CSnapshot::MAX_SIZE];
+	static const int s_aNumItems[] = {64, 256, 1023};
+	int aTypes[1024], aIDs[1024], aBubbleKeys[1024];
+
+	for(unsigned n = 0; n < sizeof(s_aNumItems) / sizeof(s_aNumItems[0]); n++)
+	{
+		const int Num = s_aNumItems[n];
+		ShuffledKeys(aTypes, aIDs, Num, n + 1);
+		ASSERT_GT(BuildSnap(&s_Builder, aTypes, aIDs, Num, s_aSnap), 0);
+		BubbleSortFinish(aTypes, aIDs, Num, aBubbleKeys);
+
+		const CSnapshot *pSnap = (const CSnapshot *) s_aSnap;
+		ASSERT_EQ(pSnap->NumItems(), Num);
+		for(int i = 0; i < Num; i++)
+			ASSERT_EQ(pSnap->GetItem(i)->Key(), aBubbleKeys[i]);
+	}
+}
+
+TEST(SnapshotBuilder, DISABLED_BenchmarkFinish)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aSnap[CSnapshot::MAX_SIZE];
+	static const int s_aNumItems[] = {64, 256, 1023};
+	int aTypes[1024], aIDs[1024], aBubbleKeys[1024];
+
+	for(unsigned n = 0; n < sizeof(s_aNumItems) / sizeof(s_aNumItems[0]); n++)
+	{
+		const int Num = s_aNumItems[n];
+		const int Iterations = 65536 / Num;
+		ShuffledKeys(aTypes, aIDs, Num, n + 1);
+
+		int64_t Start = time_get();
+		for(int i = 0; i < Iterations; i++)
+			ASSERT_GT(BuildSnap(&s_Builder, aTypes, aIDs, Num, s_aSnap), 0);
+		int64_t Sorted = time_get() - Start;
+
+		Start = time_get();
+		for(int i = 0; i < Iterations; i++)
+			BubbleSortFinish(aTypes, aIDs, Num, aBubbleKeys);
+		int64_t Bubble = time_get() - Start;
+
+		const CSnapshot *pSnap = (const CSnapshot *) s_aSnap;
+		for(int i = 0; i < Num; i++)
+			ASSERT_EQ(pSnap->GetItem(i)->Key(), aBubbleKeys[i]);
+
+		printf("%4d items: sorted insert %.2fus, bubble sort keys only %.2fus per snapshot\n", Num,
+			Sorted * 1000000.0 / time_freq() / Iterations, Bubble * 1000000.0 / time_freq() / Iterations);
+	}
+}
+
+// the previous CSnapshotDelta::CreateDelta, matching items with a bucketed hash list
+struct CRefItemList
+{
+	int m_Num;
+	int m_aKeys[64];
+	int m_aIndex[64];
+};
+
+static unsigned RefCalcHashID(int Key)
+{
+	unsigned Hash = 5381;
+	for(unsigned Shift = 0; Shift < sizeof(int); Shift++)
+		Hash = ((Hash << 5) + Hash) + ((Key >> (Shift * 8)) & 0xFF);
+	return Hash % 256;
+}
+
+static void RefGenerateHash(CRefItemList *pHashlist, const CSnapshot *pSnapshot)
+{
+	for(int i = 0; i < 256; i++)
+		pHashlist[i].m_Num = 0;
+	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	{
+		int Key = pSnapshot->GetItem(i)->Key();
+		CRefItemList *pList = &pHashlist[RefCalcHashID(Key)];
+		if(pList->m_Num < 64)
+		{
+			pList->m_aIndex[pList->m_Num] = i;
+			pList->m_aKeys[pList->m_Num] = Key;
+			pList->m_Num++;
+		}
+	}
+}
+
+static int RefGetItemIndexHashed(int Key, const CRefItemList *pHashlist)
+{
+	const CRefItemList *pList = &pHashlist[RefCalcHashID(Key)];
+	for(int i = 0; i < pList->m_Num; i++)
+		if(pList->m_aKeys[i] == Key)
+			return pList->m_aIndex[i];
+	return -1;
+}
+
+static int RefCreateDelta(const short *pItemSizes, const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
+{
+	CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *) pDstData;
+	int *pData = (int *) pDelta->m_aData;
+	pDelta->m_NumDeletedItems = 0;
+	pDelta->m_NumUpdateItems = 0;
+	pDelta->m_NumTempItems = 0;
+
+	static CRefItemList s_aHashlist[256];
+	RefGenerateHash(s_aHashlist, pTo);
+	for(int i = 0; i < pFrom->NumItems(); i++)
+	{
+		if(RefGetItemIndexHashed(pFrom->GetItem(i)->Key(), s_aHashlist) == -1)
+		{
+			pDelta->m_NumDeletedItems++;
+			*pData++ = pFrom->GetItem(i)->Key();
+		}
+	}
+
+	RefGenerateHash(s_aHashlist, pFrom);
+	for(int i = 0; i < pTo->NumItems(); i++)
+	{
+		const int ItemSize = pTo->GetItemSize(i);
+		const CSnapshotItem *pCurItem = pTo->GetItem(i);
+		const int PastIndex = RefGetItemIndexHashed(pCurItem->Key(), s_aHashlist);
+		const bool IncludeSize = pCurItem->Type() >= 64 || !pItemSizes[pCurItem->Type()];
+		int *pItemDataDst = pData + (IncludeSize ? 3 : 2);
+
+		if(PastIndex != -1)
+		{
+			const int *pPast = pFrom->GetItem(PastIndex)->Data();
+			int Needed = 0;
+			for(int d = 0; d < ItemSize / 4; d++)
+			{
+				pItemDataDst[d] = pCurItem->Data()[d] - pPast[d];
+				Needed |= pItemDataDst[d];
+			}
+			if(!Needed)
+				continue;
+		}
+		else
+			mem_copy(pItemDataDst, pCurItem->Data(), ItemSize);
+
+		*pData++ = pCurItem->Type();
+		*pData++ = pCurItem->ID();
+		if(IncludeSize)
+			*pData++ = ItemSize / 4;
+		pData += ItemSize / 4;
+		pDelta->m_NumUpdateItems++;
+	}
+
+	if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems)
+		return 0;
+	return (int) ((char *) pData - (char *) pDstData);
+}
+
+// records a game-like sequence: moving and idle characters, short-lived projectiles and static game info
+static int RecordSnap(CSnapshotBuilder *pBuilder, int Tick, void *pSnapData)
+{
+	enum
+	{
+		TYPE_GAMEINFO = 1,
+		TYPE_CHARACTER = 4,
+		TYPE_PROJECTILE = 7,
+		TYPE_PICKUP = 9,
+		TYPE_PLAYERINFO = 12,
+	};
+
+	pBuilder->Init();
+	int *pGameInfo = (int *) pBuilder->NewItem(TYPE_GAMEINFO, 0, 6 * sizeof(int));
+	for(int d = 0; d < 6; d++)
+		pGameInfo[d] = d;
+	for(int c = 0; c < 64; c++)
+	{
+		const bool Moving = c % 4 != 0;
+		int *pChar = (int *) pBuilder->NewItem(TYPE_CHARACTER, c, 22 * sizeof(int));
+		for(int d = 0; d < 22; d++)
+			pChar[d] = c * 100 + d;
+		if(Moving)
+		{
+			pChar[0] = Tick;
+			pChar[1] = c * 32 + Tick * (c % 7);
+			pChar[2] = 640 + (Tick * c) % 97;
+			pChar[5] = (Tick + c) % 9;
+		}
+		int *pInfo = (int *) pBuilder->NewItem(TYPE_PLAYERINFO, c, 5 * sizeof(int));
+		for(int d = 0; d < 5; d++)
+			pInfo[d] = c + d;
+		pInfo[3] = Tick / 50;
+	}
+	for(int p = 0; p < 32; p++)
+	{
+		const int ID = (Tick / 5 + p) % 256;
+		int *pProj = (int *) pBuilder->NewItem(TYPE_PROJECTILE, ID, 6 * sizeof(int));
+		for(int d = 0; d < 6; d++)
+			pProj[d] = ID * 10 + d;
+	}
+	for(int p = 0; p < 24; p++)
+	{
+		int *pPickup = (int *) pBuilder->NewItem(TYPE_PICKUP, p, 3 * sizeof(int));
+		for(int d = 0; d < 3; d++)
+			pPickup[d] = p + d;
+	}
+	return pBuilder->Finish(pSnapData);
+}
+
+TEST(SnapshotDelta, CreateDeltaMatchesReference)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aaSnaps[2][CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aRefDelta[CSnapshot::MAX_SIZE];
+	static char s_aUnpacked[CSnapshot::MAX_SIZE];
+	short aItemSizes[64] = {0};
+	CSnapshotDelta Delta;
+	aItemSizes[4] = 22 * sizeof(int);
+	Delta.SetStaticsize(4, aItemSizes[4]);
+
+	CSnapshot *pFrom = (CSnapshot *) s_aaSnaps[0];
+	CSnapshot *pTo = (CSnapshot *) s_aaSnaps[1];
+	pFrom->Clear();
+	for(int Tick = 0; Tick < 120; Tick += 3)
+	{
+		int ToSize = RecordSnap(&s_Builder, Tick, pTo);
+		ASSERT_GT(ToSize, 0);
+
+		int DeltaSize = Delta.CreateDelta(pFrom, pTo, s_aDelta);
+		ASSERT_EQ(DeltaSize, RefCreateDelta(aItemSizes, pFrom, pTo, s_aRefDelta));
+		ASSERT_EQ(mem_comp(s_aDelta, s_aRefDelta, DeltaSize), 0);
+		if(DeltaSize > 0)
+		{
+			ASSERT_EQ(Delta.UnpackDelta(pFrom, (CSnapshot *) s_aUnpacked, s_aDelta, DeltaSize), ToSize);
+			EXPECT_EQ(mem_comp(s_aUnpacked, pTo, ToSize), 0);
+		}
+		std::swap(pFrom, pTo);
+	}
+
+	// identical snapshots give an empty delta
+	EXPECT_EQ(Delta.CreateDelta(pFrom, pFrom, s_aDelta), 0);
+}
+
+TEST(SnapshotDelta, ManyKeysInOneBucket)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aFrom[CSnapshot::MAX_SIZE];
+	static char s_aTo[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aUnpacked[CSnapshot::MAX_SIZE];
+
+	// ids that all land in one bucket of the old hash list, more than it could hold
+	int aIDs[100];
+	for(int ID = 0, Num = 0; Num < 100; ID++)
+		if(RefCalcHashID((3 << 16) | ID) == RefCalcHashID(3 << 16))
+			aIDs[Num++] = ID;
+
+	s_Builder.Init();
+	for(int i = 0; i < 100; i++)
+		*(int *) s_Builder.NewItem(3, aIDs[i], sizeof(int)) = i;
+	ASSERT_GT(s_Builder.Finish(s_aFrom), 0);
+	s_Builder.Init();
+	for(int i = 0; i < 100; i++)
+		*(int *) s_Builder.NewItem(3, aIDs[i], sizeof(int)) = i == 80 ? -1 : i;
+	int ToSize = s_Builder.Finish(s_aTo);
+	ASSERT_GT(ToSize, 0);
+
+	CSnapshotDelta Delta;
+	int DeltaSize = Delta.CreateDelta((CSnapshot *) s_aFrom, (CSnapshot *) s_aTo, s_aDelta);
+	const CSnapshotDelta::CData *pData = (const CSnapshotDelta::CData *) s_aDelta;
+	EXPECT_EQ(pData->m_NumDeletedItems, 0);
+	EXPECT_EQ(pData->m_NumUpdateItems, 1);
+	ASSERT_EQ(Delta.UnpackDelta((CSnapshot *) s_aFrom, (CSnapshot *) s_aUnpacked, s_aDelta, DeltaSize), ToSize);
+	EXPECT_EQ(mem_comp(s_aUnpacked, s_aTo, ToSize), 0);
+}
+
+TEST(SnapshotDelta, DISABLED_BenchmarkCreateDelta)
+{
+	enum
+	{
+		NUM_TICKS = 64,
+	};
+
+	static CSnapshotBuilder s_Builder;
+	static char s_aaSnaps[NUM_TICKS][CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	short aItemSizes[64] = {0};
+	CSnapshotDelta Delta;
+	aItemSizes[4] = 22 * sizeof(int);
+	Delta.SetStaticsize(4, aItemSizes[4]);
+
+	for(int t = 0; t < NUM_TICKS; t++)
+		ASSERT_GT(RecordSnap(&s_Builder, t, s_aaSnaps[t]), 0);
+
+	const int Rounds = 50;
+	int64_t Start = time_get();
+	int64_t NewBytes = 0;
+	for(int r = 0; r < Rounds; r++)
+		for(int t = 1; t < NUM_TICKS; t++)
+			NewBytes += Delta.CreateDelta((CSnapshot *) s_aaSnaps[t - 1], (CSnapshot *) s_aaSnaps[t], s_aDelta);
+	int64_t New = time_get() - Start;
+
+	Start = time_get();
+	int64_t RefBytes = 0;
+	for(int r = 0; r < Rounds; r++)
+		for(int t = 1; t < NUM_TICKS; t++)
+			RefBytes += RefCreateDelta(aItemSizes, (CSnapshot *) s_aaSnaps[t - 1], (CSnapshot *) s_aaSnaps[t], s_aDelta);
+	int64_t Ref = time_get() - Start;
+
+	EXPECT_EQ(NewBytes, RefBytes);
+	const int Deltas = Rounds * (NUM_TICKS - 1);
+	printf("%d items: create delta %.2fus, previous create delta %.2fus per snapshot\n", ((CSnapshot *) s_aaSnaps[0])->NumItems(),
+		New * 1000000.0 / time_freq() / Deltas, Ref * 1000000.0 / time_freq() / Deltas);
+}
+
+TEST(SnapshotDelta, CreateDeltaPackedMatchesCompress)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aaSnaps[2][CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aCompressed[CSnapshot::MAX_SIZE];
+	static char s_aPacked[CSnapshot::MAX_SIZE];
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(4, 22 * sizeof(int));
+
+	CSnapshot *pFrom = (CSnapshot *) s_aaSnaps[0];
+	CSnapshot *pTo = (CSnapshot *) s_aaSnaps[1];
+	pFrom->Clear();
+	for(int Tick = 0; Tick < 120; Tick += 3)
+	{
+		ASSERT_GT(RecordSnap(&s_Builder, Tick, pTo), 0);
+
+		int DeltaSize = Delta.CreateDelta(pFrom, pTo, s_aDelta);
+		ASSERT_GT(DeltaSize, 0);
+		long CompressedSize = CVariableInt::Compress(s_aDelta, DeltaSize, s_aCompressed, sizeof(s_aCompressed));
+		ASSERT_EQ(Delta.CreateDeltaPacked(pFrom, pTo, s_aPacked, sizeof(s_aPacked)), CompressedSize);
+		ASSERT_EQ(mem_comp(s_aPacked, s_aCompressed, CompressedSize), 0);
+
+		// not enough room for the packed delta
+		EXPECT_EQ(Delta.CreateDeltaPacked(pFrom, pTo, s_aPacked, CompressedSize / 2), -1);
+		std::swap(pFrom, pTo);
+	}
+
+	EXPECT_EQ(Delta.CreateDeltaPacked(pFrom, pFrom, s_aPacked, sizeof(s_aPacked)), 0);
+}
+
+TEST(SnapshotDelta, DISABLED_BenchmarkCreateDeltaPacked)
+{
+	enum
+	{
+		NUM_TICKS = 64,
+	};
+
+	static CSnapshotBuilder s_Builder;
+	static char s_aaSnaps[NUM_TICKS][CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aPacked[CSnapshot::MAX_SIZE];
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(4, 22 * sizeof(int));
+
+	for(int t = 0; t < NUM_TICKS; t++)
+		ASSERT_GT(RecordSnap(&s_Builder, t, s_aaSnaps[t]), 0);
+
+	const int Rounds = 50;
+	int64_t Start = time_get();
+	int64_t FusedBytes = 0;
+	for(int r = 0; r < Rounds; r++)
+		for(int t = 1; t < NUM_TICKS; t++)
+			FusedBytes += Delta.CreateDeltaPacked((CSnapshot *) s_aaSnaps[t - 1], (CSnapshot *) s_aaSnaps[t], s_aPacked, sizeof(s_aPacked));
+	int64_t Fused = time_get() - Start;
+
+	Start = time_get();
+	int64_t TwoPassBytes = 0;
+	for(int r = 0; r < Rounds; r++)
+		for(int t = 1; t < NUM_TICKS; t++)
+		{
+			int DeltaSize = Delta.CreateDelta((CSnapshot *) s_aaSnaps[t - 1], (CSnapshot *) s_aaSnaps[t], s_aDelta);
+			TwoPassBytes += CVariableInt::Compress(s_aDelta, DeltaSize, s_aPacked, sizeof(s_aPacked));
+		}
+	int64_t TwoPass = time_get() - Start;
+
+	EXPECT_EQ(FusedBytes, TwoPassBytes);
+	const int Deltas = Rounds * (NUM_TICKS - 1);
+	printf("%d items: packed delta %.2fus, delta then compress %.2fus per snapshot\n", ((CSnapshot *) s_aaSnaps[0])->NumItems(),
+		Fused * 1000000.0 / time_freq() / Deltas, TwoPass * 1000000.0 / time_freq() / Deltas);
+}
+
+// a snapshot-sized buffer filled with a pattern that depends on the tick
+static int FillTickData(int Tick, int *pData)
+{
+	const int Num = 64 + (Tick * 37) % 900;
+	for(int i = 0; i < Num; i++)
+		pData[i] = Tick * 1000 + i;
+	return Num * sizeof(int);
+}
+
+TEST(SnapshotStorage, AddGetPurge)
+{
+	static CSnapshotStorage s_Storage;
+	static int s_aData[1024];
+	s_Storage.Init();
+
+	for(int Tick = 10; Tick < 20; Tick++)
+		s_Storage.Add(Tick, Tick * 100, FillTickData(Tick, s_aData), s_aData, Tick % 2);
+	EXPECT_EQ(s_Storage.NumSnapshots(), 10);
+	EXPECT_EQ(s_Storage.Get(9, 0, 0, 0), -1);
+	EXPECT_EQ(s_Storage.Get(20, 0, 0, 0), -1);
+	EXPECT_EQ(s_Storage.Get(-1, 0, 0, 0), -1);
+
+	for(int Tick = 10; Tick < 20; Tick++)
+	{
+		int64_t Tagtime;
+		CSnapshot *pData;
+		CSnapshot *pAltData;
+		int Size = FillTickData(Tick, s_aData);
+		ASSERT_EQ(s_Storage.Get(Tick, &Tagtime, &pData, &pAltData), Size);
+		EXPECT_EQ(Tagtime, Tick * 100);
+		EXPECT_EQ(mem_comp(pData, s_aData, Size), 0);
+		if(Tick % 2)
+		{
+			ASSERT_TRUE(pAltData);
+			EXPECT_EQ(mem_comp(pAltData, s_aData, Size), 0);
+		}
+		else
+			EXPECT_FALSE(pAltData);
+	}
+
+	s_Storage.PurgeUntil(15);
+	EXPECT_EQ(s_Storage.NumSnapshots(), 5);
+	EXPECT_EQ(s_Storage.Get(14, 0, 0, 0), -1);
+	EXPECT_GT(s_Storage.Get(15, 0, 0, 0), 0);
+
+	// a restarted game starts with lower ticks again
+	s_Storage.Add(3, 0, FillTickData(3, s_aData), s_aData, false);
+	EXPECT_EQ(s_Storage.NumSnapshots(), 1);
+	EXPECT_EQ(s_Storage.Get(15, 0, 0, 0), -1);
+	EXPECT_GT(s_Storage.Get(3, 0, 0, 0), 0);
+
+	s_Storage.PurgeAll();
+	EXPECT_EQ(s_Storage.NumSnapshots(), 0);
+	EXPECT_EQ(s_Storage.Get(3, 0, 0, 0), -1);
+}
+
+TEST(SnapshotStorage, RingReusesMemory)
+{
+	static CSnapshotStorage s_Storage;
+	static int s_aData[1024];
+	s_Storage.Init();
+
+	// keep a window of 150 ticks like the server does, skipping some ticks
+	static bool s_aAdded[5000] = {false};
+	int MemoryUsage = 0;
+	for(int Tick = 0; Tick < 5000; Tick += 1 + (Tick / 700) % 2)
+	{
+		s_Storage.PurgeUntil(Tick - 150);
+		s_Storage.Add(Tick, Tick, FillTickData(Tick, s_aData), s_aData, false);
+		s_aAdded[Tick] = true;
+		if(Tick == 1000)
+			MemoryUsage = s_Storage.MemoryUsage();
+
+		// the whole window is still there
+		for(int Past = std::max(Tick - 150, 0); Past <= Tick; Past++)
+		{
+			CSnapshot *pData;
+			int Size = s_Storage.Get(Past, 0, &pData, 0);
+			ASSERT_EQ(Size >= 0, s_aAdded[Past]);
+			if(Size < 0)
+				continue;
+			ASSERT_EQ(Size, FillTickData(Past, s_aData));
+			ASSERT_EQ(mem_comp(pData, s_aData, Size), 0);
+		}
+	}
+
+	// no more growing once the window fits
+	EXPECT_EQ(s_Storage.MemoryUsage(), MemoryUsage);
+}
+
+TEST(SnapshotStorage, DISABLED_BenchmarkAdd)
+{
+	static CSnapshotStorage s_Storage;
+	static int s_aData[1024];
+	s_Storage.Init();
+	const int Size = FillTickData(1, s_aData);
+
+	const int Ticks = 20000;
+	int64_t Start = time_get();
+	for(int Tick = 0; Tick < Ticks; Tick++)
+	{
+		s_Storage.PurgeUntil(Tick - 150);
+		s_Storage.Add(Tick, Tick, Size, s_aData, false);
+		s_Storage.Get(Tick - 10, 0, 0, 0);
+	}
+	int64_t Time = time_get() - Start;
+	printf("snapshot storage: %.3fus per tick for %d bytes, %dKiB\n", Time * 1000000.0 / time_freq() / Ticks, Size, s_Storage.MemoryUsage() / 1024);
+}
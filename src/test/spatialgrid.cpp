@@ -0,0 +1,152 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/spatialgrid.h>
+
+#include <algorithm>
+#include <stdio.h>
+
+class CTestObject
+{
+public:
+	CSpatialGrid::CNode m_Node;
+	vec2 m_Pos;
+};
+
+static unsigned s_Seed = 1;
+static float RandomCoord(float Range)
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+	return (float) ((s_Seed >> 8) % 65536) / 65536.0f * Range;
+}
+
+// exact radius query through the grid, like CGameWorld::FindEntities
+static int FindGrid(const CSpatialGrid *pGrid, vec2 Pos, float Radius, CTestObject **ppFound)
+{
+	void *apCandidates[1024];
+	int Num = pGrid->Query(Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), apCandidates, 1024);
+	int Found = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		CTestObject *pObj = (CTestObject *) apCandidates[i];
+		if(distance(pObj->m_Pos, Pos) < Radius)
+			ppFound[Found++] = pObj;
+	}
+	std::sort(ppFound, ppFound + Found);
+	return Found;
+}
+
+static int FindLinear(CTestObject *pObjects, int NumObjects, vec2 Pos, float Radius, CTestObject **ppFound)
+{
+	int Found = 0;
+	for(int i = 0; i < NumObjects; i++)
+		if(distance(pObjects[i].m_Pos, Pos) < Radius)
+			ppFound[Found++] = &pObjects[i];
+	return Found;
+}
+
+TEST(SpatialGrid, MatchesLinearSearch)
+{
+	static CSpatialGrid s_Grid;
+	static CTestObject s_aObjects[500];
+	CTestObject *apGrid[500], *apLinear[500];
+
+	for(auto &Obj : s_aObjects)
+	{
+		Obj.m_Node.m_pUser = &Obj;
+		Obj.m_Pos = vec2(RandomCoord(6400.0f) - 200.0f, RandomCoord(3200.0f) - 200.0f);
+		s_Grid.Insert(&Obj.m_Node, Obj.m_Pos);
+	}
+
+	for(int Round = 0; Round < 20; Round++)
+	{
+		for(int q = 0; q < 50; q++)
+		{
+			vec2 Pos = vec2(RandomCoord(6400.0f) - 200.0f, RandomCoord(3200.0f) - 200.0f);
+			float Radius = 16.0f + RandomCoord(900.0f);
+			int Num = FindGrid(&s_Grid, Pos, Radius, apGrid);
+			ASSERT_EQ(Num, FindLinear(s_aObjects, 500, Pos, Radius, apLinear));
+			for(int i = 0; i < Num; i++)
+				ASSERT_EQ(apGrid[i], apLinear[i]);
+		}
+
+		// move some around
+		for(int i = Round; i < 500; i += 7)
+		{
+			s_aObjects[i].m_Pos += vec2(RandomCoord(200.0f) - 100.0f, RandomCoord(200.0f) - 100.0f);
+			s_Grid.Move(&s_aObjects[i].m_Node, s_aObjects[i].m_Pos);
+		}
+	}
+
+	for(auto &Obj : s_aObjects)
+		s_Grid.Remove(&Obj.m_Node);
+	void *apAll[1];
+	EXPECT_EQ(s_Grid.Query(vec2(-1e9f, -1e9f), vec2(1e9f, 1e9f), apAll, 1), 0);
+}
+
+TEST(SpatialGrid, WrapAndOverflow)
+{
+	static CSpatialGrid s_Grid;
+	CTestObject aObjects[3];
+	void *apFound[4];
+	const float Wrap = (float) CSpatialGrid::CELL_SIZE * CSpatialGrid::GRID_SIZE;
+
+	// same cell after wrapping, and positions that are no numbers at all
+	aObjects[0].m_Pos = vec2(10.0f, 10.0f);
+	aObjects[1].m_Pos = vec2(10.0f + Wrap, 10.0f);
+	aObjects[2].m_Pos = vec2(1e30f, 300.0f);
+	for(auto &Obj : aObjects)
+	{
+		Obj.m_Node.m_pUser = &Obj;
+		s_Grid.Insert(&Obj.m_Node, Obj.m_Pos);
+	}
+
+	EXPECT_EQ(s_Grid.Query(vec2(0.0f, 0.0f), vec2(20.0f, 20.0f), apFound, 4), 2);
+	EXPECT_EQ(s_Grid.Query(vec2(0.0f, 0.0f), vec2(20.0f, 20.0f), apFound, 1), -1);
+
+	// an area wider than the grid visits every cell once
+	EXPECT_EQ(s_Grid.Query(vec2(-1e9f, -1e9f), vec2(1e9f, 1e9f), apFound, 4), 3);
+	EXPECT_EQ(s_Grid.Query(vec2(-1.0f, -1.0f), vec2(Wrap - 2.0f, Wrap - 2.0f), apFound, 4), 3);
+
+	s_Grid.Move(&aObjects[1].m_Node, vec2(0.0f, 0.0f) / 0.0f);
+	for(auto &Obj : aObjects)
+		s_Grid.Remove(&Obj.m_Node);
+	EXPECT_EQ(s_Grid.Query(vec2(-1e9f, -1e9f), vec2(1e9f, 1e9f), apFound, 4), 0);
+}
+
+TEST(SpatialGrid, DISABLED_BenchmarkRadiusQueries)
+{
+	// 64 characters, each looking for others in flashlight range, among hundreds of other entities
+	static CSpatialGrid s_Grid;
+	static CTestObject s_aObjects[800];
+	CTestObject *apFound[800];
+	const int NumChars = 64;
+
+	for(auto &Obj : s_aObjects)
+	{
+		Obj.m_Node.m_pUser = &Obj;
+		Obj.m_Pos = vec2(RandomCoord(8000.0f), RandomCoord(4000.0f));
+		s_Grid.Insert(&Obj.m_Node, Obj.m_Pos);
+	}
+
+	const int Ticks = 200;
+	int64_t Start = time_get();
+	int GridFound = 0;
+	for(int t = 0; t < Ticks; t++)
+		for(int c = 0; c < NumChars; c++)
+			GridFound += FindGrid(&s_Grid, s_aObjects[c].m_Pos, 512.0f, apFound);
+	int64_t Grid = time_get() - Start;
+
+	Start = time_get();
+	int LinearFound = 0;
+	for(int t = 0; t < Ticks; t++)
+		for(int c = 0; c < NumChars; c++)
+			LinearFound += FindLinear(s_aObjects, 800, s_aObjects[c].m_Pos, 512.0f, apFound);
+	int64_t Linear = time_get() - Start;
+
+	EXPECT_EQ(GridFound, LinearFound);
+	printf("800 entities, %d queries per tick: grid %.2fus, linear %.2fus per tick\n", NumChars,
+		Grid * 1000000.0 / time_freq() / Ticks, Linear * 1000000.0 / time_freq() / Ticks);
+}